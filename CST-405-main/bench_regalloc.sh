@@ -0,0 +1,86 @@
+#!/bin/bash
+
+# Register Allocator Benchmark for C-Minus Compiler
+# CST-405 Compiler Design
+#
+# Compiles the test programs and generated large functions with
+# -fregalloc=linear and -fregalloc=graph and compares the time spent in
+# the allocator, the whole compile time and the values spilled.
+#
+# Usage: ./bench_regalloc.sh [compiler_options]     (default -O1)
+
+options="${@:--O1}"
+
+echo "=================================="
+echo "Register Allocator Benchmark"
+echo "=================================="
+echo
+
+make > /dev/null 2>&1
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Generate a function of n statements over k variables that stay live
+# through a loop, so the register pressure is roughly k
+generate() {
+    local n=$1 k=$2 file=$3
+    awk -v n="$n" -v k="$k" 'BEGIN {
+        print "int work(int seed) {"
+        for (i = 0; i < k; i++) print "    int v" i ";"
+        print "    int i;"
+        for (i = 0; i < k; i++) print "    v" i " = seed + " i ";"
+        print "    i = 0;"
+        print "    while (i < 10) {"
+        for (s = 0; s < n; s++) {
+            a = s % k; b = (s * 7 + 1) % k; c = (s * 13 + 5) % k
+            print "        v" a " = v" b " + v" c " * " (s % 9 + 2) ";"
+        }
+        print "        i = i + 1;"
+        print "    }"
+        printf "    return v0"
+        for (i = 1; i < k; i++) printf " + v" i
+        print ";"
+        print "}"
+        print ""
+        print "void main(void) {"
+        print "    output(work(input()));"
+        print "}"
+    }' > "$file"
+}
+
+cp tests/*.cm "$work"/
+generate 500 12 "$work/gen_500x12.cm"
+generate 2000 40 "$work/gen_2000x40.cm"
+generate 8000 60 "$work/gen_8000x60.cm"
+
+printf "%-18s %-7s %8s %8s %8s %10s %10s\n" \
+       "Program" "Method" "Values" "Spilled" "Copies" "Alloc ms" "Total s"
+for source in "$work"/*.cm; do
+    for method in linear graph; do
+        start=$(date +%s%N)
+        ./cminus $options -fregalloc=$method "$source" > "$work/log" 2>&1
+        finish=$(date +%s%N)
+
+        # Sum the per-function lines printed under "Register allocation:"
+        sed -n '/^Register allocation:/,/^MIPS code generation/p' "$work/log" | awk \
+            -v name="$(basename "$source" .cm)" -v method="$method" \
+            -v total="$(( (finish - start) / 1000000 ))" '
+            / values,/ {
+                for (i = 1; i <= NF; i++) {
+                    if ($(i + 1) ~ /^values/) values += $i
+                    if ($(i + 1) ~ /^spilled/) spilled += $i
+                    if ($(i + 1) ~ /^copies/) { split($i, c, "/"); coalesced += c[1]; copies += c[2] }
+                    if ($(i + 1) ~ /^ms/) ms += $i
+                }
+            }
+            END {
+                printf "%-18s %-7s %8d %8d %4d/%-4d %10.2f %10.3f\n",
+                       name, method, values, spilled, coalesced, copies, ms, total / 1000
+            }'
+    done
+done
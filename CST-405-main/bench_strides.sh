@@ -0,0 +1,73 @@
+#!/bin/bash
+
+# Constant Multiplication Benchmark for C-Minus Compiler
+# CST-405 Compiler Design
+#
+# Compiles loops that step through arrays by constant strides with
+# -fmul-chains and -fno-mul-chains and compares the instructions emitted,
+# the mul instructions left and the stall cycles the scheduler's latency
+# model predicts (before -> after scheduling).
+#
+# Usage: ./bench_strides.sh [compiler_options]     (default -O2)
+
+options="${@:--O2}"
+
+echo "=================================="
+echo "Constant Multiplication Benchmark"
+echo "=================================="
+echo
+
+make > /dev/null 2>&1
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Generate a loop that reads an array at i * c for each stride c given
+generate() {
+    local file=$1
+    shift
+    awk -v strides="$*" 'BEGIN {
+        n = split(strides, c, " ")
+        max = 0
+        for (k = 1; k <= n; k++) if (c[k] > max) max = c[k]
+        print "int data[" (8 * max + 1) "];"
+        print ""
+        print "void main(void) {"
+        print "    int i;"
+        print "    int sum;"
+        print "    sum = 0;"
+        print "    i = 0;"
+        print "    while (i < 8) {"
+        for (k = 1; k <= n; k++) print "        sum = sum + data[i * " c[k] "];"
+        print "        i = i + 1;"
+        print "    }"
+        print "    output(sum);"
+        print "}"
+    }' > "$file"
+}
+
+cp tests/strides.cm "$work"/
+generate "$work/gen_small.cm" 3 5 6 7 9
+generate "$work/gen_mixed.cm" 10 12 15 17 24 31 33 63
+generate "$work/gen_large.cm" 100 255 257 1000 1023
+
+printf "%-12s %-14s %12s %6s %14s\n" \
+       "Program" "Multiply" "Instructions" "mul" "Stalls"
+for source in "$work"/*.cm; do
+    name=$(basename "$source" .cm)
+    for mode in mul-chains no-mul-chains; do
+        ./cminus $options -f$mode "$source" > "$work/log" 2>&1
+        asm="${source%.cm}.s"
+
+        # Instructions are the indented lines that are not comments
+        count=$(grep -cE '^[[:space:]]+[a-z]' "$asm")
+        muls=$(grep -cE '^[[:space:]]+mul[[:space:]]' "$asm")
+        stalls=$(sed -n 's/.*estimated stall cycles \(.*\)$/\1/p' "$work/log")
+        printf "%-12s %-14s %12d %6d %14s\n" \
+               "$name" "$mode" "$count" "$muls" "${stalls:--}"
+    done
+done
@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# Output Checking Script for C-Minus Compiler
+# CST-405 Compiler Design
+#
+# Compiles every tests/NAME.cm that has a tests/NAME.expected at -O0, -O1
+# and -O2, runs it with SPIM on the numbers in tests/NAME.in (if any) and
+# compares the values it outputs, one per line, with NAME.expected.
+#
+# Usage: ./check_outputs.sh [compiler_options]     (added to each level)
+
+options="$@"
+
+if ! command -v spim &> /dev/null; then
+    echo "SPIM not found: install spim to check program outputs"
+    exit 1
+fi
+
+if [ ! -x ./cminus ]; then
+    echo "Compiler not built: run make first"
+    exit 1
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+passed=0
+failed=0
+for expected in tests/*.expected; do
+    name=$(basename "$expected" .expected)
+    input="tests/$name.in"
+    [ -f "$input" ] || input=/dev/null
+
+    # Compile a copy so the tests directory gets no .s files
+    cp "tests/$name.cm" "$work/"
+    for level in -O0 -O1 -O2; do
+        rm -f "$work/$name.s"
+        if ! ./cminus $level $options "$work/$name.cm" > "$work/log" 2>&1 ||
+           [ ! -f "$work/$name.s" ]; then
+            echo "FAIL $name $level: compilation failed"
+            failed=$((failed + 1))
+            continue
+        fi
+
+        # Code with filled delay slots runs only with delayed branches
+        spim_options=""
+        if grep -q "^\.set noreorder" "$work/$name.s"; then
+            spim_options="-delayed_branches"
+        fi
+
+        # Drop SPIM's banner and the input prompts, keep one value per line
+        timeout 10 spim $spim_options -file "$work/$name.s" < "$input" 2>&1 |
+            grep -v "^Loaded:" | sed 's/Enter a number: //g' > "$work/actual"
+
+        if diff -u "$expected" "$work/actual" > "$work/diff"; then
+            passed=$((passed + 1))
+        else
+            echo "FAIL $name $level"
+            cat "$work/diff"
+            failed=$((failed + 1))
+        fi
+    done
+done
+
+echo "Output checks: $passed passed, $failed failed"
+[ $failed -eq 0 ]
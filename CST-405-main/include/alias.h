@@ -0,0 +1,60 @@
+#ifndef ALIAS_H
+#define ALIAS_H
+
+/*
+ * Array Alias Analysis for Three-Address Code
+ * CST-405 Compiler Design
+ */
+
+#include "codegen.h"
+
+/* Answer to an alias query */
+typedef enum {
+    NO_ALIAS = 0,              /* Never the same storage */
+    MAY_ALIAS,
+    MUST_ALIAS                 /* Always the same storage */
+} AliasResult;
+
+/* Kinds of array names within a function */
+typedef enum {
+    ARRAY_LOCAL,
+    ARRAY_GLOBAL,
+    ARRAY_PARAMETER
+} ArrayKind;
+
+/* An array index as base + offset; base is NULL for a constant */
+typedef struct {
+    char *base;
+    int offset;
+} ArrayIndex;
+
+/* The element an array load or store touches */
+typedef struct {
+    char *array;
+    ArrayIndex index;
+} MemoryAccess;
+
+/* Arrays of one function and which of them have escaped */
+typedef struct {
+    TACInstruction *func_begin;
+    char **parameters;         /* Array and scalar formals */
+    int parameter_count;
+    char **escaped;            /* Local arrays passed to a call here, and
+                                  global arrays passed anywhere */
+    int escaped_count;
+} AliasInfo;
+
+/* Analysis */
+AliasInfo *compute_alias_info(TACInstruction *func_begin);
+void free_alias_info(AliasInfo *info);
+
+/* Queries */
+MemoryAccess memory_access(TACInstruction *instr);
+ArrayKind array_kind(AliasInfo *info, const char *array);
+AliasResult alias_arrays(AliasInfo *info, const char *a, const char *b);
+AliasResult alias_accesses(AliasInfo *info, MemoryAccess *a, MemoryAccess *b);
+int call_may_access(AliasInfo *info, const char *array);
+int call_may_touch(AliasInfo *info, MemoryAccess *access);
+int call_may_change(AliasInfo *info, const char *name);
+
+#endif /* ALIAS_H */
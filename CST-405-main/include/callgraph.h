@@ -0,0 +1,52 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+/*
+ * Call Graph for Three-Address Code
+ * CST-405 Compiler Design
+ */
+
+#include "codegen.h"
+
+struct FunctionNode;
+
+/* One call instruction and the params feeding it */
+typedef struct CallSite {
+    TACInstruction *call;              /* TAC_CALL instruction */
+    TACInstruction **params;           /* PARAM instructions in argument order */
+    int arg_count;
+    struct FunctionNode *caller;
+    struct FunctionNode *callee;       /* NULL for built-ins (input/output) */
+    int loop_depth;                    /* Loop nesting of the call in its caller */
+} CallSite;
+
+/* One function of the program */
+typedef struct FunctionNode {
+    int index;
+    char *name;
+    TACInstruction *begin;             /* BEGIN_FUNC instruction */
+    TACInstruction *end;               /* END_FUNC instruction */
+    TACInstruction **formals;          /* FORMAL instructions in parameter order */
+    int formal_count;
+    int instruction_count;             /* Body size, used for growth budgets */
+    CallSite **callers;                /* Sites calling this function */
+    int caller_count;
+    int caller_capacity;
+} FunctionNode;
+
+/* Whole-program call graph */
+typedef struct {
+    FunctionNode **functions;          /* In program order */
+    int function_count;
+    CallSite **sites;                  /* In program order */
+    int site_count;
+    int instruction_count;             /* Size of the whole program */
+} CallGraph;
+
+/* Call graph construction */
+CallGraph *build_call_graph(void);
+void free_call_graph(CallGraph *graph);
+FunctionNode *call_graph_function(CallGraph *graph, char *name);
+int formal_index(FunctionNode *func, char *name);
+
+#endif /* CALLGRAPH_H */
@@ -0,0 +1,96 @@
+#ifndef CFG_H
+#define CFG_H
+
+/*
+ * Control Flow Graph for Three-Address Code
+ * CST-405 Compiler Design
+ */
+
+#include "codegen.h"
+
+/* Basic block structure for optimization */
+typedef struct BasicBlock {
+    int id;
+    TACInstruction *start;
+    TACInstruction *end;
+    TACInstruction *before;    /* Instruction preceding start */
+    struct BasicBlock **predecessors;
+    struct BasicBlock **successors;
+    int pred_count;
+    int succ_count;
+    int pred_capacity;
+    
+    /* Control flow edges by kind */
+    struct BasicBlock *fall_through;   /* Next block if execution falls off end */
+    struct BasicBlock *jump_target;    /* Target of the terminating jump */
+    
+    /* Analysis scratch */
+    int reachable;
+    
+    /* Dominance and loop nesting (filled by compute_loop_depths) */
+    struct BasicBlock *idom;           /* Immediate dominator, entry points to itself */
+    int rpo_number;                    /* Reverse postorder index, -1 if unreachable */
+    int loop_depth;                    /* Number of natural loops containing the block */
+    
+    /* Data flow information (bit vectors over the function's VariableTable,
+       filled by compute_liveness) */
+    unsigned int *live_in;
+    unsigned int *live_out;
+    unsigned int *gen;
+    unsigned int *kill;
+} BasicBlock;
+
+/* Scalar operands of one function, numbered for data flow bit vectors */
+typedef struct {
+    char **names;
+    int *is_global;
+    int count;
+    int capacity;
+    int *slots;                /* Open addressing: name index + 1, 0 = empty */
+    int slot_count;
+} VariableTable;
+
+/* Control flow graph of a single function */
+typedef struct {
+    TACInstruction *func_begin;    /* BEGIN_FUNC instruction */
+    TACInstruction *func_end;      /* END_FUNC instruction */
+    BasicBlock **blocks;           /* Blocks in layout order, blocks[0] is entry */
+    int block_count;
+    BasicBlock **label_blocks;     /* Label number -> block holding it */
+    int label_limit;
+    VariableTable *variables;      /* Built on demand by cfg_variables */
+    int live_words;                /* Words per liveness bit vector, 0 if not computed */
+} ControlFlowGraph;
+
+/* CFG construction */
+ControlFlowGraph *build_cfg(TACInstruction *func_begin);
+void free_cfg(ControlFlowGraph *cfg);
+BasicBlock *cfg_block_for_label(ControlFlowGraph *cfg, int label);
+int block_exits_function(BasicBlock *block);
+void mark_reachable_blocks(ControlFlowGraph *cfg);
+
+/* Dominators and loops */
+void compute_dominators(ControlFlowGraph *cfg);
+int dominates(BasicBlock *a, BasicBlock *b);
+void compute_loop_depths(ControlFlowGraph *cfg);
+
+/* Variable numbering */
+VariableTable *cfg_variables(ControlFlowGraph *cfg);
+int variable_index(VariableTable *vars, char *name);
+
+/* Live variables */
+void compute_liveness(ControlFlowGraph *cfg);
+void update_live_set(ControlFlowGraph *cfg, unsigned int *live, TACInstruction *instr);
+int bit_is_set(unsigned int *set, int index);
+void set_bit(unsigned int *set, int index);
+void clear_bit(unsigned int *set, int index);
+
+/* Instruction classification */
+int is_jump(TACInstruction *instr);
+int is_conditional_jump(TACInstruction *instr);
+int ends_block(TACInstruction *instr);
+
+/* Function iteration */
+TACInstruction *find_function_end(TACInstruction *func_begin);
+
+#endif /* CFG_H */
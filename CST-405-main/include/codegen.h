@@ -47,7 +47,11 @@ typedef enum {
     
     /* Function definition */
     TAC_FUNC_BEGIN, /* begin_func f */
-    TAC_FUNC_END    /* end_func */
+    TAC_FUNC_END,   /* end_func */
+    TAC_FORMAL,     /* formal x (next incoming parameter) */
+    
+    /* Safety checks */
+    TAC_BOUNDS_CHECK /* bounds_check a, i, n (trap unless 0 <= i < n) */
 } TACOpcode;
 
 /* Three-address code instruction */
@@ -82,6 +86,8 @@ char *gen_tac_binary_op(ASTNode *node);
 char *gen_tac_assignment(ASTNode *node);
 char *gen_tac_call(ASTNode *node);
 char *gen_tac_var(ASTNode *node);
+char *gen_tac_name(ASTNode *node);
+void gen_tac_bounds_check(ASTNode *access, char *index);
 
 /* Statement code generation */
 void gen_tac_statement(ASTNode *node);
@@ -92,6 +98,7 @@ void gen_tac_compound(ASTNode *node);
 
 /* Declaration code generation */
 void gen_tac_func_decl(ASTNode *node);
+void gen_tac_formals(ASTNode *params);
 void gen_tac_var_decl(ASTNode *node);
 
 /* TAC instruction creation */
@@ -114,6 +121,10 @@ void write_tac_to_file(FILE *file);
 /* TAC optimization hooks */
 TACInstruction *get_tac_list(void);
 void set_tac_list(TACInstruction *list);
+void insert_tac_after(TACInstruction *pos, TACInstruction *instr);
+void remove_tac_after(TACInstruction *prev);
+TACInstruction *copy_tac(TACInstruction *instr);
+void free_tac_instruction(TACInstruction *instr);
 
 /* Memory management */
 void free_tac(void);
@@ -0,0 +1,26 @@
+#ifndef DELAY_H
+#define DELAY_H
+
+/*
+ * Branch Delay Slot Filling
+ * CST-405 Compiler Design
+ */
+
+#include "machine.h"
+
+/* Instructions looked at before a branch for one to move into its slot */
+#define DELAY_SEARCH_LIMIT 16
+
+/* Simulators selectable with -fdelay-slots= */
+typedef enum {
+    DELAY_SLOTS_SPIM = 0,      /* Branch-likely forms may take a target's copy */
+    DELAY_SLOTS_MARS           /* No branch-likely: only j takes a target's copy */
+} DelaySlotTarget;
+
+extern DelaySlotTarget delay_slot_target;
+
+/* Filling (with -fdelay-slots) */
+void fill_delay_slots(MachineFunction *mf);
+void print_delay_slot_statistics(void);
+
+#endif /* DELAY_H */
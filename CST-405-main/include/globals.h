@@ -32,6 +32,11 @@ extern Boolean trace_parse;
 extern Boolean trace_semantic;
 extern Boolean trace_code;
 extern Boolean generate_code;
+extern Boolean bounds_checking;
+extern Boolean delay_slot_filling;
+extern Boolean multiply_chains;
+extern int optimization_level;
+extern const char *pass_pipeline;      /* -passes= override, NULL for the -O default */
 
 /* Current line and column numbers */
 extern int linenum;
@@ -0,0 +1,129 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+/*
+ * MIPS Machine Instructions and Assembly Writer
+ * CST-405 Compiler Design
+ */
+
+#include <stdio.h>
+
+/* Opcodes of the machine instruction list */
+typedef enum {
+    /* Arithmetic and logic (addu and subu wrap instead of trapping) */
+    MOP_ADD, MOP_ADDI, MOP_ADDIU, MOP_ADDU, MOP_SUB, MOP_SUBU,
+    MOP_MUL, MOP_MULT, MOP_DIV, MOP_MFHI, MOP_MFLO,
+    MOP_XOR, MOP_XORI, MOP_ORI, MOP_LUI, MOP_SLL, MOP_SRL, MOP_SRA,
+
+    /* Comparisons (sle and the rest are assembler macros) */
+    MOP_SLT, MOP_SLTI, MOP_SLTU, MOP_SLTIU,
+    MOP_SLE, MOP_SGT, MOP_SGE, MOP_SEQ, MOP_SNE,
+
+    /* Moves */
+    MOP_LI, MOP_LA, MOP_MOVE,
+
+    /* Memory */
+    MOP_LW, MOP_SW,
+
+    /* Control */
+    MOP_J, MOP_JAL, MOP_JR,
+    MOP_BEQ, MOP_BNE, MOP_BEQZ, MOP_BNEZ, MOP_BLTZ, MOP_BGEZ, MOP_BLEZ, MOP_BGTZ,
+    MOP_BEQL, MOP_BNEL, MOP_BLTZL, MOP_BGEZL,  /* Branch-likely: the delay slot */
+    MOP_BLEZL, MOP_BGTZL,                      /* runs only when taken */
+    MOP_SYSCALL, MOP_NOP,
+
+    /* Not instructions */
+    MOP_LABEL,                 /* operand[0] is the label */
+    MOP_COMMENT,               /* comment holds the text */
+    MOP_DELETED,               /* Removed by a pass, dropped by machine_compact */
+
+    MOP_COUNT
+} MachineOpcode;
+
+/* Operand kinds */
+typedef enum {
+    MO_NONE = 0,
+    MO_REG,                    /* reg */
+    MO_IMM,                    /* value */
+    MO_LABEL,                  /* symbol, or the numbered label L<value> */
+    MO_MEM                     /* [symbol+]value[(reg)]; reg is -1 without a base */
+} MachineOperandKind;
+
+typedef struct {
+    MachineOperandKind kind;
+    int reg;
+    int value;
+    const char *symbol;        /* TAC name or a string of the function */
+} MachineOperand;
+
+/* One machine instruction, label or comment */
+typedef struct {
+    MachineOpcode op;
+    MachineOperand operand[3];
+    const char *comment;       /* MOP_COMMENT only (a string literal) */
+} MachineInstr;
+
+/* Instructions of one function (or runtime routine), in order */
+typedef struct {
+    MachineInstr *code;
+    int count;
+    int capacity;
+    char **strings;            /* Symbols the function made up, such as its exit label */
+    int string_count;
+} MachineFunction;
+
+/* Registers an instruction reads or writes: bit n is $n, and HI/LO
+   (written by mult and div, read by mfhi and mflo) count as one more
+   register */
+typedef unsigned long long RegisterMask;
+
+#define MACHINE_HILO 32
+
+/* Buffered assembly output: text is copied into a block written with
+   one fwrite when it fills */
+#define ASM_BUFFER_SIZE 65536
+
+typedef struct {
+    FILE *file;
+    char buffer[ASM_BUFFER_SIZE];
+    size_t used;
+} AsmWriter;
+
+/* Operands */
+#define NO_OPERAND machine_none()
+
+MachineOperand machine_none(void);
+MachineOperand machine_reg(int reg);
+MachineOperand machine_imm(int value);
+MachineOperand machine_label(int label);
+MachineOperand machine_symbol(const char *symbol);
+MachineOperand machine_mem(int offset, int base);
+MachineOperand machine_symbol_mem(const char *symbol, int offset, int base);
+
+/* Instruction lists */
+MachineFunction *new_machine_function(void);
+void free_machine_function(MachineFunction *mf);
+void machine_append(MachineFunction *mf, MachineOpcode op, MachineOperand a,
+                    MachineOperand b, MachineOperand c);
+void machine_comment(MachineFunction *mf, const char *text);
+const char *machine_string(MachineFunction *mf, const char *prefix, const char *suffix);
+void machine_compact(MachineFunction *mf);
+int is_machine_instruction(MachineInstr *mi);
+int is_control_transfer(MachineOpcode op);
+int is_conditional_branch(MachineOpcode op);
+int machine_latency(MachineOpcode op);
+RegisterMask machine_defs(MachineInstr *mi);
+RegisterMask machine_uses(MachineInstr *mi);
+MachineOperand *machine_jump_target(MachineInstr *mi);
+int machine_same_label(MachineOperand *a, MachineOperand *b);
+int machine_may_alias(MachineOperand *a, MachineOperand *b);
+
+/* Writing assembly */
+AsmWriter *new_asm_writer(FILE *file);
+void asm_write_string(AsmWriter *w, const char *text);
+void asm_write_int(AsmWriter *w, int value);
+void asm_write_function(AsmWriter *w, MachineFunction *mf);
+void free_asm_writer(AsmWriter *w);
+const char *machine_register_name(int reg);
+
+#endif /* MACHINE_H */
@@ -8,6 +8,30 @@
 
 #include "codegen.h"
 #include "symtab.h"
+#include "regalloc.h"
+#include "select.h"
+#include "machine.h"
+
+/* Stack pointer alignment required by the o32 convention */
+#define FRAME_ALIGNMENT 8
+
+/* Weighted accesses (one in a loop counts in full) from which a function
+   keeps a global array's address in a register instead of forming it
+   from the label at each access */
+#define GLOBAL_BASE_MIN_USES 3
+
+/* Longest shift-and-add sequence searched for a multiplication by a
+   constant; the cost model usually stops well short of it */
+#define MULTIPLY_SEQUENCE_LIMIT 6
+
+/* Frame pointer use, chosen with -f[no-]omit-frame-pointer */
+typedef enum {
+    FRAME_POINTER_DEFAULT = 0,     /* Kept at -O0, omitted above */
+    FRAME_POINTER_KEEP,            /* Frames addressed from $fp */
+    FRAME_POINTER_OMIT             /* Frames addressed from $sp */
+} FramePointerMode;
+
+extern FramePointerMode frame_pointer_mode;
 
 /* MIPS Registers */
 typedef enum {
@@ -68,7 +92,8 @@ typedef enum {
     REG_RA = 31     /* $31 - return address */
 } MIPSRegister;
 
-/* Register allocation info */
+/* Register allocation info, updated as each result is written (names
+   belong to the function's RegisterAllocation) */
 typedef struct {
     char *var_name;         /* Variable/temp mapped to this register */
     int is_dirty;           /* Need to write back to memory */
@@ -78,10 +103,23 @@ typedef struct {
 /* MIPS generation context */
 typedef struct {
     FILE *output;           /* Output file */
+    AsmWriter *writer;      /* Buffered writer over it */
+    MachineFunction *function; /* Instructions of the function being generated */
+    const char *exit_label; /* Its shared epilogue */
     RegisterInfo regs[32]; /* Register allocation table */
     int stack_offset;       /* Current stack offset */
     int param_offset;       /* Parameter offset */
     char *current_func;     /* Current function name */
+    RegisterAllocation *allocation; /* Registers of the current function */
+    int frame_size;         /* Bytes of the current frame */
+    int outgoing_size;      /* Bytes at its bottom for stack arguments of calls */
+    int saves_ra;           /* Frame holds $ra (the function makes calls) */
+    int saves_fp;           /* Frame holds the caller's $fp */
+    MIPSRegister frame_base; /* Register the frame is addressed from: $fp or $sp */
+    int formal_count;       /* Incoming parameters read so far */
+    Selection *selection;   /* Tiles of the current function, NULL when selecting directly */
+    int emitted;            /* Instructions written so far */
+    int function_emitted;   /* ...when the current function began */
 } MIPSContext;
 
 /* Main MIPS generation function */
@@ -94,21 +132,45 @@ void gen_mips_assignment(TACInstruction *instr);
 void gen_mips_comparison(TACInstruction *instr);
 void gen_mips_branch(TACInstruction *instr);
 void gen_mips_function(TACInstruction *instr);
+void gen_mips_formal(TACInstruction *instr);
 void gen_mips_call(TACInstruction *instr);
 void gen_mips_return(TACInstruction *instr);
 void gen_mips_array(TACInstruction *instr);
+void gen_mips_bounds_check(TACInstruction *instr);
 
-/* Register allocation */
-MIPSRegister allocate_register(char *var);
-MIPSRegister get_register(char *var);
-void free_register(MIPSRegister reg);
-void spill_register(MIPSRegister reg);
+/* Operand access (registers come from regalloc.c) */
+MIPSRegister use_register(char *operand, MIPSRegister scratch);
+MIPSRegister def_register(char *var, MIPSRegister scratch);
+void finish_def(char *var, MIPSRegister reg);
 void load_variable(char *var, MIPSRegister reg);
 void store_variable(char *var, MIPSRegister reg);
+MIPSRegister frame_base_register(void);
+
+/* Immediates and constants (shared with the tree selector) */
+int fits_immediate(long value);
+int fits_unsigned_immediate(long value);
+int operand_constant(char *operand, int *value);
+void load_constant(MIPSRegister reg, int value);
+TACOpcode mirror_comparison(TACOpcode op);
+void gen_comparison_immediate(TACOpcode op, MIPSRegister rd, MIPSRegister rs, long c);
+int multiply_sequence_length(int value);
+void gen_multiply_constant(MIPSRegister rd, MIPSRegister rs, int value);
+void gen_divide_constant(MIPSRegister rd, MIPSRegister rs, int value);
 
-/* MIPS output functions */
-void emit_mips(const char *format, ...);
+/* MIPS output functions: instructions go to the current function's
+   machine instruction list, written out when the function ends */
+void emit_instruction(MachineOpcode op, MachineOperand a, MachineOperand b, MachineOperand c);
+void emit_rrr(MachineOpcode op, MIPSRegister rd, MIPSRegister rs, MIPSRegister rt);
+void emit_rri(MachineOpcode op, MIPSRegister rt, MIPSRegister rs, int immediate);
+void emit_ri(MachineOpcode op, MIPSRegister rt, int immediate);
+void emit_rr(MachineOpcode op, MIPSRegister rd, MIPSRegister rs);
+void emit_memory(MachineOpcode op, MIPSRegister reg, MachineOperand address);
+void emit_jump(MachineOpcode op, MachineOperand target);
+void emit_branch(MachineOpcode op, MIPSRegister rs, MachineOperand target);
+void emit_branch_equal(MachineOpcode op, MIPSRegister rs, MIPSRegister rt, MachineOperand target);
+void emit_comment(const char *text);
 void emit_label_mips(int label);
+void emit_symbol_label(const char *symbol);
 void emit_data_section(void);
 void emit_text_section(void);
 void emit_syscall_functions(void);
@@ -116,6 +178,7 @@ void emit_syscall_functions(void);
 /* Utility functions */
 char *reg_name(MIPSRegister reg);
 int get_var_offset(char *var);
+int spill_offset(int slot);
 int is_global_var(char *var);
 
 #endif /* MIPS_H */
\ No newline at end of file
@@ -7,6 +7,7 @@
  */
 
 #include "codegen.h"
+#include "cfg.h"
 
 /* Optimization levels */
 typedef enum {
@@ -15,45 +16,53 @@ typedef enum {
     OPT_AGGRESSIVE = 2  /* Aggressive optimizations */
 } OptimizationLevel;
 
-/* Basic block structure for optimization */
-typedef struct BasicBlock {
-    int id;
-    TACInstruction *start;
-    TACInstruction *end;
-    struct BasicBlock **predecessors;
-    struct BasicBlock **successors;
-    int pred_count;
-    int succ_count;
-    
-    /* Data flow information */
-    int *live_in;
-    int *live_out;
-    int *gen;
-    int *kill;
-} BasicBlock;
-
 /* Optimization passes */
 void optimize_tac(OptimizationLevel level);
 
-/* Basic optimizations */
-void constant_folding(void);
-void constant_propagation(void);
-void dead_code_elimination(void);
-void copy_propagation(void);
-void algebraic_simplification(void);
+/* Basic optimizations: each pass works on one function and returns the
+   number of changes it made */
+int constant_folding(TACInstruction *func_begin);
+int constant_propagation(TACInstruction *func_begin);
+int dead_code_elimination(TACInstruction *func_begin);
+int copy_propagation(TACInstruction *func_begin);
+int algebraic_simplification(TACInstruction *func_begin);
 
 /* Peephole optimizations */
-void peephole_optimization(void);
-void remove_redundant_jumps(void);
-void combine_operations(void);
+int peephole_optimization(TACInstruction *func_begin);
+int remove_redundant_jumps(TACInstruction *func_begin);
+int combine_operations(TACInstruction *func_begin);
 
 /* Control flow optimizations */
-void build_cfg(void);
-void remove_unreachable_code(void);
 void merge_basic_blocks(void);
 
+/* Jump threading */
+int thread_function_jumps(TACInstruction *func_begin);
+int fold_constant_branches(TACInstruction *func_begin);
+int retarget_jump_chains(TACInstruction *func_begin);
+int thread_decided_branches(ControlFlowGraph *cfg);
+int duplicate_branch_blocks(TACInstruction *func_begin);
+int invert_branches_over_gotos(TACInstruction *func_begin);
+int remove_unreachable_blocks(TACInstruction *func_begin);
+int remove_unreferenced_labels(TACInstruction *func_begin);
+int remove_jumps_to_next(TACInstruction *func_begin);
+
+/* Interprocedural constant propagation and specialization */
+int interprocedural_constant_propagation(void);
+
+/* Value range analysis */
+int propagate_function_ranges(TACInstruction *func_begin);
+
 /* Common subexpression elimination */
-void common_subexpression_elimination(void);
+int common_subexpression_elimination(TACInstruction *func_begin);
+
+/* Redundant load elimination and store-to-load forwarding */
+int redundant_load_elimination(TACInstruction *func_begin);
+
+/* Partial redundancy elimination (lazy code motion) */
+int partial_redundancy_elimination(TACInstruction *func_begin);
+
+/* Dead store elimination for local arrays */
+int dead_store_elimination(TACInstruction *func_begin);
 
 /* Live variable analysis */
 void live_variable_analysis(void);
@@ -65,20 +74,74 @@ void prepare_for_register_allocation(void);
 int is_constant(char *operand);
 int get_constant_value(char *operand);
 int is_temporary(char *operand);
+int is_global_name(char *name);
+int is_binary_operation(TACOpcode op);
+int defines_result(TACInstruction *instr);
+int uses_result(TACInstruction *instr);
+int is_block_boundary(TACInstruction *instr);
 void replace_operand(TACInstruction *instr, char *old_op, char *new_op);
 
 /* Statistics */
+#define MAX_PASS_STATS 32
+
+/* Optimization tiers, from most to least thorough */
+typedef enum {
+    TIER_FULL = 0,      /* Whole pipeline to a fixed point */
+    TIER_REDUCED = 1,   /* No expensive passes, two rounds */
+    TIER_MINIMAL = 2    /* Linear passes only, one round */
+} OptimizationTier;
+
+/* Tier a function was optimized at */
+typedef struct {
+    char *name;
+    long cost;                 /* Estimate from estimate_function_cost */
+    OptimizationTier tier;     /* Cheapest tier any of its passes ran at */
+    int degraded;              /* Lowered by --opt-time-budget */
+    int rounds;
+} FunctionTierStats;
+
+/* Work done by one pass over all its runs */
+typedef struct {
+    const char *name;
+    int runs;
+    int changes;
+    double milliseconds;
+} PassStats;
+
 typedef struct {
     int constants_folded;
     int dead_code_removed;
     int copies_propagated;
     int expressions_simplified;
     int subexpressions_eliminated;
+    int loads_eliminated;
+    int partial_redundancies;
+    int expressions_inserted;
+    int dead_stores_removed;
+    int alias_queries;
+    int alias_no_alias;
+    int alias_must_alias;
+    int branches_threaded;
+    int labels_removed;
+    int arguments_propagated;
+    int functions_specialized;
+    int comparisons_folded;
+    int bounds_checks_eliminated;
     int original_instruction_count;
     int optimized_instruction_count;
+    int pipeline_iterations;
+    int analyses_computed;
+    int analyses_reused;
+    PassStats passes[MAX_PASS_STATS];
+    int pass_count;
+    FunctionTierStats *functions;
+    int function_count;
+    int budget_exceeded;
 } OptimizationStats;
 
 extern OptimizationStats opt_stats;
 void print_optimization_stats(void);
+void print_bounds_check_report(void);
+void print_pass_stats(void);
 
 #endif /* OPTIMIZE_H */
\ No newline at end of file
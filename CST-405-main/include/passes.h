@@ -0,0 +1,60 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+/*
+ * Optimization Pass Manager
+ * CST-405 Compiler Design
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+
+/* Rounds of a pipeline before it is stopped short of a fixed point */
+#define MAX_PIPELINE_ITERATIONS 8
+
+/* Default cost estimates above which a function takes a cheaper tier */
+#define DEFAULT_REDUCED_TIER_COST 250000
+#define DEFAULT_MINIMAL_TIER_COST 25000000
+
+/* How a pass scales with the size of a function */
+typedef enum {
+    PASS_LINEAR = 0,           /* One scan with bounded tables */
+    PASS_DATAFLOW = 1,         /* Iterative bit-vector data flow */
+    PASS_EXPENSIVE = 2         /* Interval data flow, repeated CFG rebuilds */
+} PassCost;
+
+/* A function pass returns how many changes it made to that function;
+   a module pass works on the whole program */
+typedef int (*FunctionPass)(TACInstruction *func_begin);
+typedef int (*ModulePass)(void);
+
+/* Entry of the pass registry */
+typedef struct {
+    const char *name;          /* Name used in -passes= */
+    FunctionPass run_function;
+    ModulePass run_module;     /* Module passes run in the first round only */
+    PassCost cost;
+    const char *description;
+} PassInfo;
+
+/* Tier configuration (set from the command line) */
+extern long reduced_tier_cost;
+extern long minimal_tier_cost;
+extern int opt_time_budget_ms;     /* 0 = unlimited */
+
+/* Pipelines */
+const char *default_pass_pipeline(OptimizationLevel level);
+int validate_pass_pipeline(const char *spec);
+void run_pass_pipeline(const char *spec);
+void print_available_passes(void);
+long estimate_function_cost(TACInstruction *func_begin);
+const char *tier_name(OptimizationTier tier);
+
+/* Analysis cache: valid until a pass reports a change */
+ControlFlowGraph *get_function_cfg(TACInstruction *func_begin);
+ControlFlowGraph *get_function_liveness(TACInstruction *func_begin);
+char **get_escaped_globals(int *count);
+void invalidate_function_analyses(TACInstruction *func_begin);
+void invalidate_analyses(void);
+
+#endif /* PASSES_H */
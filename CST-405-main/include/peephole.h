@@ -0,0 +1,25 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+/*
+ * Machine-Level Peephole Optimization
+ * CST-405 Compiler Design
+ */
+
+#include "machine.h"
+
+/* Peephole pass use, chosen with -f[no-]peephole */
+typedef enum {
+    PEEPHOLE_DEFAULT = 0,          /* On at -O1 and above */
+    PEEPHOLE_ON,
+    PEEPHOLE_OFF
+} PeepholeMode;
+
+extern PeepholeMode peephole_mode;
+
+/* Optimization */
+int peephole_enabled(void);
+int peephole_optimize(MachineFunction *mf);
+void print_peephole_statistics(void);
+
+#endif /* PEEPHOLE_H */
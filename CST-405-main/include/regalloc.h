@@ -0,0 +1,86 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+/*
+ * Register Allocation for the MIPS Back End
+ * CST-405 Compiler Design
+ */
+
+#include "codegen.h"
+#include "cfg.h"
+#include "symtab.h"
+
+/* Registers the allocator may hand out; $t8/$t9 stay free as scratch for
+   spilled values, constants and address arithmetic */
+#define ALLOCATABLE_REGISTER_COUNT 22
+
+/* Register masks (bit n = register $n) */
+#define CALLER_SAVED_MASK  0x0300FFFCu     /* $v0-$v1, $a0-$a3, $t0-$t9 */
+#define CALLEE_SAVED_MASK  0x00FF0000u     /* $s0-$s7 */
+#define SPLIT_MASK         0x0000FF08u     /* $t0-$t7, $v1: only calls clobber them */
+
+/* Allocators selectable with -fregalloc= */
+typedef enum {
+    REGALLOC_DEFAULT = 0,      /* Graph coloring at -O2, linear scan below */
+    REGALLOC_LINEAR,           /* Linear scan over live intervals */
+    REGALLOC_GRAPH             /* Chaitin-Briggs graph coloring */
+} RegisterAllocatorKind;
+
+extern RegisterAllocatorKind register_allocator;
+
+/* Where a value of the function lives */
+#define LOCATION_NONE   -1     /* Not allocated: globals and arrays */
+#define LOCATION_SPILL  -2     /* Frame slot, see spill_slot */
+#define LOCATION_REMAT  -3     /* Constant reloaded with li at each use */
+
+/* A value kept in a caller-saved register that is stored to its frame
+   slot before a call and reloaded after it */
+typedef struct {
+    TACInstruction *call;
+    int value;                 /* Variable index */
+} CallSave;
+
+/* Result of allocating one function */
+typedef struct {
+    ControlFlowGraph *cfg;     /* Owns the variable numbering */
+    const char *method;        /* "graph" or "linear" */
+    int *location;             /* Per variable: register, or LOCATION_* */
+    int *spill_slot;           /* Per variable: frame slot index, or -1 */
+    int *live_start;           /* Per variable: first position of its live interval */
+    int *last_use;             /* Per variable: last position of its live interval */
+    int *rematerializable;     /* Per variable: holds one constant throughout */
+    int *constant;             /* Per variable: that constant */
+    int spill_count;           /* Frame slots used by spills */
+    int spilled_values;        /* Values living in those slots */
+    int rematerialized;        /* Values recomputed instead of spilled */
+    int split;                 /* Values saved around calls instead of spilled */
+    CallSave *call_saves;      /* Stores and reloads around each call */
+    int call_save_count;
+    unsigned int used_mask;    /* Registers holding some value */
+    int values;                /* Variables competing for registers */
+    int moves;                 /* Copies between values and registers */
+    int moves_coalesced;       /* Copies removed by coalescing */
+    int interference_edges;    /* Graph coloring only */
+    int *slot_offset;          /* Per frame slot: byte offset in the local area */
+    char **array_names;        /* Local arrays the function uses */
+    int *array_offset;         /* Their byte offsets in the local area */
+    int array_count;
+    int frame_bytes;           /* Size of the local area */
+    double milliseconds;       /* Time spent allocating */
+} RegisterAllocation;
+
+/* Allocation */
+RegisterAllocation *allocate_registers(TACInstruction *func_begin);
+RegisterAllocation *allocate_registers_graph(TACInstruction *func_begin);
+RegisterAllocation *allocate_registers_linear(TACInstruction *func_begin);
+void free_register_allocation(RegisterAllocation *alloc);
+
+/* Queries used by the code generator */
+int register_of(RegisterAllocation *alloc, char *name);
+int spill_slot_of(RegisterAllocation *alloc, char *name);
+int rematerialized_constant(RegisterAllocation *alloc, char *name, int *value);
+int is_local_array(RegisterAllocation *alloc, char *name);
+int local_array_offset(RegisterAllocation *alloc, char *name);
+void print_register_allocation(RegisterAllocation *alloc);
+
+#endif /* REGALLOC_H */
@@ -0,0 +1,29 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+/*
+ * Instruction Scheduling for the MIPS Back End
+ * CST-405 Compiler Design
+ */
+
+#include "machine.h"
+
+/* Scheduler use, chosen with -f[no-]schedule */
+typedef enum {
+    SCHEDULE_DEFAULT = 0,          /* On at -O2 */
+    SCHEDULE_ON,
+    SCHEDULE_OFF
+} ScheduleMode;
+
+extern ScheduleMode schedule_mode;
+
+/* Longest run of instructions scheduled as one region; longer blocks are
+   cut, which keeps the dependence matrix small */
+#define SCHEDULE_REGION_LIMIT 128
+
+/* Scheduling */
+int scheduling_enabled(void);
+void schedule_function(MachineFunction *mf);
+void print_schedule_statistics(void);
+
+#endif /* SCHEDULE_H */
@@ -0,0 +1,46 @@
+#ifndef SELECT_H
+#define SELECT_H
+
+/*
+ * Tree-Pattern Instruction Selection for the MIPS Back End
+ * CST-405 Compiler Design
+ */
+
+#include "codegen.h"
+#include "regalloc.h"
+
+/* Instruction selectors selectable with -fselect= */
+typedef enum {
+    SELECT_DEFAULT = 0,        /* Tree tiling at -O1 and above, direct below */
+    SELECT_DIRECT,             /* One TAC instruction at a time */
+    SELECT_TREE                /* Minimum-cost tiling of each block's DAG */
+} InstructionSelectorKind;
+
+extern InstructionSelectorKind instruction_selector;
+
+/* A node of a block's expression DAG (defined in select.c) */
+typedef struct TileNode TileNode;
+
+/* Tiling of one function */
+typedef struct {
+    RegisterAllocation *alloc; /* Registers the tiles read and write */
+    TileNode **nodes;          /* Every node, for freeing */
+    int node_count;
+    int node_capacity;
+    TileNode **operations;     /* Nodes of the tiled TAC instructions, in order */
+    int operation_count;
+    int cursor;                /* Next operation to emit */
+    int tiles;                 /* Rules applied */
+    int folded;                /* TAC instructions covered by another's tile */
+    int cost;                  /* Estimated instructions of the tiling */
+    int unfolded_cost;         /* The same, tiling one instruction at a time */
+} Selection;
+
+/* Selection */
+int tree_selection_enabled(void);
+Selection *select_instructions(TACInstruction *func_begin, RegisterAllocation *alloc);
+int emit_selected(Selection *sel, TACInstruction *instr);
+void free_selection(Selection *sel);
+void print_selection(const char *function, Selection *sel, int emitted);
+
+#endif /* SELECT_H */
@@ -42,6 +42,10 @@ void check_return_paths(ASTNode *func_body, DataType return_type);
 void check_array_index(ASTNode *node);
 void check_function_args(SymbolEntry *func, ASTNode *args);
 
+/* Scope resolution for code generation */
+void rename_shadowing_locals(void);
+void rename_locals(Scope *locals, char *func_name);
+
 /* Current function context */
 extern SymbolEntry *current_function;
 
@@ -27,6 +27,7 @@ typedef struct SymbolEntry {
     int size;                  /* Size (for arrays) */
     int param_count;           /* Number of parameters (for functions) */
     struct SymbolEntry *params; /* Parameter list (for functions) */
+    struct Scope *locals;      /* Body scope, kept for code generation (for functions) */
     struct SymbolEntry *next;  /* Next entry in hash chain */
     int line_number;           /* Line where declared */
     int is_used;               /* Flag for unused variable warning */
@@ -51,6 +52,7 @@ extern Scope *global_scope;
 void init_symbol_table(void);
 void enter_scope(void);
 void exit_scope(void);
+Scope *leave_scope(void);
 SymbolEntry *insert_symbol(char *name, SymbolKind kind, DataType type);
 SymbolEntry *lookup_symbol(char *name);
 SymbolEntry *lookup_symbol_in_scope(char *name, Scope *scope);
@@ -17,6 +17,10 @@ if [ $# -eq 0 ]; then
     echo "  -debug      Run with debugging enabled"
     echo "  -step       Step through execution"
     echo
+    echo "Files compiled with -fdelay-slots (.set noreorder) run SPIM with"
+    echo "-delayed_branches and MARS with delayed branching (db). MARS has no"
+    echo "branch-likely instructions: compile for it with -fdelay-slots=mars."
+    echo
     echo "Examples:"
     echo "  $0 examples/hello_mips.s"
     echo "  $0 tests/factorial.s -debug"
@@ -68,10 +72,17 @@ if [ ! -f "$MIPS_FILE" ]; then
     exit 1
 fi
 
+# Code with filled delay slots runs only with delayed branches
+DELAYED_BRANCHES=false
+if grep -q "^\.set noreorder" "$MIPS_FILE"; then
+    DELAYED_BRANCHES=true
+fi
+
 echo "File: $MIPS_FILE"
 echo "Simulator: $SIMULATOR"
 echo "Debug mode: $DEBUG_MODE"
 echo "Step mode: $STEP_MODE"
+echo "Delayed branches: $DELAYED_BRANCHES"
 echo
 
 # Show file info
@@ -100,7 +111,11 @@ case $SIMULATOR in
         if command -v spim >/dev/null 2>&1; then
             if [ "$DEBUG_MODE" = true ]; then
                 echo "Starting SPIM in debug mode..."
-                spim
+                if [ "$DELAYED_BRANCHES" = true ]; then
+                    spim -delayed_branches
+                else
+                    spim
+                fi
                 echo "In SPIM console, type:"
                 echo "  load \"$MIPS_FILE\""
                 echo "  run"
@@ -109,7 +124,11 @@ case $SIMULATOR in
             else
                 echo "Output:"
                 echo "======="
-                spim -file "$MIPS_FILE"
+                if [ "$DELAYED_BRANCHES" = true ]; then
+                    spim -delayed_branches -file "$MIPS_FILE"
+                else
+                    spim -file "$MIPS_FILE"
+                fi
                 echo "======="
             fi
         else
@@ -121,6 +140,9 @@ case $SIMULATOR in
         echo "--- Running with QtSPIM ---"
         if command -v qtspim >/dev/null 2>&1; then
             echo "Launching QtSPIM GUI..."
+            if [ "$DELAYED_BRANCHES" = true ]; then
+                echo "Enable Simulator > Settings > Enable delayed branches"
+            fi
             qtspim "$MIPS_FILE" &
             echo "QtSPIM launched in background"
         else
@@ -132,7 +154,14 @@ case $SIMULATOR in
         echo "--- Running with MARS ---"
         if [ -f "Mars.jar" ]; then
             echo "Running with MARS simulator..."
-            java -jar Mars.jar "$MIPS_FILE"
+            if grep -qE "^[[:space:]]+b(eq|ne|ltz|gez|lez|gtz)l[[:space:]]" "$MIPS_FILE"; then
+                echo "MARS has no branch-likely instructions;"
+                echo "recompile with -fdelay-slots=mars"
+            elif [ "$DELAYED_BRANCHES" = true ]; then
+                java -jar Mars.jar db "$MIPS_FILE"
+            else
+                java -jar Mars.jar "$MIPS_FILE"
+            fi
         else
             echo "MARS not found. Download Mars.jar from:"
             echo "http://courses.missouristate.edu/KenVollmar/mars/"
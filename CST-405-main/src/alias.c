@@ -0,0 +1,168 @@
+/*
+ * Array Alias Analysis Implementation
+ * CST-405 Compiler Design
+ *
+ * Decides which array names of a function may refer to the same storage,
+ * for the passes that reorder or reuse memory operations. C-Minus has no
+ * pointers: an array is a local or a global, or a parameter holding the
+ * address of the first element of an array the caller passed. So:
+ *   - distinct local and global arrays never alias each other
+ *   - a local array whose address never escapes (is never an argument)
+ *     cannot be touched by a callee
+ *   - an array parameter may only be an array that escaped: a global
+ *     passed somewhere in the program, or another parameter, but never
+ *     a local of the function itself, which did not exist at the call
+ * Since every array address is an array's first element, elements at
+ * different offsets from the same index never alias, whatever the arrays.
+ *
+ * Arrays are named as in the TAC, where a local that shadows a global has
+ * been given a name of its own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alias.h"
+#include "optimize.h"
+#include "cfg.h"
+#include "passes.h"
+
+static int same_name(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static int in_list(char **list, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (same_name(list[i], name)) return 1;
+    }
+    return 0;
+}
+
+static void add_escaped(AliasInfo *info, char *name, int *capacity) {
+    if (in_list(info->escaped, info->escaped_count, name)) return;
+    if (info->escaped_count == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 8;
+        info->escaped = (char **)realloc(info->escaped, *capacity * sizeof(char *));
+    }
+    info->escaped[info->escaped_count++] = name;
+}
+
+/* Collect the function's formals, the arguments it passes, and the global
+   arrays passed as arguments anywhere in the program (found once per
+   pipeline run by the pass manager) */
+AliasInfo *compute_alias_info(TACInstruction *func_begin) {
+    AliasInfo *info = (AliasInfo *)calloc(1, sizeof(AliasInfo));
+    TACInstruction *end = find_function_end(func_begin);
+    int capacity = 0;
+
+    info->func_begin = func_begin;
+    for (TACInstruction *instr = func_begin->next; instr != end; instr = instr->next) {
+        if (instr->opcode == TAC_FORMAL) info->parameter_count++;
+    }
+    info->parameters = (char **)malloc((info->parameter_count + 1) * sizeof(char *));
+    info->parameter_count = 0;
+    for (TACInstruction *instr = func_begin->next; instr != end; instr = instr->next) {
+        if (instr->opcode == TAC_FORMAL) info->parameters[info->parameter_count++] = instr->result;
+    }
+
+    int global_count;
+    char **globals = get_escaped_globals(&global_count);
+    for (int i = 0; i < global_count; i++) {
+        add_escaped(info, globals[i], &capacity);
+    }
+    for (TACInstruction *instr = func_begin; instr != end; instr = instr->next) {
+        if (instr->opcode == TAC_PARAM && instr->result && !is_constant(instr->result)) {
+            add_escaped(info, instr->result, &capacity);
+        }
+    }
+    return info;
+}
+
+void free_alias_info(AliasInfo *info) {
+    if (info == NULL) return;
+    free(info->parameters);
+    free(info->escaped);
+    free(info);
+}
+
+/* Kind of an array name in the function */
+ArrayKind array_kind(AliasInfo *info, const char *array) {
+    if (in_list(info->parameters, info->parameter_count, array)) return ARRAY_PARAMETER;
+    if (is_global_name((char *)array)) return ARRAY_GLOBAL;
+    return ARRAY_LOCAL;
+}
+
+static AliasResult classify_arrays(AliasInfo *info, const char *a, const char *b) {
+    if (same_name(a, b)) return MUST_ALIAS;
+
+    ArrayKind ka = array_kind(info, a);
+    ArrayKind kb = array_kind(info, b);
+    if (ka != ARRAY_PARAMETER && kb != ARRAY_PARAMETER) return NO_ALIAS;
+    if (ka == ARRAY_PARAMETER && kb == ARRAY_PARAMETER) return MAY_ALIAS;
+
+    /* A parameter against a local or a global */
+    const char *other = ka == ARRAY_PARAMETER ? b : a;
+    if ((ka == ARRAY_PARAMETER ? kb : ka) == ARRAY_LOCAL) return NO_ALIAS;
+    return in_list(info->escaped, info->escaped_count, other) ? MAY_ALIAS : NO_ALIAS;
+}
+
+static AliasResult count_query(AliasResult result) {
+    opt_stats.alias_queries++;
+    if (result == NO_ALIAS) opt_stats.alias_no_alias++;
+    if (result == MUST_ALIAS) opt_stats.alias_must_alias++;
+    return result;
+}
+
+/* Check if two array names may refer to the same array */
+AliasResult alias_arrays(AliasInfo *info, const char *a, const char *b) {
+    return count_query(classify_arrays(info, a, b));
+}
+
+/* Element of an ARRAY_LOAD or ARRAY_STORE, its index operand taken as
+   the base (or the offset, when constant) */
+MemoryAccess memory_access(TACInstruction *instr) {
+    MemoryAccess access;
+    char *index;
+
+    if (instr->opcode == TAC_ARRAY_LOAD) {
+        access.array = instr->arg1;
+        index = instr->arg2;
+    } else {
+        access.array = instr->result;
+        index = instr->arg1;
+    }
+    access.index.base = is_constant(index) ? NULL : index;
+    access.index.offset = is_constant(index) ? get_constant_value(index) : 0;
+    return access;
+}
+
+/* Check if two array accesses may touch the same element. Indices are
+   compared as base + offset: the caller keeps a base's value the same
+   between the two accesses, as a redefinition of it ends what it knows */
+AliasResult alias_accesses(AliasInfo *info, MemoryAccess *a, MemoryAccess *b) {
+    AliasResult arrays = classify_arrays(info, a->array, b->array);
+    if (arrays == NO_ALIAS) return count_query(NO_ALIAS);
+    if (!same_name(a->index.base, b->index.base)) return count_query(MAY_ALIAS);
+    if (a->index.offset != b->index.offset) return count_query(NO_ALIAS);
+    return count_query(arrays);
+}
+
+/* Check if a call from the function may read or write an array */
+int call_may_access(AliasInfo *info, const char *array) {
+    int result = array_kind(info, array) != ARRAY_LOCAL ||
+                 in_list(info->escaped, info->escaped_count, array);
+    count_query(result ? MAY_ALIAS : NO_ALIAS);
+    return result;
+}
+
+/* Check if a call from the function may read or write an element, or
+   change which element its index names */
+int call_may_touch(AliasInfo *info, MemoryAccess *access) {
+    return call_may_access(info, access->array) || call_may_change(info, access->index.base);
+}
+
+/* Check if a call from the function may change a scalar: callees can
+   write only globals */
+int call_may_change(AliasInfo *info, const char *name) {
+    return name != NULL && is_global_name((char *)name);
+}
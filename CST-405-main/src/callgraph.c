@@ -0,0 +1,173 @@
+/*
+ * Call Graph Construction
+ * CST-405 Compiler Design
+ *
+ * Collects every function and every TAC_CALL with its params, and
+ * records how deeply each call is nested in loops of its caller
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "callgraph.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "globals.h"
+
+/* Create the node for the function starting at begin */
+static FunctionNode *new_function_node(TACInstruction *begin, int index) {
+    FunctionNode *func = (FunctionNode *)calloc(1, sizeof(FunctionNode));
+    func->index = index;
+    func->name = begin->result;
+    func->begin = begin;
+    func->end = find_function_end(begin);
+
+    for (TACInstruction *instr = begin->next; instr && instr != func->end; instr = instr->next) {
+        if (instr->opcode == TAC_FORMAL) {
+            func->formal_count++;
+        }
+        func->instruction_count++;
+    }
+
+    func->formals = (TACInstruction **)malloc((func->formal_count + 1) * sizeof(TACInstruction *));
+    int k = 0;
+    for (TACInstruction *instr = begin->next; instr && instr != func->end; instr = instr->next) {
+        if (instr->opcode == TAC_FORMAL) {
+            func->formals[k++] = instr;
+        }
+    }
+
+    return func;
+}
+
+/* Record a site on its callee */
+static void add_caller(FunctionNode *callee, CallSite *site) {
+    if (callee->caller_count == callee->caller_capacity) {
+        callee->caller_capacity = callee->caller_capacity ? callee->caller_capacity * 2 : 4;
+        callee->callers = (CallSite **)realloc(callee->callers,
+                                               callee->caller_capacity * sizeof(CallSite *));
+    }
+    callee->callers[callee->caller_count++] = site;
+}
+
+/* Collect the call sites of one function, tagging each with its loop depth */
+static void collect_call_sites(CallGraph *graph, FunctionNode *caller, int *site_capacity) {
+    ControlFlowGraph *cfg = build_cfg(caller->begin);
+    TACInstruction **pending = (TACInstruction **)malloc((caller->instruction_count + 1) *
+                                                         sizeof(TACInstruction *));
+    int pending_count = 0;
+
+    compute_loop_depths(cfg);
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            if (instr->opcode == TAC_PARAM) {
+                pending[pending_count++] = instr;
+            } else if (instr->opcode == TAC_CALL) {
+                CallSite *site = (CallSite *)calloc(1, sizeof(CallSite));
+                int n = instr->arg2 ? atoi(instr->arg2) : 0;
+
+                /* The last n params belong to this call */
+                if (n > pending_count) n = pending_count;
+                site->call = instr;
+                site->arg_count = n;
+                site->params = (TACInstruction **)malloc((n + 1) * sizeof(TACInstruction *));
+                for (int i = 0; i < n; i++) {
+                    site->params[i] = pending[pending_count - n + i];
+                }
+                pending_count -= n;
+
+                site->caller = caller;
+                site->callee = call_graph_function(graph, instr->arg1);
+                site->loop_depth = block->loop_depth;
+                if (site->callee) {
+                    add_caller(site->callee, site);
+                }
+
+                if (graph->site_count == *site_capacity) {
+                    *site_capacity *= 2;
+                    graph->sites = (CallSite **)realloc(graph->sites,
+                                                        *site_capacity * sizeof(CallSite *));
+                }
+                graph->sites[graph->site_count++] = site;
+            }
+            if (instr == block->end) break;
+        }
+    }
+
+    free(pending);
+    free_cfg(cfg);
+}
+
+/* Build the call graph of the current TAC list */
+CallGraph *build_call_graph(void) {
+    CallGraph *graph = (CallGraph *)calloc(1, sizeof(CallGraph));
+    int capacity = 8;
+    graph->functions = (FunctionNode **)malloc(capacity * sizeof(FunctionNode *));
+
+    for (TACInstruction *instr = get_tac_list(); instr; instr = instr->next) {
+        graph->instruction_count++;
+        if (instr->opcode != TAC_FUNC_BEGIN) continue;
+
+        if (graph->function_count == capacity) {
+            capacity *= 2;
+            graph->functions = (FunctionNode **)realloc(graph->functions,
+                                                        capacity * sizeof(FunctionNode *));
+        }
+        graph->functions[graph->function_count] = new_function_node(instr, graph->function_count);
+        graph->function_count++;
+    }
+
+    /* Calls may refer to functions defined later, so link in a second pass */
+    int site_capacity = 16;
+    graph->sites = (CallSite **)malloc(site_capacity * sizeof(CallSite *));
+    for (int i = 0; i < graph->function_count; i++) {
+        collect_call_sites(graph, graph->functions[i], &site_capacity);
+    }
+
+    return graph;
+}
+
+/* Free a call graph (the TAC itself is untouched) */
+void free_call_graph(CallGraph *graph) {
+    if (graph == NULL) return;
+
+    for (int i = 0; i < graph->site_count; i++) {
+        free(graph->sites[i]->params);
+        free(graph->sites[i]);
+    }
+    for (int i = 0; i < graph->function_count; i++) {
+        free(graph->functions[i]->formals);
+        free(graph->functions[i]->callers);
+        free(graph->functions[i]);
+    }
+    free(graph->sites);
+    free(graph->functions);
+    free(graph);
+}
+
+/* Find a function by name */
+FunctionNode *call_graph_function(CallGraph *graph, char *name) {
+    if (name == NULL) return NULL;
+
+    for (int i = 0; i < graph->function_count; i++) {
+        if (strcmp(graph->functions[i]->name, name) == 0) {
+            return graph->functions[i];
+        }
+    }
+    return NULL;
+}
+
+/* Position of a formal parameter by name, or -1 */
+int formal_index(FunctionNode *func, char *name) {
+    if (name == NULL) return -1;
+
+    for (int i = 0; i < func->formal_count; i++) {
+        if (strcmp(func->formals[i]->result, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,542 @@
+/*
+ * Control Flow Graph Construction
+ * CST-405 Compiler Design
+ *
+ * Partitions the TAC of one function into basic blocks and links them
+ * with fall-through and jump edges, and computes the analyses built on
+ * top of them: dominators, loop depths and live variables
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cfg.h"
+#include "codegen.h"
+#include "optimize.h"
+#include "globals.h"
+
+/* Check if instruction is any jump */
+int is_jump(TACInstruction *instr) {
+    return instr->opcode == TAC_GOTO || is_conditional_jump(instr);
+}
+
+/* Check if instruction is a conditional jump */
+int is_conditional_jump(TACInstruction *instr) {
+    return instr->opcode == TAC_IF_TRUE || instr->opcode == TAC_IF_FALSE;
+}
+
+/* Check if instruction must be the last of its block */
+int ends_block(TACInstruction *instr) {
+    return is_jump(instr) || instr->opcode == TAC_RETURN;
+}
+
+/* Find the END_FUNC matching a BEGIN_FUNC */
+TACInstruction *find_function_end(TACInstruction *func_begin) {
+    TACInstruction *instr = func_begin->next;
+    while (instr && instr->opcode != TAC_FUNC_END) {
+        instr = instr->next;
+    }
+    return instr;
+}
+
+/* Allocate an empty block */
+static BasicBlock *new_block(int id) {
+    BasicBlock *block = (BasicBlock *)calloc(1, sizeof(BasicBlock));
+    block->id = id;
+    block->successors = (BasicBlock **)calloc(2, sizeof(BasicBlock *));
+    return block;
+}
+
+/* Record edge from -> to */
+static void add_edge(BasicBlock *from, BasicBlock *to) {
+    if (to == NULL) return;
+    
+    from->successors[from->succ_count++] = to;
+    
+    if (to->pred_count == to->pred_capacity) {
+        to->pred_capacity = to->pred_capacity ? to->pred_capacity * 2 : 2;
+        to->predecessors = (BasicBlock **)realloc(to->predecessors,
+                                                  to->pred_capacity * sizeof(BasicBlock *));
+    }
+    to->predecessors[to->pred_count++] = from;
+}
+
+/* Build the CFG of the function starting at func_begin */
+ControlFlowGraph *build_cfg(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = (ControlFlowGraph *)calloc(1, sizeof(ControlFlowGraph));
+    cfg->func_begin = func_begin;
+    cfg->func_end = find_function_end(func_begin);
+    cfg->label_limit = tac_context->label_count;
+    cfg->label_blocks = (BasicBlock **)calloc(cfg->label_limit + 1, sizeof(BasicBlock *));
+    
+    /* Partition into blocks: a block starts at the first instruction, at a
+       label that does not follow another label, and after any jump/return */
+    int capacity = 16;
+    cfg->blocks = (BasicBlock **)malloc(capacity * sizeof(BasicBlock *));
+    
+    BasicBlock *current = NULL;
+    TACInstruction *prev = func_begin;
+    for (TACInstruction *instr = func_begin->next;
+         instr && instr != cfg->func_end; prev = instr, instr = instr->next) {
+        int leader = (current == NULL) ||
+                     (instr->opcode == TAC_LABEL && prev->opcode != TAC_LABEL);
+        
+        if (leader) {
+            if (cfg->block_count == capacity) {
+                capacity *= 2;
+                cfg->blocks = (BasicBlock **)realloc(cfg->blocks,
+                                                     capacity * sizeof(BasicBlock *));
+            }
+            current = new_block(cfg->block_count);
+            current->start = instr;
+            current->before = prev;
+            cfg->blocks[cfg->block_count++] = current;
+        }
+        
+        current->end = instr;
+        if (instr->opcode == TAC_LABEL && instr->label >= 0 &&
+            instr->label < cfg->label_limit) {
+            cfg->label_blocks[instr->label] = current;
+        }
+        
+        if (ends_block(instr)) {
+            current = NULL;
+        }
+    }
+    
+    /* Link edges */
+    for (int i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        BasicBlock *next = (i + 1 < cfg->block_count) ? cfg->blocks[i + 1] : NULL;
+        TACInstruction *last = block->end;
+        
+        if (last->opcode == TAC_RETURN) {
+            continue;
+        }
+        if (last->opcode != TAC_GOTO) {
+            block->fall_through = next;
+            add_edge(block, next);
+        }
+        if (is_jump(last)) {
+            block->jump_target = cfg_block_for_label(cfg, last->label);
+            add_edge(block, block->jump_target);
+        }
+    }
+    
+    return cfg;
+}
+
+/* Free a CFG (the TAC itself is untouched) */
+void free_cfg(ControlFlowGraph *cfg) {
+    if (cfg == NULL) return;
+    
+    for (int i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        free(block->predecessors);
+        free(block->successors);
+        free(block->live_in);
+        free(block->live_out);
+        free(block->gen);
+        free(block->kill);
+        free(block);
+    }
+    if (cfg->variables) {
+        for (int i = 0; i < cfg->variables->count; i++) {
+            free(cfg->variables->names[i]);
+        }
+        free(cfg->variables->names);
+        free(cfg->variables->is_global);
+        free(cfg->variables->slots);
+        free(cfg->variables);
+    }
+    free(cfg->blocks);
+    free(cfg->label_blocks);
+    free(cfg);
+}
+
+/* Find the block that holds a label */
+BasicBlock *cfg_block_for_label(ControlFlowGraph *cfg, int label) {
+    if (label < 0 || label >= cfg->label_limit) return NULL;
+    return cfg->label_blocks[label];
+}
+
+/* Check if control can leave the function from the end of a block: a
+   return, or falling off the last block (a conditional branch there
+   falls through to END_FUNC) */
+int block_exits_function(BasicBlock *block) {
+    return block->succ_count == 0 ||
+           (block->fall_through == NULL && block->end->opcode != TAC_GOTO &&
+            block->end->opcode != TAC_RETURN);
+}
+
+/* Mark every block reachable from the entry */
+void mark_reachable_blocks(ControlFlowGraph *cfg) {
+    if (cfg->block_count == 0) return;
+    
+    BasicBlock **worklist = (BasicBlock **)malloc(cfg->block_count * sizeof(BasicBlock *));
+    int top = 0;
+    
+    for (int i = 0; i < cfg->block_count; i++) {
+        cfg->blocks[i]->reachable = 0;
+    }
+    
+    cfg->blocks[0]->reachable = 1;
+    worklist[top++] = cfg->blocks[0];
+    while (top > 0) {
+        BasicBlock *block = worklist[--top];
+        for (int i = 0; i < block->succ_count; i++) {
+            BasicBlock *succ = block->successors[i];
+            if (!succ->reachable) {
+                succ->reachable = 1;
+                worklist[top++] = succ;
+            }
+        }
+    }
+    
+    free(worklist);
+}
+
+/* Walk two blocks up the dominator tree until they meet */
+static BasicBlock *intersect_dominators(BasicBlock *a, BasicBlock *b) {
+    while (a != b) {
+        while (a->rpo_number > b->rpo_number) a = a->idom;
+        while (b->rpo_number > a->rpo_number) b = b->idom;
+    }
+    return a;
+}
+
+/* Compute immediate dominators (Cooper, Harvey and Kennedy's iterative
+   algorithm over reverse postorder); unreachable blocks get no idom */
+void compute_dominators(ControlFlowGraph *cfg) {
+    if (cfg->block_count == 0) return;
+    
+    int n = cfg->block_count;
+    BasicBlock **order = (BasicBlock **)malloc(n * sizeof(BasicBlock *));
+    BasicBlock **stack = (BasicBlock **)malloc(n * sizeof(BasicBlock *));
+    int *next_succ = (int *)calloc(n, sizeof(int));
+    int *visited = (int *)calloc(n, sizeof(int));
+    int count = 0, top = 0;
+    
+    for (int i = 0; i < n; i++) {
+        cfg->blocks[i]->idom = NULL;
+        cfg->blocks[i]->rpo_number = -1;
+    }
+    
+    /* Iterative depth-first search recording postorder */
+    stack[top++] = cfg->blocks[0];
+    visited[0] = 1;
+    while (top > 0) {
+        BasicBlock *block = stack[top - 1];
+        if (next_succ[block->id] < block->succ_count) {
+            BasicBlock *succ = block->successors[next_succ[block->id]++];
+            if (!visited[succ->id]) {
+                visited[succ->id] = 1;
+                stack[top++] = succ;
+            }
+        } else {
+            order[count++] = block;
+            top--;
+        }
+    }
+    
+    /* Reverse into reverse postorder */
+    for (int i = 0; i < count / 2; i++) {
+        BasicBlock *tmp = order[i];
+        order[i] = order[count - 1 - i];
+        order[count - 1 - i] = tmp;
+    }
+    for (int i = 0; i < count; i++) {
+        order[i]->rpo_number = i;
+    }
+    
+    BasicBlock *entry = order[0];
+    entry->idom = entry;
+    
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < count; i++) {
+            BasicBlock *block = order[i];
+            BasicBlock *new_idom = NULL;
+            
+            for (int j = 0; j < block->pred_count; j++) {
+                BasicBlock *pred = block->predecessors[j];
+                if (pred->idom == NULL) continue;
+                new_idom = new_idom ? intersect_dominators(pred, new_idom) : pred;
+            }
+            
+            if (new_idom != block->idom) {
+                block->idom = new_idom;
+                changed = 1;
+            }
+        }
+    }
+    
+    free(order);
+    free(stack);
+    free(next_succ);
+    free(visited);
+}
+
+/* Check if block a dominates block b (requires compute_dominators) */
+int dominates(BasicBlock *a, BasicBlock *b) {
+    if (a->rpo_number < 0 || b->rpo_number < 0) return 0;
+    
+    while (b != a) {
+        if (b->idom == b) return 0;
+        b = b->idom;
+    }
+    return 1;
+}
+
+/* Compute the natural loop nesting depth of every block: each edge to a
+   dominating header closes a loop whose body is everything that reaches
+   the edge's source without passing through the header */
+void compute_loop_depths(ControlFlowGraph *cfg) {
+    compute_dominators(cfg);
+    
+    int n = cfg->block_count;
+    int *in_loop = (int *)malloc(n * sizeof(int));
+    BasicBlock **worklist = (BasicBlock **)malloc(n * sizeof(BasicBlock *));
+    
+    for (int i = 0; i < n; i++) {
+        cfg->blocks[i]->loop_depth = 0;
+    }
+    
+    for (int h = 0; h < n; h++) {
+        BasicBlock *header = cfg->blocks[h];
+        int top = 0, is_header = 0;
+        
+        memset(in_loop, 0, n * sizeof(int));
+        in_loop[header->id] = 1;
+        
+        /* Union the bodies of all back edges into this header */
+        for (int i = 0; i < header->pred_count; i++) {
+            BasicBlock *latch = header->predecessors[i];
+            if (!dominates(header, latch)) continue;
+            
+            is_header = 1;
+            if (!in_loop[latch->id]) {
+                in_loop[latch->id] = 1;
+                worklist[top++] = latch;
+            }
+        }
+        while (top > 0) {
+            BasicBlock *block = worklist[--top];
+            for (int i = 0; i < block->pred_count; i++) {
+                BasicBlock *pred = block->predecessors[i];
+                if (!in_loop[pred->id] && pred->rpo_number >= 0) {
+                    in_loop[pred->id] = 1;
+                    worklist[top++] = pred;
+                }
+            }
+        }
+        
+        if (is_header) {
+            for (int i = 0; i < n; i++) {
+                if (in_loop[i]) cfg->blocks[i]->loop_depth++;
+            }
+        }
+    }
+    
+    free(in_loop);
+    free(worklist);
+}
+
+/* String hash for the variable table */
+static unsigned int hash_name(char *name) {
+    unsigned int h = 5381;
+    while (*name) h = h * 33 + (unsigned char)*name++;
+    return h;
+}
+
+/* Index of a variable, or -1 */
+int variable_index(VariableTable *vars, char *name) {
+    if (name == NULL || is_constant(name)) return -1;
+
+    unsigned int slot = hash_name(name) & (vars->slot_count - 1);
+    while (vars->slots[slot]) {
+        int index = vars->slots[slot] - 1;
+        if (strcmp(vars->names[index], name) == 0) return index;
+        slot = (slot + 1) & (vars->slot_count - 1);
+    }
+    return -1;
+}
+
+/* Add a variable if it is not already known */
+static void add_variable(VariableTable *vars, char *name) {
+    if (name == NULL || is_constant(name) || variable_index(vars, name) >= 0) return;
+
+    if (vars->count == vars->capacity) {
+        vars->capacity *= 2;
+        vars->names = (char **)realloc(vars->names, vars->capacity * sizeof(char *));
+        vars->is_global = (int *)realloc(vars->is_global, vars->capacity * sizeof(int));
+    }
+    /* Copied: passes rewrite operand strings while the table is in use */
+    vars->names[vars->count] = copy_string(name);
+    vars->is_global[vars->count] = is_global_name(name);
+
+    unsigned int slot = hash_name(name) & (vars->slot_count - 1);
+    while (vars->slots[slot]) {
+        slot = (slot + 1) & (vars->slot_count - 1);
+    }
+    vars->slots[slot] = ++vars->count;
+}
+
+/* Number the scalar operands of the function (array names are skipped) */
+VariableTable *cfg_variables(ControlFlowGraph *cfg) {
+    if (cfg->variables) return cfg->variables;
+
+    VariableTable *vars = (VariableTable *)calloc(1, sizeof(VariableTable));
+    int size = 0;
+
+    for (TACInstruction *instr = cfg->func_begin->next; instr != cfg->func_end;
+         instr = instr->next) {
+        size++;
+    }
+
+    vars->capacity = 16;
+    vars->names = (char **)malloc(vars->capacity * sizeof(char *));
+    vars->is_global = (int *)malloc(vars->capacity * sizeof(int));
+    vars->slot_count = 16;
+    while (vars->slot_count < 6 * size + 16) vars->slot_count *= 2;
+    vars->slots = (int *)calloc(vars->slot_count, sizeof(int));
+
+    for (TACInstruction *instr = cfg->func_begin->next; instr != cfg->func_end;
+         instr = instr->next) {
+        switch (instr->opcode) {
+            case TAC_ARRAY_LOAD:
+                add_variable(vars, instr->result);
+                add_variable(vars, instr->arg2);
+                break;
+            case TAC_ARRAY_STORE:
+            case TAC_BOUNDS_CHECK:
+                add_variable(vars, instr->arg1);
+                add_variable(vars, instr->arg2);
+                break;
+            case TAC_CALL:
+                add_variable(vars, instr->result);
+                break;
+            case TAC_LABEL: case TAC_GOTO:
+                break;
+            default:
+                add_variable(vars, instr->result);
+                add_variable(vars, instr->arg1);
+                add_variable(vars, instr->arg2);
+                break;
+        }
+    }
+
+    cfg->variables = vars;
+    return vars;
+}
+
+/* Bit vector helpers; index -1 (not a variable) is ignored */
+int bit_is_set(unsigned int *set, int index) {
+    return index >= 0 && ((set[index / 32] >> (index % 32)) & 1);
+}
+
+void set_bit(unsigned int *set, int index) {
+    if (index >= 0) set[index / 32] |= 1u << (index % 32);
+}
+
+void clear_bit(unsigned int *set, int index) {
+    if (index >= 0) set[index / 32] &= ~(1u << (index % 32));
+}
+
+/* Add the globals to a set: callees and the caller may read them */
+static void add_globals(VariableTable *vars, unsigned int *set) {
+    for (int i = 0; i < vars->count; i++) {
+        if (vars->is_global[i]) set_bit(set, i);
+    }
+}
+
+/* Add the scalars an instruction reads */
+static void add_uses(VariableTable *vars, unsigned int *set, TACInstruction *instr) {
+    switch (instr->opcode) {
+        case TAC_LABEL: case TAC_GOTO:
+            return;
+        case TAC_CALL:
+            add_globals(vars, set);
+            return;
+        case TAC_RETURN:
+            add_globals(vars, set);
+            break;
+        default:
+            break;
+    }
+
+    set_bit(set, variable_index(vars, instr->arg1));
+    set_bit(set, variable_index(vars, instr->arg2));
+    if (uses_result(instr)) {
+        set_bit(set, variable_index(vars, instr->result));
+    }
+}
+
+/* Step a live set backward over one instruction */
+void update_live_set(ControlFlowGraph *cfg, unsigned int *live, TACInstruction *instr) {
+    VariableTable *vars = cfg_variables(cfg);
+
+    if (defines_result(instr)) {
+        clear_bit(live, variable_index(vars, instr->result));
+    }
+    add_uses(vars, live, instr);
+}
+
+/* Backward data flow: live_out is the union of the successors' live_in
+   (the globals at exits), live_in = gen | (live_out & ~kill) */
+void compute_liveness(ControlFlowGraph *cfg) {
+    if (cfg->live_words > 0) return;
+
+    VariableTable *vars = cfg_variables(cfg);
+    int words = vars->count / 32 + 1;
+    unsigned int *uses = (unsigned int *)calloc(words, sizeof(unsigned int));
+    cfg->live_words = words;
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        block->live_in = (unsigned int *)calloc(words, sizeof(unsigned int));
+        block->live_out = (unsigned int *)calloc(words, sizeof(unsigned int));
+        block->gen = (unsigned int *)calloc(words, sizeof(unsigned int));
+        block->kill = (unsigned int *)calloc(words, sizeof(unsigned int));
+
+        /* A use counts for gen only if no earlier instruction defined it */
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            memset(uses, 0, words * sizeof(unsigned int));
+            add_uses(vars, uses, instr);
+            for (int w = 0; w < words; w++) {
+                block->gen[w] |= uses[w] & ~block->kill[w];
+            }
+            if (defines_result(instr)) {
+                set_bit(block->kill, variable_index(vars, instr->result));
+            }
+            if (instr == block->end) break;
+        }
+
+        if (block_exits_function(block)) {
+            add_globals(vars, block->live_out);
+        }
+    }
+    free(uses);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int b = cfg->block_count - 1; b >= 0; b--) {
+            BasicBlock *block = cfg->blocks[b];
+
+            for (int s = 0; s < block->succ_count; s++) {
+                for (int w = 0; w < words; w++) {
+                    block->live_out[w] |= block->successors[s]->live_in[w];
+                }
+            }
+            for (int w = 0; w < words; w++) {
+                unsigned int in = block->gen[w] | (block->live_out[w] & ~block->kill[w]);
+                if (in != block->live_in[w]) {
+                    block->live_in[w] = in;
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
@@ -76,6 +76,16 @@ TACInstruction *gen_tac_node(ASTNode *node) {
             }
             break;
             
+        /* Expression statements reach here as bare expressions */
+        case NODE_ASSIGN:
+        case NODE_CALL:
+        case NODE_BINARY_OP:
+        case NODE_ID:
+        case NODE_ARRAY_ACCESS:
+        case NODE_NUM:
+            gen_tac_expression(node);
+            break;
+            
         default:
             gen_tac_node(node->left);
             gen_tac_node(node->right);
@@ -93,6 +103,9 @@ void gen_tac_func_decl(ASTNode *node) {
     /* Emit function begin */
     emit_tac(create_tac(TAC_FUNC_BEGIN, func_name, NULL, NULL));
     
+    /* Name the incoming parameters in declaration order */
+    gen_tac_formals(node->left);
+    
     /* Generate code for function body */
     gen_tac_node(node->right);
     
@@ -100,6 +113,18 @@ void gen_tac_func_decl(ASTNode *node) {
     emit_tac(create_tac(TAC_FUNC_END, func_name, NULL, NULL));
 }
 
+/* Emit one formal per parameter (param_list is left-recursive) */
+void gen_tac_formals(ASTNode *params) {
+    if (params == NULL) return;
+    
+    if (params->node_type == NODE_PARAM_LIST) {
+        gen_tac_formals(params->left);
+        gen_tac_formals(params->right);
+    } else if (params->node_type == NODE_PARAM) {
+        emit_tac(create_tac(TAC_FORMAL, gen_tac_name(params), NULL, NULL));
+    }
+}
+
 /* Generate TAC for variable declaration */
 void gen_tac_var_decl(ASTNode *node) {
     /* Variable declarations don't generate code in basic TAC */
@@ -178,12 +203,13 @@ char *gen_tac_assignment(ASTNode *node) {
     
     if (node->left->node_type == NODE_ARRAY_ACCESS) {
         /* Array assignment: a[i] = value */
-        char *array = node->left->value.string_val;
+        char *array = gen_tac_name(node->left);
         char *index = gen_tac_expression(node->left->left);
+        gen_tac_bounds_check(node->left, index);
         emit_tac(create_tac(TAC_ARRAY_STORE, array, index, value));
     } else {
         /* Simple assignment: x = value */
-        char *var = node->left->value.string_val;
+        char *var = gen_tac_name(node->left);
         emit_tac(create_tac(TAC_ASSIGN, var, value, NULL));
     }
     
@@ -194,37 +220,68 @@ char *gen_tac_assignment(ASTNode *node) {
 char *gen_tac_var(ASTNode *node) {
     if (node->node_type == NODE_ARRAY_ACCESS) {
         /* Array access: t = a[i] */
-        char *array = node->value.string_val;
+        char *array = gen_tac_name(node);
         char *index = gen_tac_expression(node->left);
+        gen_tac_bounds_check(node, index);
         char *temp = new_temp();
         emit_tac(create_tac(TAC_ARRAY_LOAD, temp, array, index));
         return temp;
     } else {
         /* Simple variable */
-        return copy_string(node->value.string_val);
+        return copy_string(gen_tac_name(node));
+    }
+}
+
+/* TAC name of a variable, array or parameter: its symbol's name, which
+   semantic analysis made unique when a local shadows a global */
+char *gen_tac_name(ASTNode *node) {
+    SymbolEntry *symbol = (SymbolEntry *)node->symbol;
+    return symbol ? symbol->name : node->value.string_val;
+}
+
+/* Guard an array access with -fbounds-check; only arrays with a declared
+   size can be checked (array parameters carry no length) */
+void gen_tac_bounds_check(ASTNode *access, char *index) {
+    SymbolEntry *symbol = (SymbolEntry *)access->symbol;
+    
+    if (!bounds_checking || symbol == NULL || symbol->kind != SYMBOL_ARRAY ||
+        symbol->size <= 0) {
+        return;
     }
+    
+    char *size = make_string("%d", symbol->size);
+    emit_tac(create_tac(TAC_BOUNDS_CHECK, gen_tac_name(access), index, size));
+    free(size);
 }
 
 /* Generate TAC for function call */
 char *gen_tac_call(ASTNode *node) {
     char *func_name = node->value.string_val;
     
-    /* Generate code for arguments */
-    ASTNode *arg = node->left;
+    /* Collect arguments (arg_list is left-recursive, last argument on top) */
     int arg_count = 0;
-    while (arg) {
-        char *arg_value;
-        if (arg->node_type == NODE_ARG_LIST) {
-            arg_value = gen_tac_expression(arg->right);
-            arg = arg->left;
-        } else {
-            arg_value = gen_tac_expression(arg);
-            arg = NULL;
-        }
-        emit_tac(create_tac(TAC_PARAM, arg_value, NULL, NULL));
+    for (ASTNode *arg = node->left; arg; arg = (arg->node_type == NODE_ARG_LIST) ? arg->left : NULL) {
         arg_count++;
     }
     
+    ASTNode **args = (ASTNode **)malloc((arg_count > 0 ? arg_count : 1) * sizeof(ASTNode *));
+    int i = arg_count;
+    for (ASTNode *arg = node->left; arg; arg = (arg->node_type == NODE_ARG_LIST) ? arg->left : NULL) {
+        args[--i] = (arg->node_type == NODE_ARG_LIST) ? arg->right : arg;
+    }
+    
+    /* Evaluate all arguments before emitting any params so that nested
+       calls cannot interleave their params with ours */
+    char **values = (char **)malloc((arg_count > 0 ? arg_count : 1) * sizeof(char *));
+    for (i = 0; i < arg_count; i++) {
+        values[i] = gen_tac_expression(args[i]);
+    }
+    for (i = 0; i < arg_count; i++) {
+        emit_tac(create_tac(TAC_PARAM, values[i], NULL, NULL));
+    }
+    free(values);
+    free(args);
+    
     /* Generate call instruction */
     char *result = NULL;
     if (strcmp(func_name, "output") != 0) {
@@ -443,6 +500,12 @@ void print_tac_instruction(TACInstruction *instr) {
         case TAC_FUNC_END:
             printf("END_FUNC %s\n\n", instr->result);
             break;
+        case TAC_FORMAL:
+            printf("    formal %s\n", instr->result);
+            break;
+        case TAC_BOUNDS_CHECK:
+            printf("    bounds_check %s, %s, %s\n", instr->result, instr->arg1, instr->arg2);
+            break;
         default:
             printf("    UNKNOWN\n");
     }
@@ -473,4 +536,40 @@ void set_tac_list(TACInstruction *list) {
         tail = tail->next;
     }
     tac_context->tail = tail;
+}
+
+/* Link instr into the list directly after pos */
+void insert_tac_after(TACInstruction *pos, TACInstruction *instr) {
+    instr->next = pos->next;
+    pos->next = instr;
+    if (tac_context->tail == pos) {
+        tac_context->tail = instr;
+    }
+}
+
+/* Unlink and free the instruction following prev */
+void remove_tac_after(TACInstruction *prev) {
+    TACInstruction *victim = prev->next;
+    if (victim == NULL) return;
+    
+    prev->next = victim->next;
+    if (tac_context->tail == victim) {
+        tac_context->tail = prev;
+    }
+    free_tac_instruction(victim);
+}
+
+/* Duplicate a single instruction (not linked into any list) */
+TACInstruction *copy_tac(TACInstruction *instr) {
+    TACInstruction *copy = create_tac(instr->opcode, instr->result, instr->arg1, instr->arg2);
+    copy->label = instr->label;
+    return copy;
+}
+
+/* Free a single instruction and its operands */
+void free_tac_instruction(TACInstruction *instr) {
+    free(instr->result);
+    free(instr->arg1);
+    free(instr->arg2);
+    free(instr);
 }
\ No newline at end of file
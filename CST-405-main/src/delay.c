@@ -0,0 +1,413 @@
+/*
+ * Branch Delay Slot Filling Implementation
+ * CST-405 Compiler Design
+ *
+ * With -fdelay-slots the program is assembled under .set noreorder, where
+ * the instruction after each jump, call and branch (its delay slot) runs
+ * before control moves on. Each slot is filled with, in order:
+ *   - an instruction from before the transfer that nothing between it and
+ *     the transfer depends on, which then runs on every path as before
+ *   - a copy of the first instruction at the target, with the transfer
+ *     retargeted past it; a conditional branch becomes its branch-likely
+ *     form, whose slot is annulled when the branch is not taken
+ *   - the first instruction of the fall-through path, when it cannot trap
+ *     and the register it writes is dead at the target
+ * or with a nop. Backward branches, mostly loop back edges that are
+ * usually taken, try the target before the fall-through. MARS has no
+ * branch-likely instructions, so for -fdelay-slots=mars a conditional
+ * branch never takes a copy from its target
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delay.h"
+#include "mips.h"
+#include "globals.h"
+
+/* Registers live when a function returns: the result, the callee-saved
+   registers and $gp, $sp, $fp and $ra */
+#define RETURN_LIVE 0xF0FF000Cull
+#define ALL_LIVE (~0ull)
+#define BIT(r) (1ull << (r))
+
+/* Where a slot's instruction came from */
+typedef enum {
+    SLOT_NOP = 0,
+    SLOT_BEFORE,
+    SLOT_TARGET,
+    SLOT_FALL_THROUGH,
+    SLOT_SOURCES
+} SlotSource;
+
+/* The function being filled */
+typedef struct {
+    MachineFunction *mf;
+    RegisterMask *live;        /* Registers live on reaching each entry */
+    int *target;               /* Entry of a jump or branch's label, or -1 */
+    int *slot;                 /* Instruction placed in a transfer's slot, or -1 */
+    int *moved;                /* Moved into a slot, so dropped where it was */
+    int *pinned;               /* Copied into a slot from a target, so it stays */
+    const char **label_after;  /* Label to add after a copied instruction */
+} DelayContext;
+
+DelaySlotTarget delay_slot_target = DELAY_SLOTS_SPIM;
+
+/* Statistics over the program */
+static int slots_seen = 0;
+static int slots_filled[SLOT_SOURCES];
+
+static int has_delay_slot(MachineOpcode op) {
+    return op == MOP_J || op == MOP_JAL || op == MOP_JR || is_conditional_branch(op);
+}
+
+/* Check if an instruction assembles to one machine word, as a slot needs;
+   macros such as la, sle or an lw of a global do not, and div may be
+   expanded with a divide-by-zero check */
+static int fits_slot(MachineInstr *mi) {
+    MachineOperand *last = &mi->operand[2];
+
+    switch (mi->op) {
+        case MOP_ADD: case MOP_ADDU: case MOP_SUB: case MOP_SUBU: case MOP_MUL:
+        case MOP_XOR: case MOP_SLT: case MOP_SLTU:
+            return last->kind == MO_REG;
+        case MOP_ADDI: case MOP_ADDIU: case MOP_SLTI: case MOP_SLTIU:
+            return last->kind == MO_IMM && fits_immediate(last->value);
+        case MOP_XORI: case MOP_ORI:
+            return last->kind == MO_IMM && fits_unsigned_immediate(last->value);
+        case MOP_SLL: case MOP_SRL: case MOP_SRA:
+            return last->kind == MO_IMM;
+        case MOP_LUI:
+            return fits_unsigned_immediate(mi->operand[1].value);
+        case MOP_LI:
+            return fits_immediate(mi->operand[1].value) ||
+                   fits_unsigned_immediate(mi->operand[1].value);
+        case MOP_MOVE:
+        case MOP_MULT:
+        case MOP_MFHI:
+        case MOP_MFLO:
+            return 1;
+        case MOP_LW:
+        case MOP_SW:
+            return mi->operand[1].symbol == NULL && mi->operand[1].reg >= 0 &&
+                   fits_immediate(mi->operand[1].value);
+        default:
+            return 0;
+    }
+}
+
+/* Check if an instruction may also run on a path that never asked for it:
+   add, addi and sub trap on overflow, a load on a bad address, and a
+   store changes memory */
+static int is_speculable(MachineInstr *mi) {
+    switch (mi->op) {
+        case MOP_ADD:
+        case MOP_ADDI:
+        case MOP_SUB:
+        case MOP_LW:
+        case MOP_SW:
+            return 0;
+        default:
+            return fits_slot(mi);
+    }
+}
+
+/* Check if instruction i must stay before the later instruction k */
+static int conflicts(MachineInstr *i, MachineInstr *k) {
+    RegisterMask i_defs = machine_defs(i);
+    RegisterMask k_defs = machine_defs(k);
+    int i_memory = i->op == MOP_LW || i->op == MOP_SW;
+    int k_memory = k->op == MOP_LW || k->op == MOP_SW;
+
+    if (i_defs & (machine_uses(k) | k_defs)) return 1;
+    if (machine_uses(i) & k_defs) return 1;
+    if (i_memory && k_memory && (i->op == MOP_SW || k->op == MOP_SW)) {
+        return machine_may_alias(&i->operand[1], &k->operand[1]);
+    }
+    return 0;
+}
+
+/* Check if instruction i must stay before transfer b. A transfer reads its
+   registers before the slot runs, and a call writes $ra; reading the
+   arguments and clobbering the temporaries happen in the callee, after */
+static int conflicts_with_transfer(MachineInstr *i, MachineInstr *b) {
+    if (b->op == MOP_JAL) {
+        return ((machine_defs(i) | machine_uses(i)) & BIT(31)) != 0;
+    }
+    return (machine_defs(i) & machine_uses(b)) != 0;
+}
+
+/* Entry of a label in the function, or -1 */
+static int label_entry(MachineFunction *mf, MachineOperand *label) {
+    for (int i = 0; i < mf->count; i++) {
+        MachineInstr *mi = &mf->code[i];
+        if (mi->op == MOP_LABEL && machine_same_label(&mi->operand[0], label)) return i;
+    }
+    return -1;
+}
+
+/* First instruction run from an entry on, or -1 if a transfer or the end
+   comes first */
+static int first_instruction(MachineFunction *mf, int entry) {
+    for (int i = entry; i < mf->count; i++) {
+        MachineInstr *mi = &mf->code[i];
+        if (!is_machine_instruction(mi)) continue;
+        return is_control_transfer(mi->op) ? -1 : i;
+    }
+    return -1;
+}
+
+/* Registers live on reaching each entry, iterated backward to a fixed
+   point; a jump out of the function keeps everything live */
+static void find_live_registers(DelayContext *ctx) {
+    MachineFunction *mf = ctx->mf;
+    int changed = 1;
+
+    while (changed) {
+        changed = 0;
+        for (int i = mf->count - 1; i >= 0; i--) {
+            MachineInstr *mi = &mf->code[i];
+            RegisterMask next = i + 1 < mf->count ? ctx->live[i + 1] : 0;
+            RegisterMask live = next;
+
+            if (is_machine_instruction(mi)) {
+                RegisterMask out = next;
+                if (mi->op == MOP_JR) {
+                    out = RETURN_LIVE;
+                } else if (mi->op == MOP_J || is_conditional_branch(mi->op)) {
+                    out = ctx->target[i] >= 0 ? ctx->live[ctx->target[i]] : ALL_LIVE;
+                    if (mi->op != MOP_J) out |= next;
+                }
+                live = machine_uses(mi) | (out & ~machine_defs(mi));
+            }
+            if (live != ctx->live[i]) {
+                ctx->live[i] = live;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/* An instruction before transfer b, in its block, that can move into the
+   slot, or -1 */
+static int slot_from_before(DelayContext *ctx, int b) {
+    MachineInstr *code = ctx->mf->code;
+    int looked = 0;
+
+    for (int i = b - 1; i >= 0 && looked < DELAY_SEARCH_LIMIT; i--) {
+        MachineInstr *mi = &code[i];
+        if (mi->op == MOP_COMMENT || ctx->moved[i]) continue;
+        if (mi->op == MOP_LABEL || is_control_transfer(mi->op)) break;
+        looked++;
+        if (ctx->pinned[i] || !fits_slot(mi) || conflicts_with_transfer(mi, &code[b])) {
+            continue;
+        }
+        int k = i + 1;
+        while (k < b && (!is_machine_instruction(&code[k]) || ctx->moved[k] ||
+                         !conflicts(mi, &code[k]))) {
+            k++;
+        }
+        if (k == b) return i;
+    }
+    return -1;
+}
+
+/* The first instruction at transfer b's target, to copy into the slot, or
+   -1 */
+static int slot_from_target(DelayContext *ctx, int b) {
+    if (ctx->target[b] < 0) return -1;
+    int t = first_instruction(ctx->mf, ctx->target[b]);
+    if (t < 0 || ctx->moved[t] || !fits_slot(&ctx->mf->code[t])) return -1;
+    return t;
+}
+
+/* The instruction right after branch b, to move into the slot, or -1 */
+static int slot_from_fall_through(DelayContext *ctx, int b) {
+    MachineFunction *mf = ctx->mf;
+
+    if (ctx->target[b] < 0) return -1;
+    for (int f = b + 1; f < mf->count; f++) {
+        MachineInstr *mi = &mf->code[f];
+        if (mi->op == MOP_COMMENT) continue;
+        if (!is_machine_instruction(mi) || ctx->moved[f] || ctx->pinned[f] ||
+            !is_speculable(mi)) {
+            return -1;
+        }
+        return (machine_defs(mi) & ctx->live[ctx->target[b]]) ? -1 : f;
+    }
+    return -1;
+}
+
+/* Label right after instruction t, added if there is none */
+static MachineOperand label_after(DelayContext *ctx, int t, int target) {
+    MachineFunction *mf = ctx->mf;
+
+    if (t + 1 < mf->count && mf->code[t + 1].op == MOP_LABEL) {
+        return mf->code[t + 1].operand[0];
+    }
+    if (ctx->label_after[t] == NULL) {
+        MachineOperand *label = &mf->code[target].operand[0];
+        char name[32];
+        if (label->symbol == NULL) {
+            snprintf(name, sizeof(name), "L%d", label->value);
+        }
+        ctx->label_after[t] = machine_string(mf, label->symbol ? label->symbol : name, "_slot");
+    }
+    return machine_symbol(ctx->label_after[t]);
+}
+
+/* Rewrite the list with each transfer followed by its slot */
+static void place_slots(DelayContext *ctx) {
+    MachineFunction *mf = ctx->mf;
+    MachineInstr *code = (MachineInstr *)malloc(2 * mf->count * sizeof(MachineInstr));
+    MachineInstr nop = {MOP_NOP, {NO_OPERAND, NO_OPERAND, NO_OPERAND}, NULL};
+    int count = 0;
+
+    for (int i = 0; i < mf->count; i++) {
+        if (ctx->moved[i]) continue;
+        code[count++] = mf->code[i];
+        if (has_delay_slot(mf->code[i].op)) {
+            code[count++] = ctx->slot[i] >= 0 ? mf->code[ctx->slot[i]] : nop;
+        }
+        if (ctx->label_after[i]) {
+            MachineInstr label = {MOP_LABEL, {machine_symbol(ctx->label_after[i]),
+                                              NO_OPERAND, NO_OPERAND}, NULL};
+            code[count++] = label;
+        }
+    }
+    free(mf->code);
+    mf->code = code;
+    mf->capacity = 2 * mf->count;
+    mf->count = count;
+}
+
+/* Turn a conditional branch into its branch-likely form; beqz and bnez
+   have none, so they compare with $zero as beql and bnel */
+static void make_branch_likely(MachineInstr *mi) {
+    switch (mi->op) {
+        case MOP_BEQZ:
+        case MOP_BNEZ:
+            mi->op = mi->op == MOP_BEQZ ? MOP_BEQL : MOP_BNEL;
+            mi->operand[2] = mi->operand[1];
+            mi->operand[1] = machine_reg(REG_ZERO);
+            break;
+        case MOP_BEQ:  mi->op = MOP_BEQL;  break;
+        case MOP_BNE:  mi->op = MOP_BNEL;  break;
+        case MOP_BLTZ: mi->op = MOP_BLTZL; break;
+        case MOP_BGEZ: mi->op = MOP_BGEZL; break;
+        case MOP_BLEZ: mi->op = MOP_BLEZL; break;
+        case MOP_BGTZ: mi->op = MOP_BGTZL; break;
+        default:
+            break;
+    }
+}
+
+/* Name of a function: its first named label */
+static const char *function_name(MachineFunction *mf) {
+    for (int i = 0; i < mf->count; i++) {
+        if (mf->code[i].op == MOP_LABEL && mf->code[i].operand[0].symbol) {
+            return mf->code[i].operand[0].symbol;
+        }
+    }
+    return "?";
+}
+
+/* Fill the delay slot of every jump, call and branch in a function, and
+   report how many got an instruction other than a nop */
+void fill_delay_slots(MachineFunction *mf) {
+    machine_compact(mf);
+
+    int n = mf->count;
+    int counts[SLOT_SOURCES] = {0};
+    int slots = 0;
+    DelayContext ctx;
+
+    if (n == 0) return;
+    ctx.mf = mf;
+    ctx.live = (RegisterMask *)calloc(n, sizeof(RegisterMask));
+    ctx.target = (int *)malloc(n * sizeof(int));
+    ctx.slot = (int *)malloc(n * sizeof(int));
+    ctx.moved = (int *)calloc(n, sizeof(int));
+    ctx.pinned = (int *)calloc(n, sizeof(int));
+    ctx.label_after = (const char **)calloc(n, sizeof(const char *));
+
+    for (int i = 0; i < n; i++) {
+        MachineOperand *label = machine_jump_target(&mf->code[i]);
+        ctx.target[i] = label ? label_entry(mf, label) : -1;
+        ctx.slot[i] = -1;
+    }
+    find_live_registers(&ctx);
+
+    for (int b = 0; b < n; b++) {
+        MachineInstr *mi = &mf->code[b];
+        if (!has_delay_slot(mi->op)) continue;
+        slots++;
+
+        SlotSource source = SLOT_BEFORE;
+        int s = slot_from_before(&ctx, b);
+        if (s < 0 && (mi->op == MOP_J || is_conditional_branch(mi->op))) {
+            int backward = ctx.target[b] >= 0 && ctx.target[b] < b;
+            int retarget = mi->op == MOP_J || delay_slot_target == DELAY_SLOTS_SPIM;
+            if (retarget && (mi->op == MOP_J || backward)) {
+                source = SLOT_TARGET;
+                s = slot_from_target(&ctx, b);
+            }
+            if (s < 0 && mi->op != MOP_J) {
+                source = SLOT_FALL_THROUGH;
+                s = slot_from_fall_through(&ctx, b);
+            }
+            if (s < 0 && retarget && !backward && mi->op != MOP_J) {
+                source = SLOT_TARGET;
+                s = slot_from_target(&ctx, b);
+            }
+        }
+        if (s < 0) {
+            counts[SLOT_NOP]++;
+            continue;
+        }
+
+        if (source == SLOT_TARGET) {
+            *machine_jump_target(mi) = label_after(&ctx, s, ctx.target[b]);
+            if (mi->op != MOP_J) {
+                make_branch_likely(mi);
+            }
+            ctx.pinned[s] = 1;
+        } else {
+            ctx.moved[s] = 1;
+        }
+        ctx.slot[b] = s;
+        counts[source]++;
+    }
+
+    place_slots(&ctx);
+
+    int filled = slots - counts[SLOT_NOP];
+    if (slots > 0) {
+        printf("  %-16s %4d of %4d delay slots filled (%3d%%): %d before, %d target, "
+               "%d fall-through\n",
+               function_name(mf), filled, slots, 100 * filled / slots,
+               counts[SLOT_BEFORE], counts[SLOT_TARGET], counts[SLOT_FALL_THROUGH]);
+    }
+    slots_seen += slots;
+    for (int k = 0; k < SLOT_SOURCES; k++) {
+        slots_filled[k] += counts[k];
+    }
+
+    free(ctx.live);
+    free(ctx.target);
+    free(ctx.slot);
+    free(ctx.moved);
+    free(ctx.pinned);
+    free(ctx.label_after);
+}
+
+/* Print the slots filled over the program, by where their instructions
+   came from */
+void print_delay_slot_statistics(void) {
+    int filled = slots_seen - slots_filled[SLOT_NOP];
+    printf("Delay slot filling: %d of %d slots filled (%d%%), %d from before the "
+           "branch, %d from the target, %d from the fall-through\n",
+           filled, slots_seen, slots_seen ? 100 * filled / slots_seen : 0,
+           slots_filled[SLOT_BEFORE], slots_filled[SLOT_TARGET],
+           slots_filled[SLOT_FALL_THROUGH]);
+}
@@ -0,0 +1,274 @@
+/*
+ * Dead Store Elimination Implementation
+ * CST-405 Compiler Design
+ *
+ * Removes stores into local arrays whose value no path can read. Dead
+ * scalar assignments, to temporaries and user variables alike, are
+ * already removed by dead code elimination from the live variables; this
+ * pass does the same for memory:
+ *   - an array is live at a point if some path from it loads from the
+ *     array, or passes it to a call, before the function returns; a local
+ *     array is dead at every return, so the stores that fill it last are
+ *     removed
+ *   - within a block, a store is dead when a later store writes the same
+ *     element before anything may read it
+ * Global and parameter arrays outlive the function and are left alone.
+ * A call reads the local arrays the alias analysis says may escape into
+ * it. Elements are the same when their index is the same variable, not
+ * redefined in between, or the same constant.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "passes.h"
+#include "alias.h"
+#include "codegen.h"
+
+/* Later stores remembered while walking a block backward */
+#define MAX_OVERWRITTEN 64
+
+/* An element a later store in the block writes before any read */
+typedef struct {
+    int array;
+    MemoryAccess element;
+} Overwritten;
+
+typedef struct {
+    ControlFlowGraph *cfg;
+    AliasInfo *alias;
+    char **arrays;             /* Local arrays of the function */
+    int *escaped;              /* ...passed to some call */
+    int array_count;
+    int words;
+    unsigned int **live_in;    /* Arrays live per block */
+    unsigned int **live_out;
+    Overwritten overwritten[MAX_OVERWRITTEN];
+    int overwritten_count;
+} StoreState;
+
+static int same_name(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static int array_number(StoreState *s, const char *name) {
+    for (int i = 0; i < s->array_count; i++) {
+        if (same_name(s->arrays[i], name)) return i;
+    }
+    return -1;
+}
+
+/* Number the local arrays stored to in the function */
+static void collect_arrays(StoreState *s, TACInstruction *func_begin) {
+    TACInstruction *end = find_function_end(func_begin);
+    AliasInfo *alias = s->alias;
+    int capacity = 0;
+
+    for (TACInstruction *instr = func_begin->next; instr != end; instr = instr->next) {
+        if (instr->opcode != TAC_ARRAY_STORE || array_number(s, instr->result) >= 0 ||
+            array_kind(alias, instr->result) != ARRAY_LOCAL) {
+            continue;
+        }
+        if (s->array_count == capacity) {
+            capacity = capacity ? 2 * capacity : 8;
+            s->arrays = (char **)realloc(s->arrays, capacity * sizeof(char *));
+            s->escaped = (int *)realloc(s->escaped, capacity * sizeof(int));
+        }
+        s->arrays[s->array_count] = copy_string(instr->result);
+        s->escaped[s->array_count] = call_may_access(alias, instr->result);
+        s->array_count++;
+    }
+}
+
+/* Add the arrays an instruction reads */
+static void add_array_uses(StoreState *s, unsigned int *live, TACInstruction *instr) {
+    switch (instr->opcode) {
+        case TAC_ARRAY_LOAD:
+            set_bit(live, array_number(s, instr->arg1));
+            break;
+        case TAC_PARAM:
+            set_bit(live, array_number(s, instr->result));
+            break;
+        case TAC_CALL:
+            for (int i = 0; i < s->array_count; i++) {
+                if (s->escaped[i]) set_bit(live, i);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Backward data flow over the arrays: a store never makes an array dead,
+   since it writes one element, so live_in = uses | live_out */
+static void compute_array_liveness(StoreState *s) {
+    ControlFlowGraph *cfg = s->cfg;
+    unsigned int **uses = (unsigned int **)malloc(cfg->block_count * sizeof(unsigned int *));
+
+    s->live_in = (unsigned int **)malloc(cfg->block_count * sizeof(unsigned int *));
+    s->live_out = (unsigned int **)malloc(cfg->block_count * sizeof(unsigned int *));
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        uses[b] = (unsigned int *)calloc(s->words, sizeof(unsigned int));
+        s->live_in[b] = (unsigned int *)calloc(s->words, sizeof(unsigned int));
+        s->live_out[b] = (unsigned int *)calloc(s->words, sizeof(unsigned int));
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            add_array_uses(s, uses[b], instr);
+            if (instr == block->end) break;
+        }
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int b = cfg->block_count - 1; b >= 0; b--) {
+            BasicBlock *block = cfg->blocks[b];
+            for (int w = 0; w < s->words; w++) {
+                unsigned int out = 0;
+                for (int i = 0; i < block->succ_count; i++) {
+                    out |= s->live_in[block->successors[i]->id][w];
+                }
+                unsigned int in = uses[b][w] | out;
+                if (in != s->live_in[b][w]) changed = 1;
+                s->live_out[b][w] = out;
+                s->live_in[b][w] = in;
+            }
+        }
+    }
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        free(uses[b]);
+    }
+    free(uses);
+}
+
+static int is_overwritten(StoreState *s, MemoryAccess *element) {
+    for (int i = 0; i < s->overwritten_count; i++) {
+        if (alias_accesses(s->alias, &s->overwritten[i].element, element) == MUST_ALIAS) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Forget later stores the instruction may read, or whose index it
+   defines (above it the index holds another value); a call may read an
+   escaped array or change a global index */
+static void forget_overwritten(StoreState *s, TACInstruction *instr) {
+    int passed = instr->opcode == TAC_PARAM ? array_number(s, instr->result) : -1;
+    MemoryAccess read;
+
+    if (instr->opcode == TAC_ARRAY_LOAD) read = memory_access(instr);
+
+    for (int i = 0; i < s->overwritten_count; ) {
+        Overwritten *o = &s->overwritten[i];
+        int forget = (defines_result(instr) && same_name(o->element.index.base, instr->result)) ||
+                     (instr->opcode == TAC_ARRAY_LOAD &&
+                      alias_accesses(s->alias, &o->element, &read) != NO_ALIAS) ||
+                     o->array == passed ||
+                     (instr->opcode == TAC_CALL && call_may_touch(s->alias, &o->element));
+        if (forget) {
+            s->overwritten[i] = s->overwritten[--s->overwritten_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+/* Remove the stores of a block that no path reads */
+static int remove_block_stores(StoreState *s, BasicBlock *block, unsigned int *live,
+                               TACInstruction ***body, int *capacity) {
+    int count = 0;
+    int changes = 0;
+
+    for (TACInstruction *instr = block->start; ; instr = instr->next) {
+        if (count == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 32;
+            *body = (TACInstruction **)realloc(*body, *capacity * sizeof(TACInstruction *));
+        }
+        (*body)[count++] = instr;
+        if (instr == block->end) break;
+    }
+
+    memcpy(live, s->live_out[block->id], s->words * sizeof(unsigned int));
+    s->overwritten_count = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        TACInstruction *instr = (*body)[i];
+        int array = instr->opcode == TAC_ARRAY_STORE ? array_number(s, instr->result) : -1;
+
+        if (array >= 0) {
+            MemoryAccess element = memory_access(instr);
+            if (!bit_is_set(live, array) || is_overwritten(s, &element)) {
+                (*body)[i] = NULL;
+                continue;
+            }
+            if (s->overwritten_count < MAX_OVERWRITTEN) {
+                s->overwritten[s->overwritten_count].array = array;
+                s->overwritten[s->overwritten_count].element = element;
+                s->overwritten_count++;
+            }
+            continue;
+        }
+        forget_overwritten(s, instr);
+        add_array_uses(s, live, instr);
+    }
+
+    /* Unlink the dead stores, keeping the next block's anchor valid */
+    TACInstruction *prev = block->before;
+    for (int i = 0; i < count; i++) {
+        if ((*body)[i] == NULL) {
+            remove_tac_after(prev);
+            opt_stats.dead_stores_removed++;
+            changes++;
+        } else {
+            prev = (*body)[i];
+        }
+    }
+    if (block->id + 1 < s->cfg->block_count) {
+        s->cfg->blocks[block->id + 1]->before = prev;
+    }
+    return changes;
+}
+
+/* Remove stores into local arrays that are never read afterwards */
+int dead_store_elimination(TACInstruction *func_begin) {
+    StoreState *s = (StoreState *)calloc(1, sizeof(StoreState));
+    int changes = 0;
+
+    s->alias = compute_alias_info(func_begin);
+    collect_arrays(s, func_begin);
+    if (s->array_count == 0) {
+        free_alias_info(s->alias);
+        free(s);
+        return 0;
+    }
+
+    s->cfg = get_function_cfg(func_begin);
+    s->words = (s->array_count + 31) / 32;
+    compute_array_liveness(s);
+
+    unsigned int *live = (unsigned int *)malloc(s->words * sizeof(unsigned int));
+    TACInstruction **body = NULL;
+    int capacity = 0;
+    for (int b = 0; b < s->cfg->block_count; b++) {
+        changes += remove_block_stores(s, s->cfg->blocks[b], live, &body, &capacity);
+    }
+
+    for (int b = 0; b < s->cfg->block_count; b++) {
+        free(s->live_in[b]);
+        free(s->live_out[b]);
+    }
+    free(s->live_in);
+    free(s->live_out);
+    free(body);
+    free(live);
+    for (int i = 0; i < s->array_count; i++) {
+        free(s->arrays[i]);
+    }
+    free(s->arrays);
+    free(s->escaped);
+    free_alias_info(s->alias);
+    free(s);
+    return changes;
+}
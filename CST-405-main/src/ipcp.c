@@ -0,0 +1,448 @@
+/*
+ * Interprocedural Constant Propagation Implementation
+ * CST-405 Compiler Design
+ *
+ * Uses the call graph to push constant arguments into callees:
+ *   - a formal that receives the same constant at every call site is
+ *     replaced by that constant inside the callee
+ *   - constants forwarded through an unmodified formal of the caller
+ *     count as constants, so values flow down call chains
+ *   - when only some call sites pass constants, a specialized copy of
+ *     the callee is made for the hottest of them (calls inside loops),
+ *     as long as the program stays within a growth budget
+ * The local passes then fold the constants inside the callee bodies.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "callgraph.h"
+#include "codegen.h"
+#include "globals.h"
+
+/* Lattice of values a formal can take over all call sites */
+#define VALUE_UNDEFINED 0      /* No executed call seen yet */
+#define VALUE_CONSTANT 1       /* Always the same constant */
+#define VALUE_VARYING 2        /* Anything */
+
+/* Specialization policy */
+#define SPECIALIZE_MIN_HOTNESS 10       /* One call in a loop, or ten straight-line calls */
+#define SPECIALIZE_MAX_SIZE 200         /* Largest body worth cloning */
+#define SPECIALIZE_GROWTH_PERCENT 50    /* Program growth allowed for all clones */
+#define SPECIALIZE_MIN_BUDGET 100       /* Budget floor for small programs */
+#define MAX_LOOP_WEIGHT_DEPTH 3
+
+typedef struct {
+    int state;
+    int value;
+} FormalValue;
+
+/* Call sites of one callee that pass the same constants */
+typedef struct {
+    FunctionNode *callee;
+    FormalValue *signature;    /* Constant or varying per formal */
+    CallSite **sites;
+    int site_count;
+    int hotness;
+} SpecializationCandidate;
+
+/* Combine two lattice values */
+static FormalValue meet(FormalValue a, FormalValue b) {
+    FormalValue varying = {VALUE_VARYING, 0};
+
+    if (a.state == VALUE_UNDEFINED) return b;
+    if (b.state == VALUE_UNDEFINED) return a;
+    if (a.state == VALUE_VARYING || b.state == VALUE_VARYING) return varying;
+    return (a.value == b.value) ? a : varying;
+}
+
+/* Check if a formal is assigned anywhere in its function body */
+static int formal_is_redefined(FunctionNode *func, int k) {
+    char *name = func->formals[k]->result;
+
+    for (TACInstruction *instr = func->begin->next; instr != func->end; instr = instr->next) {
+        if (instr->opcode != TAC_FORMAL && defines_result(instr) &&
+            strcmp(instr->result, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Value of argument k at a call site, given what is known about the
+   caller's own formals */
+static FormalValue argument_value(CallSite *site, int k, FormalValue **values, int **redefined) {
+    FormalValue result = {VALUE_VARYING, 0};
+    char *arg = site->params[k]->result;
+
+    if (is_constant(arg)) {
+        result.state = VALUE_CONSTANT;
+        result.value = get_constant_value(arg);
+        return result;
+    }
+
+    int j = formal_index(site->caller, arg);
+    if (j >= 0 && !redefined[site->caller->index][j]) {
+        return values[site->caller->index][j];
+    }
+    return result;
+}
+
+/* Replace every read of a formal inside [begin, end) with a constant; a
+   formal that is also assigned gets an initializing load instead */
+static void substitute_formal(TACInstruction *begin, TACInstruction *end,
+                              TACInstruction *formal, int redefined, int value) {
+    char *name = formal->result;
+    char *constant = make_string("%d", value);
+
+    if (redefined) {
+        TACInstruction *pos = formal;
+        while (pos->next != end && pos->next->opcode == TAC_FORMAL) {
+            pos = pos->next;
+        }
+        insert_tac_after(pos, create_tac(TAC_LOAD_CONST, name, constant, NULL));
+    } else {
+        for (TACInstruction *instr = begin->next; instr != end; instr = instr->next) {
+            if (instr->opcode == TAC_FORMAL || instr->opcode == TAC_CALL) continue;
+
+            if (instr->arg1 && strcmp(instr->arg1, name) == 0) {
+                free(instr->arg1);
+                instr->arg1 = copy_string(constant);
+            }
+            if (instr->arg2 && strcmp(instr->arg2, name) == 0) {
+                free(instr->arg2);
+                instr->arg2 = copy_string(constant);
+            }
+            if (uses_result(instr) && instr->opcode != TAC_ARRAY_STORE &&
+                instr->result && strcmp(instr->result, name) == 0) {
+                free(instr->result);
+                instr->result = copy_string(constant);
+            }
+        }
+    }
+
+    free(constant);
+    opt_stats.arguments_propagated++;
+}
+
+/* Rename a temporary through the map built while cloning */
+static char *clone_operand(char *operand, char ***from, char ***to, int *count, int *capacity) {
+    if (operand == NULL) return NULL;
+    if (!is_temporary(operand)) return copy_string(operand);
+
+    for (int i = 0; i < *count; i++) {
+        if (strcmp((*from)[i], operand) == 0) {
+            return copy_string((*to)[i]);
+        }
+    }
+
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 32;
+        *from = (char **)realloc(*from, *capacity * sizeof(char *));
+        *to = (char **)realloc(*to, *capacity * sizeof(char *));
+    }
+    (*from)[*count] = operand;
+    (*to)[*count] = new_temp();
+    (*count)++;
+    return copy_string((*to)[*count - 1]);
+}
+
+/* Copy a whole function under a new name, with fresh labels and temps,
+   directly after the original; returns the copy's BEGIN_FUNC */
+static TACInstruction *clone_function(FunctionNode *func, char *name) {
+    int label_limit = tac_context->label_count;
+    int *label_map = (int *)malloc((label_limit + 1) * sizeof(int));
+    char **from = NULL, **to = NULL;
+    int count = 0, capacity = 0;
+
+    for (int i = 0; i < label_limit; i++) {
+        label_map[i] = -1;
+    }
+
+    TACInstruction *pos = func->end;
+    TACInstruction *clone_begin = NULL;
+    for (TACInstruction *instr = func->begin; ; instr = instr->next) {
+        TACInstruction *copy = create_tac(instr->opcode, NULL, NULL, NULL);
+
+        if (instr->opcode == TAC_FUNC_BEGIN || instr->opcode == TAC_FUNC_END) {
+            copy->result = copy_string(name);
+        } else {
+            copy->result = clone_operand(instr->result, &from, &to, &count, &capacity);
+            copy->arg1 = clone_operand(instr->arg1, &from, &to, &count, &capacity);
+            copy->arg2 = clone_operand(instr->arg2, &from, &to, &count, &capacity);
+        }
+
+        if ((instr->opcode == TAC_LABEL || is_jump(instr)) &&
+            instr->label >= 0 && instr->label < label_limit) {
+            if (label_map[instr->label] < 0) {
+                label_map[instr->label] = new_label();
+            }
+            copy->label = label_map[instr->label];
+        } else {
+            copy->label = instr->label;
+        }
+
+        insert_tac_after(pos, copy);
+        pos = copy;
+        if (clone_begin == NULL) clone_begin = copy;
+        if (instr == func->end) break;
+    }
+
+    /* The copy has the original's locals, and so its frame layout */
+    SymbolEntry *original = lookup_symbol_in_scope(func->name, global_scope);
+    if (original && lookup_symbol_in_scope(name, global_scope) == NULL) {
+        SymbolEntry *symbol = insert_symbol(name, SYMBOL_FUNCTION, original->type);
+        symbol->param_count = original->param_count;
+        symbol->params = original->params;
+        symbol->locals = original->locals;
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(to[i]);
+    }
+    free(from);
+    free(to);
+    free(label_map);
+    return clone_begin;
+}
+
+/* Order candidates by decreasing hotness */
+static int compare_candidates(const void *a, const void *b) {
+    const SpecializationCandidate *x = (const SpecializationCandidate *)a;
+    const SpecializationCandidate *y = (const SpecializationCandidate *)b;
+    return y->hotness - x->hotness;
+}
+
+/* Static estimate of how often a call site runs */
+static int site_weight(CallSite *site) {
+    int depth = site->loop_depth < MAX_LOOP_WEIGHT_DEPTH ? site->loop_depth
+                                                         : MAX_LOOP_WEIGHT_DEPTH;
+    int weight = 1;
+    while (depth-- > 0) weight *= 10;
+    return weight;
+}
+
+/* Check if two call sites pass the same constants */
+static int same_signature(FormalValue *a, FormalValue *b, int n) {
+    for (int k = 0; k < n; k++) {
+        if (a[k].state != b[k].state) return 0;
+        if (a[k].state == VALUE_CONSTANT && a[k].value != b[k].value) return 0;
+    }
+    return 1;
+}
+
+/* Count calls that still name a function */
+static int count_calls_to(char *name) {
+    int count = 0;
+    for (TACInstruction *instr = get_tac_list(); instr; instr = instr->next) {
+        if (instr->opcode == TAC_CALL && strcmp(instr->arg1, name) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Unlink and free a whole function */
+static void delete_function(FunctionNode *func) {
+    TACInstruction *prev = NULL;
+    for (TACInstruction *instr = get_tac_list(); instr != func->begin; instr = instr->next) {
+        prev = instr;
+    }
+
+    TACInstruction *after = func->end->next;
+    TACInstruction *instr = func->begin;
+    while (instr != after) {
+        TACInstruction *next = instr->next;
+        free_tac_instruction(instr);
+        instr = next;
+    }
+
+    if (prev) {
+        prev->next = after;
+        if (after == NULL) tac_context->tail = prev;
+    } else {
+        set_tac_list(after);
+    }
+}
+
+/* Clone callees for the hottest groups of call sites with constant
+   arguments that the global lattice could not prove */
+static void specialize_functions(CallGraph *graph, FormalValue **values, int **redefined) {
+    SpecializationCandidate *candidates = NULL;
+    int candidate_count = 0, candidate_capacity = 0;
+
+    for (int s = 0; s < graph->site_count; s++) {
+        CallSite *site = graph->sites[s];
+        FunctionNode *callee = site->callee;
+
+        if (callee == NULL || site->arg_count != callee->formal_count ||
+            callee->instruction_count > SPECIALIZE_MAX_SIZE ||
+            strcmp(callee->name, "main") == 0) {
+            continue;
+        }
+
+        /* Only formals that are varying overall are worth a copy */
+        FormalValue *signature = (FormalValue *)malloc(callee->formal_count * sizeof(FormalValue));
+        int constants = 0;
+        for (int k = 0; k < callee->formal_count; k++) {
+            signature[k] = argument_value(site, k, values, redefined);
+            if (values[callee->index][k].state != VALUE_VARYING ||
+                signature[k].state != VALUE_CONSTANT) {
+                signature[k].state = VALUE_VARYING;
+                signature[k].value = 0;
+            } else {
+                constants++;
+            }
+        }
+        if (constants == 0) {
+            free(signature);
+            continue;
+        }
+
+        SpecializationCandidate *group = NULL;
+        for (int c = 0; c < candidate_count; c++) {
+            if (candidates[c].callee == callee &&
+                same_signature(candidates[c].signature, signature, callee->formal_count)) {
+                group = &candidates[c];
+                break;
+            }
+        }
+        if (group == NULL) {
+            if (candidate_count == candidate_capacity) {
+                candidate_capacity = candidate_capacity ? candidate_capacity * 2 : 8;
+                candidates = (SpecializationCandidate *)realloc(candidates,
+                                 candidate_capacity * sizeof(SpecializationCandidate));
+            }
+            group = &candidates[candidate_count++];
+            group->callee = callee;
+            group->signature = signature;
+            group->sites = (CallSite **)malloc(graph->site_count * sizeof(CallSite *));
+            group->site_count = 0;
+            group->hotness = 0;
+        } else {
+            free(signature);
+        }
+        group->sites[group->site_count++] = site;
+        group->hotness += site_weight(site);
+    }
+
+    if (candidate_count > 1) {
+        qsort(candidates, candidate_count, sizeof(SpecializationCandidate), compare_candidates);
+    }
+
+    int budget = graph->instruction_count * SPECIALIZE_GROWTH_PERCENT / 100;
+    if (budget < SPECIALIZE_MIN_BUDGET) budget = SPECIALIZE_MIN_BUDGET;
+
+    int *clones = (int *)calloc(graph->function_count, sizeof(int));
+    for (int c = 0; c < candidate_count; c++) {
+        SpecializationCandidate *group = &candidates[c];
+        FunctionNode *callee = group->callee;
+        int cost = callee->instruction_count + 2;
+
+        if (group->hotness < SPECIALIZE_MIN_HOTNESS || cost > budget) continue;
+        budget -= cost;
+
+        char *name = make_string("%s_%d", callee->name, ++clones[callee->index]);
+        TACInstruction *begin = clone_function(callee, name);
+        TACInstruction *end = find_function_end(begin);
+
+        /* Formals of the copy sit in the same order right after BEGIN_FUNC */
+        TACInstruction *formal = begin->next;
+        for (int k = 0; k < callee->formal_count; k++, formal = formal->next) {
+            if (group->signature[k].state == VALUE_CONSTANT) {
+                substitute_formal(begin, end, formal, redefined[callee->index][k],
+                                  group->signature[k].value);
+            }
+        }
+
+        for (int i = 0; i < group->site_count; i++) {
+            free(group->sites[i]->call->arg1);
+            group->sites[i]->call->arg1 = copy_string(name);
+        }
+        free(name);
+        opt_stats.functions_specialized++;
+    }
+
+    /* Originals whose every call moved to a copy are now dead */
+    for (int i = 0; i < graph->function_count; i++) {
+        FunctionNode *func = graph->functions[i];
+        if (clones[i] > 0 && count_calls_to(func->name) == 0) {
+            delete_function(func);
+        }
+    }
+
+    for (int c = 0; c < candidate_count; c++) {
+        free(candidates[c].signature);
+        free(candidates[c].sites);
+    }
+    free(candidates);
+    free(clones);
+}
+
+/* Propagate constant arguments over the call graph, then specialize */
+int interprocedural_constant_propagation(void) {
+    int before = opt_stats.arguments_propagated + opt_stats.functions_specialized;
+    CallGraph *graph = build_call_graph();
+    FormalValue **values = (FormalValue **)malloc(graph->function_count * sizeof(FormalValue *));
+    int **redefined = (int **)malloc(graph->function_count * sizeof(int *));
+
+    for (int i = 0; i < graph->function_count; i++) {
+        FunctionNode *func = graph->functions[i];
+        int is_entry = strcmp(func->name, "main") == 0;
+
+        values[i] = (FormalValue *)calloc(func->formal_count + 1, sizeof(FormalValue));
+        redefined[i] = (int *)calloc(func->formal_count + 1, sizeof(int));
+        for (int k = 0; k < func->formal_count; k++) {
+            values[i][k].state = is_entry ? VALUE_VARYING : VALUE_UNDEFINED;
+            redefined[i][k] = formal_is_redefined(func, k);
+        }
+    }
+
+    /* Optimistic fixed point: values only move down the lattice */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int s = 0; s < graph->site_count; s++) {
+            CallSite *site = graph->sites[s];
+            FunctionNode *callee = site->callee;
+            if (callee == NULL) continue;
+
+            for (int k = 0; k < callee->formal_count; k++) {
+                FormalValue old = values[callee->index][k];
+                FormalValue arg = {VALUE_VARYING, 0};
+                if (site->arg_count == callee->formal_count) {
+                    arg = argument_value(site, k, values, redefined);
+                }
+
+                FormalValue updated = meet(old, arg);
+                if (updated.state != old.state || updated.value != old.value) {
+                    values[callee->index][k] = updated;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < graph->function_count; i++) {
+        FunctionNode *func = graph->functions[i];
+        for (int k = 0; k < func->formal_count; k++) {
+            if (values[i][k].state == VALUE_CONSTANT) {
+                substitute_formal(func->begin, func->end, func->formals[k],
+                                  redefined[i][k], values[i][k].value);
+            }
+        }
+    }
+
+    specialize_functions(graph, values, redefined);
+
+    for (int i = 0; i < graph->function_count; i++) {
+        free(values[i]);
+        free(redefined[i]);
+    }
+    free(values);
+    free(redefined);
+    free_call_graph(graph);
+
+    return opt_stats.arguments_propagated + opt_stats.functions_specialized - before;
+}
@@ -0,0 +1,219 @@
+/*
+ * Redundant Load Elimination Implementation
+ * CST-405 Compiler Design
+ *
+ * Tracks the array elements whose values are available in a variable,
+ * over each extended basic block: a run of code entered only at its top,
+ * so a fall-through past a conditional branch keeps what was known and
+ * only a label starts over. An element becomes available when it is
+ * loaded (t = a[i] makes t hold a[i]) or stored (a[i] = x makes x hold
+ * it), and a later load of the same element becomes a copy.
+ *
+ * Indices are compared as a base variable plus a constant, following
+ * t = v + c and t = v - c, so a[j + 1] computed twice is one element and
+ * a[j] and a[j + 1] are known to differ. An element is forgotten when:
+ *   - its index base or the variable holding it is redefined
+ *   - a store may write it: the alias analysis cannot tell the two
+ *     accesses apart
+ *   - a call may write it: the alias analysis says the callee can reach
+ *     the array, or the element is held in a global scalar
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "codegen.h"
+#include "alias.h"
+
+/* Elements and index forms tracked at once in a block */
+#define MAX_AVAILABLE_LOADS 100
+
+/* A temporary defined as base + offset */
+typedef struct {
+    char *name;
+    ArrayIndex form;
+} IndexDefinition;
+
+/* An element a[index] whose value is in holder */
+typedef struct {
+    MemoryAccess element;
+    char *holder;
+} AvailableLoad;
+
+typedef struct {
+    AliasInfo *alias;
+    IndexDefinition defs[MAX_AVAILABLE_LOADS];
+    int def_count;
+    AvailableLoad loads[MAX_AVAILABLE_LOADS];
+    int load_count;
+} LoadState;
+
+static int same_name(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/* Base + offset form of a variable used as an index */
+static ArrayIndex index_form(LoadState *s, char *variable) {
+    ArrayIndex form = {variable, 0};
+
+    for (int i = 0; i < s->def_count; i++) {
+        if (same_name(s->defs[i].name, variable)) return s->defs[i].form;
+    }
+    return form;
+}
+
+/* Element of a load or store, following the index's definition */
+static MemoryAccess element_of(LoadState *s, TACInstruction *instr) {
+    MemoryAccess access = memory_access(instr);
+
+    if (access.index.base) access.index = index_form(s, access.index.base);
+    return access;
+}
+
+/* Forget everything that depends on the value of name */
+static void kill_name(LoadState *s, char *name) {
+    for (int i = 0; i < s->def_count; ) {
+        if (same_name(s->defs[i].name, name) || same_name(s->defs[i].form.base, name)) {
+            s->defs[i] = s->defs[--s->def_count];
+        } else {
+            i++;
+        }
+    }
+    for (int i = 0; i < s->load_count; ) {
+        AvailableLoad *l = &s->loads[i];
+        if (same_name(l->element.index.base, name) || same_name(l->holder, name)) {
+            s->loads[i] = s->loads[--s->load_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+/* Forget the elements a store may overwrite */
+static void kill_stored(LoadState *s, MemoryAccess *stored) {
+    for (int i = 0; i < s->load_count; ) {
+        AvailableLoad *l = &s->loads[i];
+        if (alias_accesses(s->alias, &l->element, stored) != NO_ALIAS) {
+            s->loads[i] = s->loads[--s->load_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+/* Forget the elements a call may change */
+static void kill_call(LoadState *s) {
+    for (int i = 0; i < s->def_count; ) {
+        if (call_may_change(s->alias, s->defs[i].form.base)) {
+            s->defs[i] = s->defs[--s->def_count];
+        } else {
+            i++;
+        }
+    }
+    for (int i = 0; i < s->load_count; ) {
+        AvailableLoad *l = &s->loads[i];
+        if (call_may_touch(s->alias, &l->element) || call_may_change(s->alias, l->holder)) {
+            s->loads[i] = s->loads[--s->load_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+static void add_load(LoadState *s, MemoryAccess *element, char *holder) {
+    if (s->load_count < MAX_AVAILABLE_LOADS) {
+        AvailableLoad *l = &s->loads[s->load_count++];
+        l->element = *element;
+        l->holder = holder;
+    }
+}
+
+/* An available element the access must read */
+static AvailableLoad *find_load(LoadState *s, MemoryAccess *element) {
+    for (int i = 0; i < s->load_count; i++) {
+        if (alias_accesses(s->alias, &s->loads[i].element, element) == MUST_ALIAS) {
+            return &s->loads[i];
+        }
+    }
+    return NULL;
+}
+
+/* Record t = v + c or t = v - c as an index form of t */
+static void record_index_definition(LoadState *s, TACInstruction *instr) {
+    if ((instr->opcode != TAC_ADD && instr->opcode != TAC_SUB) ||
+        !is_constant(instr->arg2) || is_constant(instr->arg1) ||
+        s->def_count >= MAX_AVAILABLE_LOADS) {
+        return;
+    }
+    ArrayIndex form = index_form(s, instr->arg1);
+    if (same_name(form.base, instr->result)) return;
+    int c = get_constant_value(instr->arg2);
+    form.offset += instr->opcode == TAC_ADD ? c : -c;
+    s->defs[s->def_count].name = instr->result;
+    s->defs[s->def_count].form = form;
+    s->def_count++;
+}
+
+/* Replace loads of elements available in a variable with copies of it */
+int redundant_load_elimination(TACInstruction *func_begin) {
+    LoadState *s = (LoadState *)calloc(1, sizeof(LoadState));
+    TACInstruction *stop = find_function_end(func_begin)->next;
+    int changes = 0;
+
+    s->alias = compute_alias_info(func_begin);
+    for (TACInstruction *instr = func_begin; instr != stop; instr = instr->next) {
+        switch (instr->opcode) {
+            case TAC_ARRAY_LOAD: {
+                MemoryAccess element = element_of(s, instr);
+                AvailableLoad *l = find_load(s, &element);
+                if (l && !same_name(l->holder, instr->result)) {
+                    char *holder = copy_string(l->holder);
+                    instr->opcode = TAC_ASSIGN;
+                    free(instr->arg1);
+                    free(instr->arg2);
+                    instr->arg1 = holder;
+                    instr->arg2 = NULL;
+                    opt_stats.loads_eliminated++;
+                    changes++;
+                    kill_name(s, instr->result);
+                    break;
+                }
+                kill_name(s, instr->result);
+                if (!same_name(element.index.base, instr->result)) {
+                    add_load(s, &element, instr->result);
+                }
+                break;
+            }
+
+            case TAC_ARRAY_STORE: {
+                MemoryAccess element = element_of(s, instr);
+                kill_stored(s, &element);
+                add_load(s, &element, instr->arg2);
+                break;
+            }
+
+            case TAC_CALL:
+                kill_call(s);
+                if (instr->result) kill_name(s, instr->result);
+                break;
+
+            case TAC_LABEL:
+            case TAC_FUNC_BEGIN:
+                s->def_count = 0;
+                s->load_count = 0;
+                break;
+
+            default:
+                if (defines_result(instr)) {
+                    kill_name(s, instr->result);
+                    record_index_definition(s, instr);
+                }
+                break;
+        }
+    }
+
+    free_alias_info(s->alias);
+    free(s);
+    return changes;
+}
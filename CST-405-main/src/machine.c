@@ -0,0 +1,393 @@
+/*
+ * MIPS Machine Instructions and Assembly Writer Implementation
+ * CST-405 Compiler Design
+ *
+ * Instruction selection appends each function's instructions to a
+ * MachineFunction; once the function is complete, passes over the list
+ * can run before the writer turns it into assembly text. The writer
+ * copies strings and formats integers into a large buffer by hand, so
+ * writing huge outputs costs no printf call per instruction
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+
+/* Register names */
+static const char *register_names[] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+    "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+};
+
+/* Mnemonics, in MachineOpcode order */
+static const char *opcode_names[MOP_COUNT] = {
+    "add", "addi", "addiu", "addu", "sub", "subu",
+    "mul", "mult", "div", "mfhi", "mflo",
+    "xor", "xori", "ori", "lui", "sll", "srl", "sra",
+    "slt", "slti", "sltu", "sltiu",
+    "sle", "sgt", "sge", "seq", "sne",
+    "li", "la", "move",
+    "lw", "sw",
+    "j", "jal", "jr",
+    "beq", "bne", "beqz", "bnez", "bltz", "bgez", "blez", "bgtz",
+    "beql", "bnel", "bltzl", "bgezl", "blezl", "bgtzl",
+    "syscall", "nop",
+    "", "", ""
+};
+
+/* ---- Operands ---- */
+
+MachineOperand machine_none(void) {
+    MachineOperand o = {MO_NONE, -1, 0, NULL};
+    return o;
+}
+
+MachineOperand machine_reg(int reg) {
+    MachineOperand o = {MO_REG, reg, 0, NULL};
+    return o;
+}
+
+MachineOperand machine_imm(int value) {
+    MachineOperand o = {MO_IMM, -1, value, NULL};
+    return o;
+}
+
+/* Numbered label L<label> */
+MachineOperand machine_label(int label) {
+    MachineOperand o = {MO_LABEL, -1, label, NULL};
+    return o;
+}
+
+/* Named label: a function, runtime routine or global */
+MachineOperand machine_symbol(const char *symbol) {
+    MachineOperand o = {MO_LABEL, -1, 0, symbol};
+    return o;
+}
+
+/* offset(base) */
+MachineOperand machine_mem(int offset, int base) {
+    MachineOperand o = {MO_MEM, base, offset, NULL};
+    return o;
+}
+
+/* symbol+offset(base), or symbol+offset with base -1 */
+MachineOperand machine_symbol_mem(const char *symbol, int offset, int base) {
+    MachineOperand o = {MO_MEM, base, offset, symbol};
+    return o;
+}
+
+/* ---- Instruction lists ---- */
+
+MachineFunction *new_machine_function(void) {
+    MachineFunction *mf = (MachineFunction *)malloc(sizeof(MachineFunction));
+    mf->capacity = 64;
+    mf->count = 0;
+    mf->code = (MachineInstr *)malloc(mf->capacity * sizeof(MachineInstr));
+    mf->strings = NULL;
+    mf->string_count = 0;
+    return mf;
+}
+
+void free_machine_function(MachineFunction *mf) {
+    if (mf == NULL) return;
+    for (int i = 0; i < mf->string_count; i++) {
+        free(mf->strings[i]);
+    }
+    free(mf->strings);
+    free(mf->code);
+    free(mf);
+}
+
+void machine_append(MachineFunction *mf, MachineOpcode op, MachineOperand a,
+                    MachineOperand b, MachineOperand c) {
+    if (mf->count == mf->capacity) {
+        mf->capacity *= 2;
+        mf->code = (MachineInstr *)realloc(mf->code, mf->capacity * sizeof(MachineInstr));
+    }
+    MachineInstr *mi = &mf->code[mf->count++];
+    mi->op = op;
+    mi->operand[0] = a;
+    mi->operand[1] = b;
+    mi->operand[2] = c;
+    mi->comment = NULL;
+}
+
+void machine_comment(MachineFunction *mf, const char *text) {
+    machine_append(mf, MOP_COMMENT, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+    mf->code[mf->count - 1].comment = text;
+}
+
+/* A symbol owned by the function: prefix followed by suffix */
+const char *machine_string(MachineFunction *mf, const char *prefix, const char *suffix) {
+    size_t length = strlen(prefix);
+    char *s = (char *)malloc(length + strlen(suffix) + 1);
+    memcpy(s, prefix, length);
+    strcpy(s + length, suffix);
+    mf->strings = (char **)realloc(mf->strings, (mf->string_count + 1) * sizeof(char *));
+    mf->strings[mf->string_count++] = s;
+    return s;
+}
+
+/* Check if an entry is a real instruction, not a label or comment */
+int is_machine_instruction(MachineInstr *mi) {
+    return mi->op != MOP_LABEL && mi->op != MOP_COMMENT && mi->op != MOP_DELETED;
+}
+
+/* Drop the entries passes deleted, keeping the order of the rest */
+void machine_compact(MachineFunction *mf) {
+    int kept = 0;
+    for (int i = 0; i < mf->count; i++) {
+        if (mf->code[i].op != MOP_DELETED) {
+            mf->code[kept++] = mf->code[i];
+        }
+    }
+    mf->count = kept;
+}
+
+int is_conditional_branch(MachineOpcode op) {
+    return op >= MOP_BEQ && op <= MOP_BGTZL;
+}
+
+/* Cycles until an instruction's result can be used by the next one
+   (1 means no stall) in the MIPS32 pipeline; opcodes not listed take 1 */
+static const struct {
+    MachineOpcode op;
+    int latency;
+} latency_table[] = {
+    {MOP_LW,   2},                 /* Load delay slot */
+    {MOP_MUL,  2},                 /* Multiplier pipeline */
+    {MOP_MULT, 2},                 /* The same, read through mfhi */
+    {MOP_DIV,  35},                /* Iterative divider, read through mflo */
+};
+
+int machine_latency(MachineOpcode op) {
+    for (size_t i = 0; i < sizeof(latency_table) / sizeof(latency_table[0]); i++) {
+        if (latency_table[i].op == op) return latency_table[i].latency;
+    }
+    return 1;
+}
+
+/* Check if an instruction leaves the straight-line path: a jump, branch,
+   call or system call */
+int is_control_transfer(MachineOpcode op) {
+    return op == MOP_J || op == MOP_JAL || op == MOP_JR || op == MOP_SYSCALL ||
+           is_conditional_branch(op);
+}
+
+/* Label operand of a j or conditional branch, or NULL */
+MachineOperand *machine_jump_target(MachineInstr *mi) {
+    if (mi->op == MOP_J && mi->operand[0].kind == MO_LABEL) return &mi->operand[0];
+    if (mi->op == MOP_BEQ || mi->op == MOP_BNE || mi->op == MOP_BEQL || mi->op == MOP_BNEL) {
+        return &mi->operand[2];
+    }
+    if (is_conditional_branch(mi->op)) return &mi->operand[1];
+    return NULL;
+}
+
+int machine_same_label(MachineOperand *a, MachineOperand *b) {
+    if (a->symbol || b->symbol) {
+        return a->symbol && b->symbol && strcmp(a->symbol, b->symbol) == 0;
+    }
+    return a->value == b->value;
+}
+
+/* Check if two memory operands may name the same word: different
+   globals, a global and the frame, or different frame offsets do not */
+int machine_may_alias(MachineOperand *a, MachineOperand *b) {
+    int a_frame = a->symbol == NULL && (a->reg == 29 || a->reg == 30);
+    int b_frame = b->symbol == NULL && (b->reg == 29 || b->reg == 30);
+
+    if (a->symbol && b->symbol && strcmp(a->symbol, b->symbol) != 0) return 0;
+    if ((a->symbol && b_frame) || (b->symbol && a_frame)) return 0;
+    if (a_frame && b_frame && a->reg == b->reg && a->value != b->value) return 0;
+    return 1;
+}
+
+/* Bits of $v0-$v1, $a0-$a3 and $t0-$t9, which a call may change */
+#define CALL_CLOBBERED 0x0300FFFCull
+#define BIT(r) (1ull << (r))
+
+/* Registers an instruction writes */
+RegisterMask machine_defs(MachineInstr *mi) {
+    switch (mi->op) {
+        case MOP_SW:
+        case MOP_J:
+        case MOP_JR:
+        case MOP_LABEL:
+        case MOP_COMMENT:
+        case MOP_DELETED:
+            return 0;
+        case MOP_MULT:
+        case MOP_DIV:
+            return BIT(MACHINE_HILO);
+        case MOP_JAL:
+            return CALL_CLOBBERED | BIT(31) | BIT(MACHINE_HILO);
+        case MOP_SYSCALL:
+            return BIT(2);
+        default:
+            if (is_conditional_branch(mi->op)) return 0;
+            if (mi->operand[0].kind == MO_REG && mi->operand[0].reg != 0) {
+                return BIT(mi->operand[0].reg);
+            }
+            return 0;
+    }
+}
+
+/* Registers an instruction reads, including the bases of its addresses */
+RegisterMask machine_uses(MachineInstr *mi) {
+    RegisterMask uses = 0;
+    int first = 1;
+
+    switch (mi->op) {
+        case MOP_MFHI:
+        case MOP_MFLO:
+            return BIT(MACHINE_HILO);
+        case MOP_JAL:
+            return BIT(4) | BIT(5) | BIT(6) | BIT(7) | BIT(29);
+        case MOP_SYSCALL:
+            return BIT(2) | BIT(4);
+        case MOP_SW:
+        case MOP_MULT:
+        case MOP_DIV:
+        case MOP_JR:
+            first = 0;
+            break;
+        default:
+            if (is_conditional_branch(mi->op)) first = 0;
+            break;
+    }
+    for (int k = 0; k < 3; k++) {
+        MachineOperand *o = &mi->operand[k];
+        if (o->kind == MO_MEM && o->reg >= 0) {
+            uses |= BIT(o->reg);
+        } else if (o->kind == MO_REG && k >= first) {
+            uses |= BIT(o->reg);
+        }
+    }
+    return uses & ~BIT(0);
+}
+
+const char *machine_register_name(int reg) {
+    return register_names[reg];
+}
+
+/* ---- Assembly writer ---- */
+
+AsmWriter *new_asm_writer(FILE *file) {
+    AsmWriter *w = (AsmWriter *)malloc(sizeof(AsmWriter));
+    w->file = file;
+    w->used = 0;
+    return w;
+}
+
+static void asm_flush(AsmWriter *w) {
+    fwrite(w->buffer, 1, w->used, w->file);
+    w->used = 0;
+}
+
+static void asm_write_char(AsmWriter *w, char c) {
+    if (w->used == ASM_BUFFER_SIZE) asm_flush(w);
+    w->buffer[w->used++] = c;
+}
+
+void asm_write_string(AsmWriter *w, const char *text) {
+    size_t length = strlen(text);
+    if (w->used + length > ASM_BUFFER_SIZE) {
+        asm_flush(w);
+        if (length > ASM_BUFFER_SIZE) {
+            fwrite(text, 1, length, w->file);
+            return;
+        }
+    }
+    memcpy(w->buffer + w->used, text, length);
+    w->used += length;
+}
+
+/* Decimal digits of a value, most significant first */
+void asm_write_int(AsmWriter *w, int value) {
+    char digits[12];
+    int n = 0;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    if (value < 0) asm_write_char(w, '-');
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    while (n > 0) {
+        asm_write_char(w, digits[--n]);
+    }
+}
+
+static void asm_write_operand(AsmWriter *w, MachineOperand *o) {
+    switch (o->kind) {
+        case MO_REG:
+            asm_write_string(w, register_names[o->reg]);
+            break;
+        case MO_IMM:
+            asm_write_int(w, o->value);
+            break;
+        case MO_LABEL:
+            if (o->symbol) {
+                asm_write_string(w, o->symbol);
+            } else {
+                asm_write_char(w, 'L');
+                asm_write_int(w, o->value);
+            }
+            break;
+        case MO_MEM:
+            if (o->symbol) {
+                asm_write_string(w, o->symbol);
+                if (o->value > 0) asm_write_char(w, '+');
+                if (o->value != 0) asm_write_int(w, o->value);
+            } else {
+                asm_write_int(w, o->value);
+            }
+            if (o->reg >= 0) {
+                asm_write_char(w, '(');
+                asm_write_string(w, register_names[o->reg]);
+                asm_write_char(w, ')');
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Write a function's instructions, after a blank line */
+void asm_write_function(AsmWriter *w, MachineFunction *mf) {
+    asm_write_char(w, '\n');
+    for (int i = 0; i < mf->count; i++) {
+        MachineInstr *mi = &mf->code[i];
+
+        if (mi->op == MOP_DELETED) continue;
+        if (mi->op == MOP_LABEL) {
+            asm_write_operand(w, &mi->operand[0]);
+            asm_write_string(w, ":\n");
+            continue;
+        }
+        asm_write_string(w, "    ");
+        if (mi->op == MOP_COMMENT) {
+            asm_write_string(w, "# ");
+            asm_write_string(w, mi->comment);
+            asm_write_char(w, '\n');
+            continue;
+        }
+        asm_write_string(w, opcode_names[mi->op]);
+        for (int k = 0; k < 3 && mi->operand[k].kind != MO_NONE; k++) {
+            asm_write_string(w, k == 0 ? " " : ", ");
+            asm_write_operand(w, &mi->operand[k]);
+        }
+        asm_write_char(w, '\n');
+    }
+}
+
+/* Flush what is left and free the writer (the file stays open) */
+void free_asm_writer(AsmWriter *w) {
+    if (w == NULL) return;
+    asm_flush(w);
+    free(w);
+}
@@ -22,7 +22,11 @@
 #include "semantic.h"
 #include "codegen.h"
 #include "optimize.h"
+#include "passes.h"
 #include "mips.h"
+#include "peephole.h"
+#include "schedule.h"
+#include "delay.h"
 #include "util.h"
 
 /* External declarations */
@@ -41,6 +45,10 @@ Boolean trace_parse = FALSE;
 Boolean trace_semantic = FALSE;
 Boolean trace_code = FALSE;
 Boolean generate_code = TRUE;
+Boolean bounds_checking = FALSE;
+Boolean delay_slot_filling = FALSE;
+Boolean multiply_chains = TRUE;
+const char *pass_pipeline = NULL;
 
 /* Optimization level */
 int optimization_level = 1;
@@ -48,6 +56,8 @@ int optimization_level = 1;
 /* Function prototypes */
 void print_usage(const char *program_name);
 void parse_arguments(int argc, char *argv[]);
+void parse_feature_flag(const char *flag, const char *program_name);
+long parse_count_option(const char *value, const char *option, const char *program_name);
 void compile_file(const char *filename);
 
 int main(int argc, char *argv[]) {
@@ -145,7 +155,7 @@ void compile_file(const char *filename) {
         generate_tac(ast_root);
         
         /* Phase 4: Optimization */
-        if (optimization_level > 0) {
+        if (optimization_level > 0 || pass_pipeline) {
             printf("\n=== PHASE 4: OPTIMIZATION ===\n");
             optimize_tac(optimization_level);
             
@@ -180,10 +190,24 @@ void parse_arguments(int argc, char *argv[]) {
         {"optimize",    required_argument, 0, 'O'},
         {"no-code",     no_argument,       0, 'n'},
         {"output",      required_argument, 0, 'o'},
+        {"passes",      required_argument, 0, 'P'},
+        {"opt-time-budget", required_argument, 0, 'B'},
+        {"opt-reduced-cost", required_argument, 0, 'R'},
+        {"opt-minimal-cost", required_argument, 0, 'M'},
         {0, 0, 0, 0}
     };
     
-    while ((opt = getopt_long(argc, argv, "hspacO:no:", long_options, NULL)) != -1) {
+    /* Accept the single-dash -passes= spelling too; getopt alone would
+       read it as the cluster -p -a -s ... */
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-passes=", 8) == 0) {
+            char *spelled = (char *)malloc(strlen(argv[i]) + 2);
+            sprintf(spelled, "-%s", argv[i]);
+            argv[i] = spelled;
+        }
+    }
+    
+    while ((opt = getopt_long(argc, argv, "hspacO:no:f:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'h':
                 print_usage(argv[0]);
@@ -223,6 +247,30 @@ void parse_arguments(int argc, char *argv[]) {
                 /* Output file handling would go here */
                 break;
                 
+            case 'f':
+                parse_feature_flag(optarg, argv[0]);
+                break;
+                
+            case 'P':
+                if (!validate_pass_pipeline(optarg)) {
+                    print_available_passes();
+                    exit(1);
+                }
+                pass_pipeline = optarg;
+                break;
+                
+            case 'B':
+                opt_time_budget_ms = parse_count_option(optarg, "--opt-time-budget", argv[0]);
+                break;
+                
+            case 'R':
+                reduced_tier_cost = parse_count_option(optarg, "--opt-reduced-cost", argv[0]);
+                break;
+                
+            case 'M':
+                minimal_tier_cost = parse_count_option(optarg, "--opt-minimal-cost", argv[0]);
+                break;
+                
             default:
                 print_usage(argv[0]);
                 exit(1);
@@ -230,6 +278,61 @@ void parse_arguments(int argc, char *argv[]) {
     }
 }
 
+/* Handle a -f<feature> code generation flag */
+void parse_feature_flag(const char *flag, const char *program_name) {
+    if (strcmp(flag, "bounds-check") == 0) {
+        bounds_checking = TRUE;
+        printf("Array bounds checking enabled\n");
+    } else if (strcmp(flag, "delay-slots") == 0 || strcmp(flag, "delay-slots=spim") == 0) {
+        delay_slot_filling = TRUE;
+        delay_slot_target = DELAY_SLOTS_SPIM;
+    } else if (strcmp(flag, "delay-slots=mars") == 0) {
+        delay_slot_filling = TRUE;
+        delay_slot_target = DELAY_SLOTS_MARS;
+    } else if (strcmp(flag, "mul-chains") == 0) {
+        multiply_chains = TRUE;
+    } else if (strcmp(flag, "no-mul-chains") == 0) {
+        multiply_chains = FALSE;
+    } else if (strcmp(flag, "regalloc=linear") == 0) {
+        register_allocator = REGALLOC_LINEAR;
+    } else if (strcmp(flag, "regalloc=graph") == 0) {
+        register_allocator = REGALLOC_GRAPH;
+    } else if (strcmp(flag, "select=tree") == 0) {
+        instruction_selector = SELECT_TREE;
+    } else if (strcmp(flag, "select=direct") == 0) {
+        instruction_selector = SELECT_DIRECT;
+    } else if (strcmp(flag, "peephole") == 0) {
+        peephole_mode = PEEPHOLE_ON;
+    } else if (strcmp(flag, "no-peephole") == 0) {
+        peephole_mode = PEEPHOLE_OFF;
+    } else if (strcmp(flag, "schedule") == 0) {
+        schedule_mode = SCHEDULE_ON;
+    } else if (strcmp(flag, "no-schedule") == 0) {
+        schedule_mode = SCHEDULE_OFF;
+    } else if (strcmp(flag, "omit-frame-pointer") == 0) {
+        frame_pointer_mode = FRAME_POINTER_OMIT;
+    } else if (strcmp(flag, "no-omit-frame-pointer") == 0) {
+        frame_pointer_mode = FRAME_POINTER_KEEP;
+    } else {
+        fprintf(stderr, "Error: Unknown flag -f%s\n", flag);
+        print_usage(program_name);
+        exit(1);
+    }
+}
+
+/* Parse the non-negative number of a --opt-* option */
+long parse_count_option(const char *value, const char *option, const char *program_name) {
+    char *end;
+    long number = strtol(value, &end, 10);
+    
+    if (*value == '\0' || *end != '\0' || number < 0) {
+        fprintf(stderr, "Error: %s expects a non-negative number, got '%s'\n", option, value);
+        print_usage(program_name);
+        exit(1);
+    }
+    return number;
+}
+
 /* Print usage information */
 void print_usage(const char *program_name) {
     printf("\nUsage: %s [options] source_file.cm\n", program_name);
@@ -242,8 +345,31 @@ void print_usage(const char *program_name) {
     printf("  -O<level>          Set optimization level (0-2)\n");
     printf("  -n, --no-code      Disable code generation\n");
     printf("  -o <file>          Specify output file\n");
+    printf("  -fbounds-check     Trap out-of-range array indices at run time\n");
+    printf("  -fdelay-slots[=<spim|mars>]  Emit .set noreorder and fill branch delay\n");
+    printf("                     slots for SPIM (default, run with -delayed_branches)\n");
+    printf("                     or MARS (no branch-likely, run with db)\n");
+    printf("  -f[no-]mul-chains  Multiply by constants with shifts and adds\n");
+    printf("                     (default: on)\n");
+    printf("  -fregalloc=<linear|graph>  Register allocator (default: graph at -O2,\n");
+    printf("                           linear scan below)\n");
+    printf("  -fselect=<tree|direct>     Instruction selector (default: tree tiling at\n");
+    printf("                           -O1 and above, one instruction at a time below)\n");
+    printf("  -f[no-]omit-frame-pointer  Address frames from $sp instead of $fp\n");
+    printf("                           (default: omitted at -O1 and above)\n");
+    printf("  -f[no-]peephole    Peephole-optimize the MIPS code (default: on at -O1\n");
+    printf("                     and above)\n");
+    printf("  -f[no-]schedule    Reorder MIPS instructions around load, multiply,\n");
+    printf("                     divide and branch latencies (default: on at -O2)\n");
+    printf("  -passes=<a,b,...>  Run these optimization passes (to a fixed point)\n");
+    printf("  --opt-time-budget=<ms>   Use lighter passes once optimization takes longer\n");
+    printf("  --opt-reduced-cost=<n>   Cost estimate above which a function skips\n");
+    printf("                           expensive passes (default %d)\n", DEFAULT_REDUCED_TIER_COST);
+    printf("  --opt-minimal-cost=<n>   Cost estimate above which a function gets only\n");
+    printf("                           linear passes (default %d)\n", DEFAULT_MINIMAL_TIER_COST);
     printf("\nExample:\n");
     printf("  %s -p -O2 test.cm    # Parse with AST display and optimize\n", program_name);
     printf("  %s -spacO2 test.cm   # Enable all tracing with optimization\n", program_name);
+    printf("  %s -passes=constprop,dce test.cm\n", program_name);
     printf("\n");
 }
\ No newline at end of file
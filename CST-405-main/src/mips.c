@@ -8,24 +8,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
 #include <ctype.h>
 #include "mips.h"
 #include "codegen.h"
 #include "symtab.h"
 #include "globals.h"
 #include "optimize.h"
+#include "regalloc.h"
+#include "select.h"
+#include "machine.h"
+#include "peephole.h"
+#include "schedule.h"
+#include "delay.h"
 
 /* Global MIPS context */
 static MIPSContext *mips_ctx = NULL;
 
-/* Register names */
-static const char *register_names[] = {
-    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
-    "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
-    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
-    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
-};
+/* Frame pointer use chosen by -f[no-]omit-frame-pointer */
+FramePointerMode frame_pointer_mode = FRAME_POINTER_DEFAULT;
+
+static void begin_machine_function(void);
+static void write_machine_function(void);
 
 /* Main MIPS generation function */
 void generate_mips(TACInstruction *tac_list, FILE *output) {
@@ -34,9 +37,21 @@ void generate_mips(TACInstruction *tac_list, FILE *output) {
     /* Initialize context */
     mips_ctx = (MIPSContext *)malloc(sizeof(MIPSContext));
     mips_ctx->output = output;
+    mips_ctx->writer = new_asm_writer(output);
+    mips_ctx->function = NULL;
     mips_ctx->stack_offset = 0;
     mips_ctx->param_offset = 0;
     mips_ctx->current_func = NULL;
+    mips_ctx->allocation = NULL;
+    mips_ctx->frame_size = 0;
+    mips_ctx->outgoing_size = 0;
+    mips_ctx->saves_ra = 0;
+    mips_ctx->saves_fp = 0;
+    mips_ctx->frame_base = REG_FP;
+    mips_ctx->formal_count = 0;
+    mips_ctx->selection = NULL;
+    mips_ctx->emitted = 0;
+    mips_ctx->function_emitted = 0;
     
     /* Initialize register table */
     for (int i = 0; i < 32; i++) {
@@ -51,6 +66,8 @@ void generate_mips(TACInstruction *tac_list, FILE *output) {
     /* Generate text section */
     emit_text_section();
     
+    printf("Register allocation:\n");
+    
     /* Generate code for each TAC instruction */
     TACInstruction *instr = tac_list;
     while (instr) {
@@ -61,11 +78,29 @@ void generate_mips(TACInstruction *tac_list, FILE *output) {
     /* Generate syscall functions */
     emit_syscall_functions();
     
+    printf("Instruction selection: %s, %d instructions emitted\n",
+           tree_selection_enabled() ? "tree" : "direct", mips_ctx->emitted);
+    if (peephole_enabled()) {
+        print_peephole_statistics();
+    }
+    if (scheduling_enabled()) {
+        print_schedule_statistics();
+    }
+    if (delay_slot_filling) {
+        print_delay_slot_statistics();
+    }
+    free_asm_writer(mips_ctx->writer);
+    free(mips_ctx);
+    mips_ctx = NULL;
     printf("MIPS code generation completed.\n");
 }
 
 /* Generate MIPS for a single TAC instruction */
 void gen_mips_instruction(TACInstruction *instr) {
+    if (mips_ctx->selection && emit_selected(mips_ctx->selection, instr)) {
+        return;     /* Covered by a tile */
+    }
+    
     switch (instr->opcode) {
         case TAC_ADD:
         case TAC_SUB:
@@ -103,6 +138,14 @@ void gen_mips_instruction(TACInstruction *instr) {
             gen_mips_function(instr);
             break;
             
+        case TAC_NEG:
+            gen_mips_arithmetic(instr);
+            break;
+            
+        case TAC_FORMAL:
+            gen_mips_formal(instr);
+            break;
+            
         case TAC_CALL:
         case TAC_PARAM:
             gen_mips_call(instr);
@@ -117,175 +160,960 @@ void gen_mips_instruction(TACInstruction *instr) {
             gen_mips_array(instr);
             break;
             
+        case TAC_BOUNDS_CHECK:
+            gen_mips_bounds_check(instr);
+            break;
+            
         default:
-            emit_mips("    # Unknown TAC opcode\n");
+            emit_comment("Unknown TAC opcode");
+    }
+}
+
+/* Check if a value fits the sign-extended 16-bit immediate of addi/slti */
+int fits_immediate(long value) {
+    return value >= -32768 && value <= 32767;
+}
+
+/* Check if a value fits the zero-extended 16-bit immediate of ori/xori */
+int fits_unsigned_immediate(long value) {
+    return value >= 0 && value <= 65535;
+}
+
+/* Check if an operand is known to hold a constant here: a literal, or a
+   value the allocator rematerializes */
+int operand_constant(char *operand, int *value) {
+    if (operand == NULL) return 0;
+    if (is_constant(operand)) {
+        *value = atoi(operand);
+        return 1;
+    }
+    return rematerialized_constant(mips_ctx->allocation, operand, value);
+}
+
+/* Exponent of a power of two, or -1 */
+static int power_of_two(int value) {
+    if (value <= 0 || (value & (value - 1)) != 0) return -1;
+    return __builtin_ctz(value);
+}
+
+/* Load a constant with the fewest instructions: one addiu (li) or ori
+   when it fits 16 bits, lui and ori otherwise */
+void load_constant(MIPSRegister reg, int value) {
+    unsigned int bits = (unsigned int)value;
+    
+    if (fits_immediate(value)) {
+        emit_ri(MOP_LI, reg, value);
+    } else if (fits_unsigned_immediate(value)) {
+        emit_rri(MOP_ORI, reg, REG_ZERO, (int)bits);
+    } else {
+        emit_ri(MOP_LUI, reg, (int)(bits >> 16));
+        if (bits & 0xFFFF) {
+            emit_rri(MOP_ORI, reg, reg, (int)(bits & 0xFFFF));
+        }
     }
 }
 
-/* Generate MIPS arithmetic operations */
+/* Generate MIPS arithmetic operations, with the immediate forms when an
+   operand is a constant that fits */
 void gen_mips_arithmetic(TACInstruction *instr) {
-    MIPSRegister rd = allocate_register(instr->result);
-    MIPSRegister rs = get_register(instr->arg1);
-    MIPSRegister rt = get_register(instr->arg2);
+    int value;
+    char *other = NULL;
+    
+    /* Normalize a foldable constant to the right of a commutative operation */
+    if (instr->arg2 && operand_constant(instr->arg2, &value)) {
+        other = instr->arg1;
+    } else if ((instr->opcode == TAC_ADD || instr->opcode == TAC_MUL) &&
+               instr->arg2 && operand_constant(instr->arg1, &value)) {
+        other = instr->arg2;
+    }
+    
+    if (other) {
+        long immediate = instr->opcode == TAC_SUB ? -(long)value : value;
+        int shift = power_of_two(value);
+        if ((instr->opcode == TAC_ADD || instr->opcode == TAC_SUB) && fits_immediate(immediate)) {
+            MIPSRegister rs = use_register(other, REG_T8);
+            MIPSRegister rd = def_register(instr->result, REG_T8);
+            emit_rri(MOP_ADDI, rd, rs, (int)immediate);
+            finish_def(instr->result, rd);
+            return;
+        }
+        if (instr->opcode == TAC_MUL && shift >= 0) {
+            MIPSRegister rs = use_register(other, REG_T8);
+            MIPSRegister rd = def_register(instr->result, REG_T8);
+            emit_rri(MOP_SLL, rd, rs, shift);
+            finish_def(instr->result, rd);
+            return;
+        }
+        if (instr->opcode == TAC_DIV && value != 0) {
+            MIPSRegister rs = use_register(other, REG_T8);
+            MIPSRegister rd = def_register(instr->result, REG_T8);
+            gen_divide_constant(rd, rs, value);
+            finish_def(instr->result, rd);
+            return;
+        }
+        if (instr->opcode == TAC_MUL && multiply_sequence_length(value) > 0) {
+            MIPSRegister rs = use_register(other, REG_T8);
+            MIPSRegister rd = def_register(instr->result, REG_T8);
+            gen_multiply_constant(rd, rs, value);
+            finish_def(instr->result, rd);
+            return;
+        }
+    }
+    
+    MIPSRegister rs = use_register(instr->arg1, REG_T8);
+    MIPSRegister rt = instr->arg2 ? use_register(instr->arg2, REG_T9) : REG_ZERO;
+    MIPSRegister rd = def_register(instr->result, REG_T8);
     
     switch (instr->opcode) {
         case TAC_ADD:
-            emit_mips("    add %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_ADD, rd, rs, rt);
             break;
         case TAC_SUB:
-            emit_mips("    sub %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SUB, rd, rs, rt);
             break;
         case TAC_MUL:
-            emit_mips("    mul %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_MUL, rd, rs, rt);
             break;
         case TAC_DIV:
-            emit_mips("    div %s, %s\n", reg_name(rs), reg_name(rt));
-            emit_mips("    mflo %s\n", reg_name(rd));
+            emit_rr(MOP_DIV, rs, rt);
+            emit_instruction(MOP_MFLO, machine_reg(rd), NO_OPERAND, NO_OPERAND);
+            break;
+        case TAC_NEG:
+            emit_rrr(MOP_SUB, rd, REG_ZERO, rs);
             break;
         default:
             break;
     }
     
-    mips_ctx->regs[rd].is_dirty = 1;
+    finish_def(instr->result, rd);
 }
 
 /* Generate MIPS assignment */
 void gen_mips_assignment(TACInstruction *instr) {
+    int value;
+    if (rematerialized_constant(mips_ctx->allocation, instr->result, &value)) {
+        return;     /* Recomputed where it is used */
+    }
+    
     if (instr->opcode == TAC_LOAD_CONST) {
         /* Load constant */
-        MIPSRegister rd = allocate_register(instr->result);
-        int value = atoi(instr->arg1);
-        emit_mips("    li %s, %d\n", reg_name(rd), value);
-        mips_ctx->regs[rd].is_dirty = 1;
+        MIPSRegister rd = def_register(instr->result, REG_T8);
+        load_constant(rd, atoi(instr->arg1));
+        finish_def(instr->result, rd);
     } else {
-        /* Copy assignment */
-        MIPSRegister rs = get_register(instr->arg1);
-        MIPSRegister rd = allocate_register(instr->result);
+        /* Copy assignment: coalesced copies need no instruction */
+        int slot = spill_slot_of(mips_ctx->allocation, instr->result);
+        if (slot >= 0 && slot == spill_slot_of(mips_ctx->allocation, instr->arg1)) {
+            return;
+        }
+        MIPSRegister rd = def_register(instr->result, REG_T8);
+        MIPSRegister rs = use_register(instr->arg1, rd);
         
         if (rd != rs) {
-            emit_mips("    move %s, %s\n", reg_name(rd), reg_name(rs));
-            mips_ctx->regs[rd].is_dirty = 1;
+            emit_rr(MOP_MOVE, rd, rs);
+        }
+        finish_def(instr->result, rd);
+    }
+}
+
+/* Comparison that gives the same result with its operands swapped */
+TACOpcode mirror_comparison(TACOpcode op) {
+    switch (op) {
+        case TAC_LT:  return TAC_GT;
+        case TAC_LTE: return TAC_GTE;
+        case TAC_GT:  return TAC_LT;
+        case TAC_GTE: return TAC_LTE;
+        default:      return op;
+    }
+}
+
+/* ---- Multiplication by a constant ----
+ *
+ * x * c becomes a chain of sll, addu and subu on x (addu and subu wrap
+ * as mul does, where add and sub would trap). The shortest chain is
+ * found by iterative deepening over the ways of reaching c:
+ *   c even:               (x * c/2^k) << k
+ *   c odd:                (x * (c-1)) + x,  (x * (c+1)) - x
+ *   c = c' * (2^k +- 1):  t = x * c', then (t << k) +- t
+ *   c negative:           x - (x * (1-c)),  0 - (x * -c)
+ * The chain replaces li and mul when its result is ready sooner: each
+ * step takes a cycle, against loading the constant plus the multiplier's
+ * latency (on a tie li and mul are fewer instructions).
+ */
+
+typedef enum {
+    MSTEP_SHIFT,               /* t << k */
+    MSTEP_ADD,                 /* t + x */
+    MSTEP_SUB,                 /* t - x */
+    MSTEP_REVERSE_SUB,         /* x - t */
+    MSTEP_NEGATE,              /* 0 - t */
+    MSTEP_FACTOR_ADD,          /* (t << k) + t, with a second register */
+    MSTEP_FACTOR_SUB           /* (t << k) - t */
+} MultiplyStepKind;
+
+typedef struct {
+    MultiplyStepKind kind;
+    int shift;
+} MultiplyStep;
+
+typedef struct {
+    MultiplyStep step[MULTIPLY_SEQUENCE_LIMIT];
+    int count;
+    int factors;               /* A second scratch register is free */
+} MultiplySequence;
+
+static int push_multiply_step(MultiplySequence *seq, MultiplyStepKind kind, int shift) {
+    seq->step[seq->count].kind = kind;
+    seq->step[seq->count].shift = shift;
+    seq->count++;
+    return 1;
+}
+
+/* Find steps computing x * c from x in at most budget instructions,
+   appending them to seq */
+static int find_multiply_steps(unsigned int c, int budget, MultiplySequence *seq) {
+    int negative = c > 0x80000000u;
+
+    if (c == 1) return 1;
+    if (c == 0 || budget <= 0) return 0;
+
+    if ((c & 1) == 0) {
+        /* Any c' with c' << k == c will do: keep a negative one negative */
+        int k = __builtin_ctz(c);
+        unsigned int odd = negative ? (unsigned int)((int)c >> k) : c >> k;
+        if (find_multiply_steps(odd, budget - 1, seq)) {
+            return push_multiply_step(seq, MSTEP_SHIFT, k);
+        }
+        if (negative && find_multiply_steps(-c, budget - 1, seq)) {
+            return push_multiply_step(seq, MSTEP_NEGATE, 0);
+        }
+        return 0;
+    }
+
+    int start = seq->count;
+    if (find_multiply_steps(c - 1, budget - 1, seq)) {
+        return push_multiply_step(seq, MSTEP_ADD, 0);
+    }
+    seq->count = start;
+    if (c + 1 != 0 && find_multiply_steps(c + 1, budget - 1, seq)) {
+        return push_multiply_step(seq, MSTEP_SUB, 0);
+    }
+    seq->count = start;
+    if (negative) {
+        if (find_multiply_steps(1 - c, budget - 1, seq)) {
+            return push_multiply_step(seq, MSTEP_REVERSE_SUB, 0);
+        }
+        seq->count = start;
+        if (find_multiply_steps(-c, budget - 1, seq)) {
+            return push_multiply_step(seq, MSTEP_NEGATE, 0);
+        }
+        seq->count = start;
+    }
+    if (seq->factors && budget >= 2) {
+        for (int k = 1; k < 31; k++) {
+            unsigned int plus = (1u << k) + 1, minus = (1u << k) - 1;
+            if (c % plus == 0 && find_multiply_steps(c / plus, budget - 2, seq)) {
+                return push_multiply_step(seq, MSTEP_FACTOR_ADD, k);
+            }
+            seq->count = start;
+            if (minus > 1 && c % minus == 0 && find_multiply_steps(c / minus, budget - 2, seq)) {
+                return push_multiply_step(seq, MSTEP_FACTOR_SUB, k);
+            }
+            seq->count = start;
+        }
+    }
+    return 0;
+}
+
+/* Instructions in a step */
+static int multiply_step_length(MultiplyStep *step) {
+    return step->kind == MSTEP_FACTOR_ADD || step->kind == MSTEP_FACTOR_SUB ? 2 : 1;
+}
+
+/* Shortest sequence for x * value within the limit, or 0 */
+static int plan_multiply(int value, int factors, int limit, MultiplySequence *seq) {
+    seq->factors = factors;
+    for (int budget = 1; budget <= limit && budget <= MULTIPLY_SEQUENCE_LIMIT; budget++) {
+        seq->count = 0;
+        if (find_multiply_steps((unsigned int)value, budget, seq)) {
+            int length = 0;
+            for (int i = 0; i < seq->count; i++) length += multiply_step_length(&seq->step[i]);
+            return length > 0 ? length : 1;    /* x * 1 is a move */
+        }
+    }
+    return 0;
+}
+
+/* Longest sequence that beats loading value and multiplying by it: li
+   (or lui and ori) and mul's latency, less a cycle */
+static int multiply_sequence_limit(int value) {
+    int load = fits_immediate(value) || fits_unsigned_immediate(value) ||
+               ((unsigned int)value & 0xFFFF) == 0 ? 1 : 2;
+    return value == 0 ? 0 : load + machine_latency(MOP_MUL) - 1;
+}
+
+/* Length of the shift-and-add sequence for a multiplication by value, or
+   0 when loading the constant and multiplying is faster (or chains are
+   turned off with -fno-mul-chains) */
+int multiply_sequence_length(int value) {
+    MultiplySequence seq;
+    if (!multiply_chains) return 0;
+    return plan_multiply(value, 1, multiply_sequence_limit(value), &seq);
+}
+
+/* rd = rs * value as a shift-and-add sequence. Intermediate values go to
+   rd, or to a scratch register when rd is rs (x is read to the end); a
+   second scratch register holds t << k for the factor steps. Without a
+   short enough sequence for the registers at hand, li and mul are used */
+void gen_multiply_constant(MIPSRegister rd, MIPSRegister rs, int value) {
+    MIPSRegister scratch[2];
+    int free_count = 0;
+    MultiplySequence seq;
+
+    if (rs != REG_T9 && rd != REG_T9) scratch[free_count++] = REG_T9;
+    if (rs != REG_T8 && rd != REG_T8) scratch[free_count++] = REG_T8;
+
+    MIPSRegister acc = rd != rs ? rd : scratch[0];
+    int temps = free_count - (rd != rs ? 0 : 1);
+
+    if (!plan_multiply(value, temps > 0, multiply_sequence_limit(value), &seq)) {
+        load_constant(scratch[0], value);
+        emit_rrr(MOP_MUL, rd, rs, scratch[0]);
+        return;
+    }
+    if (seq.count == 0) {
+        if (rd != rs) emit_rr(MOP_MOVE, rd, rs);
+        return;
+    }
+
+    MIPSRegister temp = scratch[free_count - 1];
+    MIPSRegister in = rs;
+    for (int i = 0; i < seq.count; i++) {
+        MultiplyStep *step = &seq.step[i];
+        MIPSRegister out = i == seq.count - 1 ? rd : acc;
+
+        switch (step->kind) {
+            case MSTEP_SHIFT:
+                emit_rri(MOP_SLL, out, in, step->shift);
+                break;
+            case MSTEP_ADD:
+                emit_rrr(MOP_ADDU, out, in, rs);
+                break;
+            case MSTEP_SUB:
+                emit_rrr(MOP_SUBU, out, in, rs);
+                break;
+            case MSTEP_REVERSE_SUB:
+                emit_rrr(MOP_SUBU, out, rs, in);
+                break;
+            case MSTEP_NEGATE:
+                emit_rrr(MOP_SUBU, out, REG_ZERO, in);
+                break;
+            case MSTEP_FACTOR_ADD:
+            case MSTEP_FACTOR_SUB:
+                emit_rri(MOP_SLL, temp, in, step->shift);
+                emit_rrr(step->kind == MSTEP_FACTOR_ADD ? MOP_ADDU : MOP_SUBU, out, temp, in);
+                break;
+        }
+        in = out;
+    }
+}
+
+/* ---- Division by a constant ----
+ *
+ * x / d for a constant d other than 0 avoids div, whose quotient takes
+ * some 35 cycles. For d = +-2^k the quotient is x >> k with sra, after
+ * adding 2^k - 1 to a negative x so it rounds toward zero. Otherwise
+ * (Granlund and Montgomery, as in Hacker's Delight 10-1) it is the high
+ * word of x * M for a magic number M ~ 2^(32+s) / d, corrected by adding
+ * or subtracting x when M's sign differs from d's, shifted right by s,
+ * and plus one when negative to round toward zero.
+ */
+
+/* Magic number M and shift s for signed division by d, |d| >= 2 and not
+   a power of two */
+static void divide_magic(int d, int *magic, int *shift) {
+    const unsigned int two31 = 0x80000000u;
+    unsigned int ad = d < 0 ? -(unsigned int)d : (unsigned int)d;
+    unsigned int t = two31 + ((unsigned int)d >> 31);
+    unsigned int anc = t - 1 - t % ad;     /* |nc|, the largest multiple of d less 1 */
+    unsigned int q1 = two31 / anc, r1 = two31 - q1 * anc;
+    unsigned int q2 = two31 / ad, r2 = two31 - q2 * ad;
+    unsigned int delta;
+    int p = 31;
+
+    do {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    *magic = d < 0 ? -(int)(q2 + 1) : (int)(q2 + 1);
+    *shift = p - 32;
+}
+
+/* rd = rs / value, rounding toward zero, for a value other than 0.
+   Intermediate values go to rd, or to $t9 when rd is rs */
+void gen_divide_constant(MIPSRegister rd, MIPSRegister rs, int value) {
+    unsigned int magnitude = value < 0 ? -(unsigned int)value : (unsigned int)value;
+    MIPSRegister acc = rd != rs ? rd : REG_T9;
+
+    if (magnitude == 1) {
+        if (value < 0) {
+            emit_rrr(MOP_SUBU, rd, REG_ZERO, rs);
+        } else if (rd != rs) {
+            emit_rr(MOP_MOVE, rd, rs);
+        }
+        return;
+    }
+
+    if ((magnitude & (magnitude - 1)) == 0) {
+        int k = __builtin_ctz(magnitude);
+        if (k == 1) {
+            emit_rri(MOP_SRL, acc, rs, 31);
+        } else {
+            emit_rri(MOP_SRA, acc, rs, 31);
+            emit_rri(MOP_SRL, acc, acc, 32 - k);
         }
+        emit_rrr(MOP_ADDU, acc, acc, rs);
+        emit_rri(MOP_SRA, rd, acc, k);
+        if (value < 0) emit_rrr(MOP_SUBU, rd, REG_ZERO, rd);
+        return;
+    }
+
+    int magic, shift;
+    divide_magic(value, &magic, &shift);
+    load_constant(REG_T9, magic);
+    emit_rr(MOP_MULT, rs, REG_T9);
+    emit_instruction(MOP_MFHI, machine_reg(acc), NO_OPERAND, NO_OPERAND);
+    if (value > 0 && magic < 0) emit_rrr(MOP_ADDU, acc, acc, rs);
+    if (value < 0 && magic > 0) emit_rrr(MOP_SUBU, acc, acc, rs);
+    if (shift > 0) emit_rri(MOP_SRA, acc, acc, shift);
+
+    /* The sign bit, into whichever of rd and $t9 acc is not (rs is no
+       longer needed) */
+    MIPSRegister sign = acc == rd ? REG_T9 : rd;
+    emit_rri(MOP_SRL, sign, acc, 31);
+    emit_rrr(MOP_ADDU, rd, acc, sign);
+}
+
+/* Check if a comparison with the constant c has an immediate form */
+static int comparison_immediate_fits(TACOpcode op, long c) {
+    switch (op) {
+        case TAC_LT:
+        case TAC_GTE:
+            return fits_immediate(c);
+        case TAC_LTE:
+        case TAC_GT:
+            return fits_immediate(c + 1);
+        case TAC_EQ:
+        case TAC_NEQ:
+            return fits_unsigned_immediate(c) || fits_immediate(-c);
+        default:
+            return 0;
+    }
+}
+
+/* Compare rs with a constant using slti/sltiu, plus xori to negate:
+   x <= c is x < c+1 and x > c is !(x < c+1) */
+void gen_comparison_immediate(TACOpcode op, MIPSRegister rd, MIPSRegister rs, long c) {
+    switch (op) {
+        case TAC_LT:
+        case TAC_GTE:
+            emit_rri(MOP_SLTI, rd, rs, (int)c);
+            break;
+        case TAC_LTE:
+        case TAC_GT:
+            emit_rri(MOP_SLTI, rd, rs, (int)(c + 1));
+            break;
+        default:
+            /* Equality: test rs - c (or rs ^ c) against zero */
+            if (c != 0 && fits_unsigned_immediate(c)) {
+                emit_rri(MOP_XORI, rd, rs, (int)c);
+                rs = rd;
+            } else if (c != 0) {
+                emit_rri(MOP_ADDIU, rd, rs, (int)-c);
+                rs = rd;
+            }
+            if (op == TAC_EQ) {
+                emit_rri(MOP_SLTIU, rd, rs, 1);
+            } else {
+                emit_rrr(MOP_SLTU, rd, REG_ZERO, rs);
+            }
+            return;
+    }
+    
+    if (op == TAC_GT || op == TAC_GTE) {
+        emit_rri(MOP_XORI, rd, rd, 1);
     }
 }
 
-/* Generate MIPS comparison */
+/* Generate MIPS comparison, with an immediate form when one operand is
+   a constant that fits */
 void gen_mips_comparison(TACInstruction *instr) {
-    MIPSRegister rd = allocate_register(instr->result);
-    MIPSRegister rs = get_register(instr->arg1);
-    MIPSRegister rt = get_register(instr->arg2);
+    int value;
+    TACOpcode op = instr->opcode;
+    char *other = NULL;
+    
+    if (operand_constant(instr->arg2, &value)) {
+        other = instr->arg1;
+    } else if (operand_constant(instr->arg1, &value)) {
+        other = instr->arg2;
+        op = mirror_comparison(op);
+    }
+    
+    if (other && comparison_immediate_fits(op, value)) {
+        MIPSRegister rs = use_register(other, REG_T8);
+        MIPSRegister rd = def_register(instr->result, REG_T8);
+        gen_comparison_immediate(op, rd, rs, value);
+        finish_def(instr->result, rd);
+        return;
+    }
+    
+    MIPSRegister rs = use_register(instr->arg1, REG_T8);
+    MIPSRegister rt = use_register(instr->arg2, REG_T9);
+    MIPSRegister rd = def_register(instr->result, REG_T8);
     
     switch (instr->opcode) {
         case TAC_LT:
-            emit_mips("    slt %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SLT, rd, rs, rt);
             break;
         case TAC_LTE:
-            emit_mips("    sle %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SLE, rd, rs, rt);
             break;
         case TAC_GT:
-            emit_mips("    sgt %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SGT, rd, rs, rt);
             break;
         case TAC_GTE:
-            emit_mips("    sge %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SGE, rd, rs, rt);
             break;
         case TAC_EQ:
-            emit_mips("    seq %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SEQ, rd, rs, rt);
             break;
         case TAC_NEQ:
-            emit_mips("    sne %s, %s, %s\n", reg_name(rd), reg_name(rs), reg_name(rt));
+            emit_rrr(MOP_SNE, rd, rs, rt);
             break;
         default:
             break;
     }
     
-    mips_ctx->regs[rd].is_dirty = 1;
+    finish_def(instr->result, rd);
 }
 
 /* Generate MIPS branch */
 void gen_mips_branch(TACInstruction *instr) {
     if (instr->opcode == TAC_GOTO) {
-        emit_mips("    j L%d\n", instr->label);
+        emit_jump(MOP_J, machine_label(instr->label));
     } else {
-        MIPSRegister rs = get_register(instr->result);
+        MIPSRegister rs = use_register(instr->result, REG_T8);
         
         if (instr->opcode == TAC_IF_TRUE) {
-            emit_mips("    bnez %s, L%d\n", reg_name(rs), instr->label);
+            emit_branch(MOP_BNEZ, rs, machine_label(instr->label));
         } else {
-            emit_mips("    beqz %s, L%d\n", reg_name(rs), instr->label);
+            emit_branch(MOP_BEQZ, rs, machine_label(instr->label));
+        }
+    }
+}
+
+/* Operands of an instruction that may be integer constants */
+static int constant_operands(TACInstruction *instr, char **operands[3]) {
+    int count = 0;
+    
+    switch (instr->opcode) {
+        case TAC_FUNC_BEGIN:
+        case TAC_FUNC_END:
+        case TAC_LOAD_CONST:
+        case TAC_CALL:
+        case TAC_BOUNDS_CHECK:
+        case TAC_LABEL:
+        case TAC_GOTO:
+        case TAC_FORMAL:
+            return 0;
+        default:
+            break;
+    }
+    if (instr->arg1) operands[count++] = &instr->arg1;
+    if (instr->arg2) operands[count++] = &instr->arg2;
+    if (uses_result(instr) && instr->opcode != TAC_ARRAY_STORE && instr->result) {
+        operands[count++] = &instr->result;
+    }
+    return count;
+}
+
+/* Check if a constant operand needs lui and ori */
+static int is_large_constant(char *operand) {
+    if (!is_constant(operand)) return 0;
+    long value = atol(operand);
+    return !fits_immediate(value) && !fits_unsigned_immediate(value);
+}
+
+/* Uses of a constant from instr to the end of its block */
+static int constant_uses_in_block(TACInstruction *instr, char *constant) {
+    int uses = 0;
+    
+    for (; instr && instr->opcode != TAC_LABEL && instr->opcode != TAC_FUNC_END;
+         instr = instr->next) {
+        char **operands[3];
+        int count = constant_operands(instr, operands);
+        for (int k = 0; k < count; k++) {
+            if (strcmp(*operands[k], constant) == 0) uses++;
+        }
+        if (ends_block(instr)) break;
+    }
+    return uses;
+}
+
+/* Materialize each constant that needs lui and ori once per basic block
+   when the block uses it more than once: a new temporary loaded before
+   the first use replaces the rest, and the allocator keeps it in a
+   register (or rematerializes it when registers run out) */
+static void materialize_large_constants(TACInstruction *func_begin) {
+    TACInstruction *prev = func_begin;
+    
+    for (TACInstruction *instr = func_begin->next; instr && instr->opcode != TAC_FUNC_END;
+         prev = instr, instr = instr->next) {
+        char **operands[3];
+        int count = constant_operands(instr, operands);
+        
+        for (int k = 0; k < count; k++) {
+            char *constant = *operands[k];
+            if (!is_large_constant(constant) || constant_uses_in_block(instr, constant) < 2) {
+                continue;
+            }
+            
+            char *temp = new_temp();
+            char *value = copy_string(constant);
+            TACInstruction *load = create_tac(TAC_LOAD_CONST, temp, value, NULL);
+            insert_tac_after(prev, load);
+            prev = load;
+            
+            /* Replace the uses up to the end of the block */
+            for (TACInstruction *use = instr; use && use->opcode != TAC_LABEL &&
+                 use->opcode != TAC_FUNC_END; use = use->next) {
+                char **slots[3];
+                int uses = constant_operands(use, slots);
+                for (int u = 0; u < uses; u++) {
+                    if (strcmp(*slots[u], value) == 0) {
+                        free(*slots[u]);
+                        *slots[u] = copy_string(temp);
+                    }
+                }
+                if (ends_block(use)) break;
+            }
+            free(value);
+            free(temp);
+        }
+    }
+}
+
+/* Check if an operand names a global array */
+static int is_global_array(char *name) {
+    if (name == NULL || !is_global_var(name)) return 0;
+    return lookup_symbol_in_scope(name, global_scope)->kind == SYMBOL_ARRAY;
+}
+
+/* Operand naming the array of an element load or store, or NULL */
+static char **array_operand(TACInstruction *instr) {
+    if (instr->opcode == TAC_ARRAY_LOAD) return &instr->arg1;
+    if (instr->opcode == TAC_ARRAY_STORE) return &instr->result;
+    return NULL;
+}
+
+/* Load the address of each global array the function indexes often (in
+   a loop, or GLOBAL_BASE_MIN_USES times) into a new temporary at its
+   entry, after the formals, and index from that instead; the label
+   address is otherwise formed again at every access (lui and addu) */
+static void hoist_global_array_bases(TACInstruction *func_begin) {
+    int n = 0;
+    for (TACInstruction *i = func_begin->next; i && i->opcode != TAC_FUNC_END; i = i->next) {
+        n++;
+    }
+    if (n == 0) return;
+    
+    TACInstruction **code = (TACInstruction **)malloc(n * sizeof(TACInstruction *));
+    int *in_loop = (int *)calloc(n, sizeof(int));
+    char **arrays = (char **)malloc(n * sizeof(char *));
+    int *weight = (int *)calloc(n, sizeof(int));
+    int array_count = 0;
+    
+    n = 0;
+    for (TACInstruction *i = func_begin->next; i && i->opcode != TAC_FUNC_END; i = i->next) {
+        code[n++] = i;
+    }
+    
+    /* A loop runs from a label to a later jump back to it */
+    for (int j = 0; j < n; j++) {
+        if (!is_jump(code[j])) continue;
+        for (int k = j - 1; k >= 0; k--) {
+            if (code[k]->opcode == TAC_LABEL && code[k]->label == code[j]->label) {
+                for (int m = k; m <= j; m++) in_loop[m] = 1;
+                break;
+            }
+        }
+    }
+    
+    for (int j = 0; j < n; j++) {
+        char **array = array_operand(code[j]);
+        if (array == NULL || !is_global_array(*array)) continue;
+        int a = 0;
+        while (a < array_count && strcmp(arrays[a], *array) != 0) a++;
+        if (a == array_count) arrays[array_count++] = *array;
+        weight[a] += in_loop[j] ? GLOBAL_BASE_MIN_USES : 1;
+    }
+    
+    TACInstruction *entry = func_begin;
+    while (entry->next && entry->next->opcode == TAC_FORMAL) {
+        entry = entry->next;
+    }
+    for (int a = 0; a < array_count; a++) {
+        if (weight[a] < GLOBAL_BASE_MIN_USES) continue;
+        
+        char *temp = new_temp();
+        char *name = copy_string(arrays[a]);
+        insert_tac_after(entry, create_tac(TAC_ASSIGN, temp, name, NULL));
+        for (int j = 0; j < n; j++) {
+            char **array = array_operand(code[j]);
+            if (array && strcmp(*array, name) == 0) {
+                free(*array);
+                *array = copy_string(temp);
+            }
+        }
+        free(name);
+        free(temp);
+    }
+    
+    free(code);
+    free(in_loop);
+    free(arrays);
+    free(weight);
+}
+
+/* Callee-saved registers the prologue must preserve: the $s registers
+   the allocation uses, except in main, which exits instead of returning */
+static unsigned int saved_registers(void) {
+    if (strcmp(mips_ctx->current_func, "main") == 0) return 0;
+    return mips_ctx->allocation->used_mask & CALLEE_SAVED_MASK;
+}
+
+/* Bytes a function needs for the arguments beyond the fourth of its
+   calls; there is no home area, since callees never store $a0-$a3 */
+static int outgoing_arguments_size(TACInstruction *func_begin) {
+    int most = 0;
+    for (TACInstruction *instr = func_begin->next; instr && instr->opcode != TAC_FUNC_END;
+         instr = instr->next) {
+        if (instr->opcode == TAC_CALL && instr->arg2 && atoi(instr->arg2) - 4 > most) {
+            most = atoi(instr->arg2) - 4;
+        }
+    }
+    return 4 * most;
+}
+
+/* Store (or reload) $ra, $fp and the saved $s registers at the top of
+   the frame, in that order downward */
+static void save_registers(int restore) {
+    MachineOpcode op = restore ? MOP_LW : MOP_SW;
+    unsigned int saved_mask = saved_registers();
+    int offset = mips_ctx->frame_size - 4;
+    
+    if (mips_ctx->saves_ra) {
+        emit_memory(op, REG_RA, machine_mem(offset, REG_SP));
+        offset -= 4;
+    }
+    if (mips_ctx->saves_fp) {
+        emit_memory(op, REG_FP, machine_mem(offset, REG_SP));
+        offset -= 4;
+    }
+    for (int r = REG_S0; r <= REG_S7; r++) {
+        if (saved_mask & (1u << r)) {
+            emit_memory(op, r, machine_mem(offset, REG_SP));
+            offset -= 4;
         }
     }
 }
 
-/* Generate MIPS function prologue/epilogue */
+/* Generate MIPS function prologue/epilogue. The frame holds, from $sp
+   up: the outgoing stack arguments, the local area (spill slots and
+   local arrays, laid out by the register allocator), the saved $s
+   registers, $fp and $ra, padded to FRAME_ALIGNMENT. Only what the
+   function needs is there: a leaf keeps no $ra, and one with nothing in
+   memory gets no frame at all. The frame is addressed from $fp, or from
+   $sp with -fomit-frame-pointer, since $sp does not move in the body */
 void gen_mips_function(TACInstruction *instr) {
     if (instr->opcode == TAC_FUNC_BEGIN) {
         mips_ctx->current_func = instr->result;
         mips_ctx->stack_offset = 0;
+        mips_ctx->param_offset = 0;
+        mips_ctx->formal_count = 0;
+        materialize_large_constants(instr);
+        hoist_global_array_bases(instr);
+        mips_ctx->allocation = allocate_registers(instr);
+        print_register_allocation(mips_ctx->allocation);
+        mips_ctx->selection = tree_selection_enabled() ?
+                              select_instructions(instr, mips_ctx->allocation) : NULL;
+        mips_ctx->function_emitted = mips_ctx->emitted;
+        for (int r = 0; r < 32; r++) {
+            mips_ctx->regs[r].var_name = NULL;
+            mips_ctx->regs[r].is_dirty = 0;
+            mips_ctx->regs[r].last_use = 0;
+        }
+        
+        RegisterAllocation *alloc = mips_ctx->allocation;
+        int is_main = strcmp(instr->result, "main") == 0;
+        int leaf = 1;
+        for (TACInstruction *i = instr->next; i && i->opcode != TAC_FUNC_END; i = i->next) {
+            if (i->opcode == TAC_CALL) leaf = 0;
+        }
+        unsigned int saved_mask = saved_registers();
+        int saved = 0;
+        for (int r = REG_S0; r <= REG_S7; r++) {
+            if (saved_mask & (1u << r)) saved++;
+        }
+        
+        /* main exits instead of returning, so it keeps nothing for a caller */
+        mips_ctx->outgoing_size = outgoing_arguments_size(instr);
+        mips_ctx->saves_ra = !leaf && !is_main;
+        int frame = mips_ctx->outgoing_size + alloc->frame_bytes + 4 * saved +
+                    (mips_ctx->saves_ra ? 4 : 0);
+        int keep_fp = frame_pointer_mode == FRAME_POINTER_KEEP ||
+                      (frame_pointer_mode == FRAME_POINTER_DEFAULT &&
+                       optimization_level < OPT_BASIC);
+        mips_ctx->frame_base = keep_fp && frame > 0 ? REG_FP : REG_SP;
+        mips_ctx->saves_fp = mips_ctx->frame_base == REG_FP && !is_main;
+        frame += mips_ctx->saves_fp ? 4 : 0;
+        mips_ctx->frame_size = (frame + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
         
-        emit_mips("\n%s:\n", instr->result);
+        begin_machine_function();
+        emit_symbol_label(instr->result);
+        mips_ctx->exit_label = machine_string(mips_ctx->function, instr->result, "_exit");
         
         /* Function prologue */
-        emit_mips("    # Function prologue\n");
-        emit_mips("    addi $sp, $sp, -32\n");  /* Allocate stack frame */
-        emit_mips("    sw $ra, 28($sp)\n");      /* Save return address */
-        emit_mips("    sw $fp, 24($sp)\n");      /* Save frame pointer */
-        emit_mips("    move $fp, $sp\n");        /* Set new frame pointer */
+        if (mips_ctx->frame_size == 0) {
+            emit_comment(leaf ? "Leaf function: no stack frame" : "No stack frame");
+        } else {
+            emit_comment("Function prologue");
+            emit_rri(MOP_ADDI, REG_SP, REG_SP, -mips_ctx->frame_size);   /* Allocate stack frame */
+            save_registers(0);
+            if (mips_ctx->frame_base == REG_FP) {
+                emit_rr(MOP_MOVE, REG_FP, REG_SP);     /* Set new frame pointer */
+            }
+        }
         
     } else if (instr->opcode == TAC_FUNC_END) {
-        /* Function epilogue */
-        emit_mips("    # Function epilogue\n");
-        emit_mips("    move $sp, $fp\n");        /* Restore stack pointer */
-        emit_mips("    lw $fp, 24($sp)\n");      /* Restore frame pointer */
-        emit_mips("    lw $ra, 28($sp)\n");      /* Restore return address */
-        emit_mips("    addi $sp, $sp, 32\n");    /* Deallocate stack frame */
+        /* Function epilogue, shared by every return */
+        emit_symbol_label(mips_ctx->exit_label);
+        if (mips_ctx->frame_size > 0) {
+            emit_comment("Function epilogue");
+            if (mips_ctx->frame_base == REG_FP) {
+                emit_rr(MOP_MOVE, REG_SP, REG_FP);     /* Restore stack pointer */
+            }
+            save_registers(1);
+            emit_rri(MOP_ADDI, REG_SP, REG_SP, mips_ctx->frame_size);    /* Deallocate stack frame */
+        }
         
         if (strcmp(mips_ctx->current_func, "main") == 0) {
             /* Exit for main function */
-            emit_mips("    li $v0, 10\n");       /* Exit syscall */
-            emit_mips("    syscall\n");
+            emit_ri(MOP_LI, REG_V0, 10);       /* Exit syscall */
+            emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
         } else {
-            emit_mips("    jr $ra\n");           /* Return */
+            emit_jump(MOP_JR, machine_reg(REG_RA));           /* Return */
+        }
+        
+        print_selection(mips_ctx->current_func, mips_ctx->selection,
+                        mips_ctx->emitted - mips_ctx->function_emitted);
+        if (peephole_enabled()) {
+            peephole_optimize(mips_ctx->function);
+        }
+        if (scheduling_enabled()) {
+            schedule_function(mips_ctx->function);
+        }
+        write_machine_function();
+        free_selection(mips_ctx->selection);
+        mips_ctx->selection = NULL;
+        free_register_allocation(mips_ctx->allocation);
+        mips_ctx->allocation = NULL;
+    }
+}
+
+/* Generate MIPS for an incoming parameter: the first four arrive in
+   $a0-$a3, where the allocator usually leaves them; the rest are read
+   from the caller's outgoing area, just above this frame */
+void gen_mips_formal(TACInstruction *instr) {
+    int k = mips_ctx->formal_count++;
+    MIPSRegister rd = def_register(instr->result, REG_T8);
+    
+    if (k < 4) {
+        if (rd != REG_A0 + k) {
+            emit_rr(MOP_MOVE, rd, REG_A0 + k);
         }
+    } else {
+        emit_memory(MOP_LW, rd, machine_mem(mips_ctx->frame_size + 4 * (k - 4),
+                                            mips_ctx->frame_base));
+    }
+    finish_def(instr->result, rd);
+}
+
+/* Store (or reload) the values kept in caller-saved registers across a
+   call, to and from their frame slots */
+static void save_around_call(TACInstruction *call, int reload) {
+    RegisterAllocation *alloc = mips_ctx->allocation;
+    for (int i = 0; i < alloc->call_save_count; i++) {
+        if (alloc->call_saves[i].call != call) continue;
+        int v = alloc->call_saves[i].value;
+        emit_memory(reload ? MOP_LW : MOP_SW, alloc->location[v],
+                    machine_mem(spill_offset(alloc->spill_slot[v]), mips_ctx->frame_base));
     }
 }
 
 /* Generate MIPS function call */
 void gen_mips_call(TACInstruction *instr) {
     if (instr->opcode == TAC_PARAM) {
-        /* Push parameter */
-        MIPSRegister rs = get_register(instr->result);
-        
+        /* Pass parameter */
         if (mips_ctx->param_offset < 4) {
-            /* First 4 parameters in $a0-$a3 */
-            emit_mips("    move $a%d, %s\n", mips_ctx->param_offset, reg_name(rs));
+            /* First 4 parameters in $a0-$a3, loaded there directly when
+               they are not already in a register */
+            MIPSRegister target = REG_A0 + mips_ctx->param_offset;
+            MIPSRegister rs = use_register(instr->result, target);
+            if (rs != target) {
+                emit_rr(MOP_MOVE, target, rs);
+            }
         } else {
             /* Additional parameters on stack */
+            MIPSRegister rs = use_register(instr->result, REG_T8);
             int offset = (mips_ctx->param_offset - 4) * 4;
-            emit_mips("    sw %s, %d($sp)\n", reg_name(rs), offset);
+            emit_memory(MOP_SW, rs, machine_mem(offset, REG_SP));
         }
         mips_ctx->param_offset++;
         
     } else if (instr->opcode == TAC_CALL) {
         /* Make the call */
+        save_around_call(instr, 0);
         if (strcmp(instr->arg1, "input") == 0) {
             /* Built-in input function */
-            emit_mips("    jal _input\n");
-            if (instr->result) {
-                MIPSRegister rd = allocate_register(instr->result);
-                emit_mips("    move %s, $v0\n", reg_name(rd));
-                mips_ctx->regs[rd].is_dirty = 1;
-            }
+            emit_jump(MOP_JAL, machine_symbol("_input"));
         } else if (strcmp(instr->arg1, "output") == 0) {
             /* Built-in output function */
-            emit_mips("    jal _output\n");
+            emit_jump(MOP_JAL, machine_symbol("_output"));
         } else {
             /* User-defined function */
-            emit_mips("    jal %s\n", instr->arg1);
-            if (instr->result) {
-                MIPSRegister rd = allocate_register(instr->result);
-                emit_mips("    move %s, $v0\n", reg_name(rd));
-                mips_ctx->regs[rd].is_dirty = 1;
+            emit_jump(MOP_JAL, machine_symbol(instr->arg1));
+        }
+        save_around_call(instr, 1);
+        if (instr->result) {
+            MIPSRegister rd = def_register(instr->result, REG_T8);
+            if (rd != REG_V0) {
+                emit_rr(MOP_MOVE, rd, REG_V0);
             }
+            finish_def(instr->result, rd);
         }
         mips_ctx->param_offset = 0;  /* Reset parameter count */
     }
@@ -294,214 +1122,373 @@ void gen_mips_call(TACInstruction *instr) {
 /* Generate MIPS return */
 void gen_mips_return(TACInstruction *instr) {
     if (instr->result) {
-        MIPSRegister rs = get_register(instr->result);
-        emit_mips("    move $v0, %s\n", reg_name(rs));
+        MIPSRegister rs = use_register(instr->result, REG_V0);
+        if (rs != REG_V0) {
+            emit_rr(MOP_MOVE, REG_V0, rs);
+        }
+    }
+    if (mips_ctx->frame_size == 0 && strcmp(mips_ctx->current_func, "main") != 0) {
+        emit_jump(MOP_JR, machine_reg(REG_RA));       /* Nothing to tear down */
+    } else {
+        emit_jump(MOP_J, machine_symbol(mips_ctx->exit_label));
+    }
+}
+
+/* Address operand of element index of an array: relative to its global
+   label, to the frame for a local array, or to the pointer for an array
+   parameter. A constant index folds into the offset; otherwise its byte
+   offset is computed into $t9 first */
+static MachineOperand array_address(char *array, char *index) {
+    int value;
+    int constant = operand_constant(index, &value) && fits_immediate(4L * value);
+    
+    if (!constant) {
+        MIPSRegister ri = use_register(index, REG_T9);
+        emit_rri(MOP_SLL, REG_T9, ri, 2);
+    }
+    
+    if (is_global_var(array)) {
+        if (constant) {
+            return machine_symbol_mem(array, 4 * value, -1);
+        }
+        return machine_symbol_mem(array, 0, REG_T9);
+    } else if (is_local_array(mips_ctx->allocation, array)) {
+        if (constant) {
+            return machine_mem(get_var_offset(array) + 4 * value, mips_ctx->frame_base);
+        }
+        emit_rrr(MOP_ADD, REG_T9, REG_T9, mips_ctx->frame_base);
+        return machine_mem(get_var_offset(array), REG_T9);
+    } else if (constant) {
+        MIPSRegister base = use_register(array, REG_T9);
+        return machine_mem(4 * value, base);
     }
-    emit_mips("    j %s_exit\n", mips_ctx->current_func);
-    emit_mips("%s_exit:\n", mips_ctx->current_func);
+    MIPSRegister base = use_register(array, REG_T8);
+    emit_rrr(MOP_ADD, REG_T9, REG_T9, base);
+    return machine_mem(0, REG_T9);
 }
 
 /* Generate MIPS array operations */
 void gen_mips_array(TACInstruction *instr) {
     if (instr->opcode == TAC_ARRAY_LOAD) {
         /* t = a[i] */
-        MIPSRegister index = get_register(instr->arg2);
-        MIPSRegister temp = allocate_register("$t8");
-        MIPSRegister result = allocate_register(instr->result);
-        
-        /* Calculate address: base + 4 * index */
-        emit_mips("    sll %s, %s, 2\n", reg_name(temp), reg_name(index));
-        
-        if (is_global_var(instr->arg1)) {
-            emit_mips("    la $t9, %s\n", instr->arg1);
-            emit_mips("    add %s, $t9, %s\n", reg_name(temp), reg_name(temp));
-        } else {
-            int offset = get_var_offset(instr->arg1);
-            emit_mips("    addi %s, $fp, %d\n", reg_name(temp), offset);
-            emit_mips("    add %s, %s, %s\n", reg_name(temp), reg_name(temp), reg_name(index));
-        }
-        
-        emit_mips("    lw %s, 0(%s)\n", reg_name(result), reg_name(temp));
-        mips_ctx->regs[result].is_dirty = 1;
+        MachineOperand address = array_address(instr->arg1, instr->arg2);
+        MIPSRegister rd = def_register(instr->result, REG_T8);
+        emit_memory(MOP_LW, rd, address);
+        finish_def(instr->result, rd);
         
     } else if (instr->opcode == TAC_ARRAY_STORE) {
         /* a[i] = t */
-        MIPSRegister index = get_register(instr->arg1);
-        MIPSRegister value = get_register(instr->arg2);
-        MIPSRegister temp = allocate_register("$t8");
-        
-        /* Calculate address: base + 4 * index */
-        emit_mips("    sll %s, %s, 2\n", reg_name(temp), reg_name(index));
-        
-        if (is_global_var(instr->result)) {
-            emit_mips("    la $t9, %s\n", instr->result);
-            emit_mips("    add %s, $t9, %s\n", reg_name(temp), reg_name(temp));
-        } else {
-            int offset = get_var_offset(instr->result);
-            emit_mips("    addi %s, $fp, %d\n", reg_name(temp), offset);
-            emit_mips("    add %s, %s, %s\n", reg_name(temp), reg_name(temp), reg_name(index));
-        }
-        
-        emit_mips("    sw %s, 0(%s)\n", reg_name(value), reg_name(temp));
+        MachineOperand address = array_address(instr->result, instr->arg1);
+        MIPSRegister value = use_register(instr->arg2, REG_T8);
+        emit_memory(MOP_SW, value, address);
     }
 }
 
-/* Simple register allocation */
-MIPSRegister allocate_register(char *var) {
-    /* Simple allocation: use $t0-$t7 for temporaries */
-    static int next_temp = 0;
+/* Generate MIPS array bounds check: one unsigned compare catches both
+   negative and too-large indices */
+void gen_mips_bounds_check(TACInstruction *instr) {
+    MIPSRegister index = use_register(instr->arg1, REG_T8);
+    int size = atoi(instr->arg2);
     
-    if (var && var[0] == 't' && var[1] >= '0' && var[1] <= '9') {
-        /* Temporary variable */
-        int temp_num = atoi(var + 1);
-        MIPSRegister reg = REG_T0 + (temp_num % 8);
-        
-        if (mips_ctx->regs[reg].var_name && 
-            strcmp(mips_ctx->regs[reg].var_name, var) != 0) {
-            /* Spill if necessary */
-            spill_register(reg);
-        }
-        
-        mips_ctx->regs[reg].var_name = copy_string(var);
-        return reg;
+    if (fits_immediate(size)) {
+        emit_rri(MOP_SLTIU, REG_T9, index, size);
     } else {
-        /* Regular variable - use saved registers */
-        MIPSRegister reg = REG_S0 + (next_temp++ % 8);
-        
-        if (mips_ctx->regs[reg].var_name) {
-            spill_register(reg);
-        }
-        
-        if (var) {
-            mips_ctx->regs[reg].var_name = copy_string(var);
-            load_variable(var, reg);
-        }
-        
-        return reg;
+        load_constant(REG_T9, size);
+        emit_rrr(MOP_SLTU, REG_T9, index, REG_T9);
     }
+    emit_branch(MOP_BEQZ, REG_T9, machine_symbol("_bounds_error"));
 }
 
-/* Get register containing variable */
-MIPSRegister get_register(char *var) {
-    if (is_constant(var)) {
-        /* Load constant into register */
-        MIPSRegister reg = REG_T8;
-        int value = atoi(var);
-        emit_mips("    li %s, %d\n", reg_name(reg), value);
+/* Register holding an operand: its allocated register, $zero for the
+   constant 0, or the scratch register after loading another constant (or
+   a value rematerialized as one), a spilled value or a global */
+MIPSRegister use_register(char *operand, MIPSRegister scratch) {
+    int reg = register_of(mips_ctx->allocation, operand);
+    if (reg >= 0) {
         return reg;
     }
     
-    /* Check if already in a register */
-    for (int i = REG_T0; i <= REG_S7; i++) {
-        if (mips_ctx->regs[i].var_name && 
-            strcmp(mips_ctx->regs[i].var_name, var) == 0) {
-            return i;
-        }
+    int value;
+    if (operand_constant(operand, &value)) {
+        if (value == 0) return REG_ZERO;
+        load_constant(scratch, value);
+        return scratch;
     }
     
-    /* Not in register, allocate one */
-    return allocate_register(var);
+    load_variable(operand, scratch);
+    return scratch;
+}
+
+/* Register to compute a result into: its allocated register, or the
+   scratch register when finish_def must store it */
+MIPSRegister def_register(char *var, MIPSRegister scratch) {
+    int reg = register_of(mips_ctx->allocation, var);
+    return reg >= 0 ? reg : scratch;
 }
 
-/* Spill register to memory */
-void spill_register(MIPSRegister reg) {
-    if (mips_ctx->regs[reg].is_dirty) {
-        store_variable(mips_ctx->regs[reg].var_name, reg);
+/* Write back a result that has no register of its own, or record the
+   register's new occupant */
+void finish_def(char *var, MIPSRegister reg) {
+    RegisterAllocation *alloc = mips_ctx->allocation;
+    int index = variable_index(alloc->cfg->variables, var);
+    
+    if (register_of(alloc, var) < 0) {
+        store_variable(var, reg);
+    } else {
+        mips_ctx->regs[reg].var_name = alloc->cfg->variables->names[index];
+        mips_ctx->regs[reg].is_dirty = 0;   /* The register is its home */
+        mips_ctx->regs[reg].last_use = alloc->last_use[index];
     }
-    free(mips_ctx->regs[reg].var_name);
-    mips_ctx->regs[reg].var_name = NULL;
-    mips_ctx->regs[reg].is_dirty = 0;
 }
 
-/* Load variable from memory */
+/* Load variable from memory: a spill slot, a global, or the address of
+   an array passed as an argument */
 void load_variable(char *var, MIPSRegister reg) {
-    if (is_global_var(var)) {
-        emit_mips("    lw %s, %s\n", reg_name(reg), var);
+    int slot = spill_slot_of(mips_ctx->allocation, var);
+    
+    if (slot >= 0) {
+        emit_memory(MOP_LW, reg, machine_mem(spill_offset(slot), mips_ctx->frame_base));
+    } else if (is_global_var(var)) {
+        SymbolEntry *symbol = lookup_symbol_in_scope(var, global_scope);
+        if (symbol->kind == SYMBOL_ARRAY) {
+            emit_instruction(MOP_LA, machine_reg(reg), machine_symbol(var), NO_OPERAND);
+        } else {
+            emit_memory(MOP_LW, reg, machine_symbol_mem(var, 0, -1));
+        }
     } else {
-        int offset = get_var_offset(var);
-        emit_mips("    lw %s, %d($fp)\n", reg_name(reg), offset);
+        emit_rri(MOP_ADDI, reg, mips_ctx->frame_base, get_var_offset(var));
     }
 }
 
 /* Store variable to memory */
 void store_variable(char *var, MIPSRegister reg) {
-    if (is_global_var(var)) {
-        emit_mips("    sw %s, %s\n", reg_name(reg), var);
-    } else {
-        int offset = get_var_offset(var);
-        emit_mips("    sw %s, %d($fp)\n", reg_name(reg), offset);
+    int slot = spill_slot_of(mips_ctx->allocation, var);
+    
+    if (slot >= 0) {
+        emit_memory(MOP_SW, reg, machine_mem(spill_offset(slot), mips_ctx->frame_base));
+    } else if (is_global_var(var)) {
+        emit_memory(MOP_SW, reg, machine_symbol_mem(var, 0, -1));
+    }
+}
+
+/* Start the machine instruction list of a function or runtime routine */
+static void begin_machine_function(void) {
+    mips_ctx->function = new_machine_function();
+}
+
+/* Write the finished function's instructions and free them */
+static void write_machine_function(void) {
+    if (delay_slot_filling) {
+        fill_delay_slots(mips_ctx->function);
+    }
+    asm_write_function(mips_ctx->writer, mips_ctx->function);
+    free_machine_function(mips_ctx->function);
+    mips_ctx->function = NULL;
+}
+
+/* Append an instruction to the current function, counting it */
+void emit_instruction(MachineOpcode op, MachineOperand a, MachineOperand b, MachineOperand c) {
+    if (mips_ctx->function == NULL) {
+        begin_machine_function();
     }
+    machine_append(mips_ctx->function, op, a, b, c);
+    if (op != MOP_LABEL) {
+        mips_ctx->emitted++;
+    }
+}
+
+/* op rd, rs, rt */
+void emit_rrr(MachineOpcode op, MIPSRegister rd, MIPSRegister rs, MIPSRegister rt) {
+    emit_instruction(op, machine_reg(rd), machine_reg(rs), machine_reg(rt));
+}
+
+/* op rt, rs, immediate */
+void emit_rri(MachineOpcode op, MIPSRegister rt, MIPSRegister rs, int immediate) {
+    emit_instruction(op, machine_reg(rt), machine_reg(rs), machine_imm(immediate));
+}
+
+/* li/lui rt, immediate */
+void emit_ri(MachineOpcode op, MIPSRegister rt, int immediate) {
+    emit_instruction(op, machine_reg(rt), machine_imm(immediate), NO_OPERAND);
+}
+
+/* move rd, rs and div rs, rt */
+void emit_rr(MachineOpcode op, MIPSRegister rd, MIPSRegister rs) {
+    emit_instruction(op, machine_reg(rd), machine_reg(rs), NO_OPERAND);
+}
+
+/* lw/sw reg, address */
+void emit_memory(MachineOpcode op, MIPSRegister reg, MachineOperand address) {
+    emit_instruction(op, machine_reg(reg), address, NO_OPERAND);
+}
+
+/* j/jal label and jr reg */
+void emit_jump(MachineOpcode op, MachineOperand target) {
+    emit_instruction(op, target, NO_OPERAND, NO_OPERAND);
+}
+
+/* Branch on one register */
+void emit_branch(MachineOpcode op, MIPSRegister rs, MachineOperand target) {
+    emit_instruction(op, machine_reg(rs), target, NO_OPERAND);
 }
 
-/* Emit MIPS instruction */
-void emit_mips(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    vfprintf(mips_ctx->output, format, args);
-    va_end(args);
+/* beq/bne rs, rt, label */
+void emit_branch_equal(MachineOpcode op, MIPSRegister rs, MIPSRegister rt, MachineOperand target) {
+    emit_instruction(op, machine_reg(rs), machine_reg(rt), target);
+}
+
+void emit_comment(const char *text) {
+    if (mips_ctx->function == NULL) {
+        begin_machine_function();
+    }
+    machine_comment(mips_ctx->function, text);
 }
 
 /* Emit label */
 void emit_label_mips(int label) {
-    emit_mips("L%d:\n", label);
+    emit_instruction(MOP_LABEL, machine_label(label), NO_OPERAND, NO_OPERAND);
+}
+
+void emit_symbol_label(const char *symbol) {
+    emit_instruction(MOP_LABEL, machine_symbol(symbol), NO_OPERAND, NO_OPERAND);
+}
+
+/* Order global variables by name, so the data layout does not depend on
+   the symbol table's hashing */
+static int compare_names(const void *a, const void *b) {
+    return strcmp((*(SymbolEntry * const *)a)->name, (*(SymbolEntry * const *)b)->name);
+}
+
+/* Global variables and arrays, by name */
+static SymbolEntry **global_variables(int *count) {
+    SymbolEntry **globals = NULL;
+    *count = 0;
+    for (int h = 0; h < SYMTAB_SIZE; h++) {
+        for (SymbolEntry *e = global_scope->table[h]; e; e = e->next) {
+            if (e->kind != SYMBOL_VAR && e->kind != SYMBOL_ARRAY) continue;
+            globals = (SymbolEntry **)realloc(globals, (*count + 1) * sizeof(SymbolEntry *));
+            globals[(*count)++] = e;
+        }
+    }
+    if (*count > 1) {
+        qsort(globals, *count, sizeof(SymbolEntry *), compare_names);
+    }
+    return globals;
 }
 
 /* Emit data section */
 void emit_data_section(void) {
-    emit_mips("# C-Minus Compiler Generated MIPS Code\n");
-    emit_mips("# CST-405 Compiler Design\n\n");
-    emit_mips(".data\n");
-    emit_mips("newline: .asciiz \"\\n\"\n");
-    emit_mips("prompt: .asciiz \"Enter a number: \"\n");
+    AsmWriter *w = mips_ctx->writer;
+    asm_write_string(w, "# C-Minus Compiler Generated MIPS Code\n");
+    asm_write_string(w, "# CST-405 Compiler Design\n\n");
+    asm_write_string(w, ".data\n");
+    /* Runtime labels start with '_', which no C-Minus identifier can, so
+       a global never clashes with them */
+    asm_write_string(w, "_newline: .asciiz \"\\n\"\n");
+    asm_write_string(w, "_prompt: .asciiz \"Enter a number: \"\n");
+    if (bounds_checking) {
+        asm_write_string(w, "bounds_msg: .asciiz \"Array index out of bounds\\n\"\n");
+    }
     
-    /* Add global variables here */
-    /* This would be populated from the symbol table */
+    /* Global variables, zero-initialized. Scalars are declared .extern,
+       which puts them in the small data area, so SPIM reads and writes
+       one with a single lw/sw relative to $gp; arrays follow the
+       strings, word aligned */
+    int count = 0;
+    SymbolEntry **globals = global_variables(&count);
+    int arrays = 0;
+    for (int g = 0; g < count; g++) {
+        if (globals[g]->kind == SYMBOL_VAR) {
+            asm_write_string(w, ".extern ");
+            asm_write_string(w, globals[g]->name);
+            asm_write_string(w, " 4\n");
+        } else {
+            arrays++;
+        }
+    }
+    if (arrays > 0) {
+        asm_write_string(w, ".align 2\n");
+    }
+    for (int g = 0; g < count; g++) {
+        if (globals[g]->kind != SYMBOL_ARRAY) continue;
+        asm_write_string(w, globals[g]->name);
+        asm_write_string(w, ": .space ");
+        asm_write_int(w, 4 * globals[g]->size);
+        asm_write_string(w, "\n");
+    }
+    free(globals);
     
-    emit_mips("\n");
+    asm_write_string(w, "\n");
 }
 
 /* Emit text section */
 void emit_text_section(void) {
-    emit_mips(".text\n");
-    emit_mips(".globl main\n\n");
+    asm_write_string(mips_ctx->writer, ".text\n");
+    if (delay_slot_filling) {
+        asm_write_string(mips_ctx->writer, ".set noreorder\n");
+    }
+    asm_write_string(mips_ctx->writer, ".globl main\n\n");
 }
 
 /* Emit syscall functions */
 void emit_syscall_functions(void) {
     /* Input function */
-    emit_mips("\n_input:\n");
-    emit_mips("    li $v0, 4\n");          /* Print string syscall */
-    emit_mips("    la $a0, prompt\n");
-    emit_mips("    syscall\n");
-    emit_mips("    li $v0, 5\n");          /* Read integer syscall */
-    emit_mips("    syscall\n");
-    emit_mips("    jr $ra\n");
+    begin_machine_function();
+    emit_symbol_label("_input");
+    emit_ri(MOP_LI, REG_V0, 4);          /* Print string syscall */
+    emit_instruction(MOP_LA, machine_reg(REG_A0), machine_symbol("_prompt"), NO_OPERAND);
+    emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+    emit_ri(MOP_LI, REG_V0, 5);          /* Read integer syscall */
+    emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+    emit_jump(MOP_JR, machine_reg(REG_RA));
+    write_machine_function();
     
     /* Output function */
-    emit_mips("\n_output:\n");
-    emit_mips("    li $v0, 1\n");          /* Print integer syscall */
-    emit_mips("    syscall\n");
-    emit_mips("    li $v0, 4\n");          /* Print string syscall */
-    emit_mips("    la $a0, newline\n");
-    emit_mips("    syscall\n");
-    emit_mips("    jr $ra\n");
+    begin_machine_function();
+    emit_symbol_label("_output");
+    emit_ri(MOP_LI, REG_V0, 1);          /* Print integer syscall */
+    emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+    emit_ri(MOP_LI, REG_V0, 4);          /* Print string syscall */
+    emit_instruction(MOP_LA, machine_reg(REG_A0), machine_symbol("_newline"), NO_OPERAND);
+    emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+    emit_jump(MOP_JR, machine_reg(REG_RA));
+    write_machine_function();
+    
+    if (bounds_checking) {
+        /* Bounds check failure: report and exit */
+        begin_machine_function();
+        emit_symbol_label("_bounds_error");
+        emit_ri(MOP_LI, REG_V0, 4);      /* Print string syscall */
+        emit_instruction(MOP_LA, machine_reg(REG_A0), machine_symbol("bounds_msg"), NO_OPERAND);
+        emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+        emit_ri(MOP_LI, REG_V0, 10);     /* Exit syscall */
+        emit_instruction(MOP_SYSCALL, NO_OPERAND, NO_OPERAND, NO_OPERAND);
+        write_machine_function();
+    }
 }
 
 /* Get register name */
 char *reg_name(MIPSRegister reg) {
-    return (char *)register_names[reg];
+    return (char *)machine_register_name(reg);
 }
 
-/* Get variable offset (simplified) */
+/* Frame offset of a local array, in the local area above the outgoing
+   arguments */
 int get_var_offset(char *var) {
-    /* This would be looked up from the symbol table */
-    /* For now, return a default offset */
-    return -4;
+    return mips_ctx->outgoing_size + local_array_offset(mips_ctx->allocation, var);
+}
+
+/* Register the current frame is addressed from */
+MIPSRegister frame_base_register(void) {
+    return mips_ctx->frame_base;
+}
+
+/* Frame offset of a spill slot */
+int spill_offset(int slot) {
+    return mips_ctx->outgoing_size + mips_ctx->allocation->slot_offset[slot];
 }
 
 /* Check if variable is global */
 int is_global_var(char *var) {
-    /* This would be checked from the symbol table */
-    /* For now, assume locals start with 't' or are parameters */
-    return !(var[0] == 't' || var[0] == 'p');
+    return is_global_name(var);
 }
\ No newline at end of file
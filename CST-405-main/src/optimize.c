@@ -10,6 +10,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "optimize.h"
+#include "passes.h"
 #include "codegen.h"
 #include "globals.h"
 
@@ -17,7 +18,7 @@ OptimizationStats opt_stats = {0};
 
 /* Main optimization function */
 void optimize_tac(OptimizationLevel level) {
-    if (level == OPT_NONE) return;
+    if (level == OPT_NONE && pass_pipeline == NULL) return;
     
     printf("\n=== OPTIMIZATION PHASE ===\n");
     printf("Optimization level: %d\n", level);
@@ -30,18 +31,7 @@ void optimize_tac(OptimizationLevel level) {
         instr = instr->next;
     }
     
-    /* Basic optimizations */
-    constant_folding();
-    constant_propagation();
-    dead_code_elimination();
-    copy_propagation();
-    algebraic_simplification();
-    
-    if (level >= OPT_AGGRESSIVE) {
-        /* More aggressive optimizations */
-        common_subexpression_elimination();
-        peephole_optimization();
-    }
+    run_pass_pipeline(pass_pipeline ? pass_pipeline : default_pass_pipeline(level));
     
     /* Count optimized instructions */
     instr = get_tac_list();
@@ -55,44 +45,64 @@ void optimize_tac(OptimizationLevel level) {
 }
 
 /* Constant folding - evaluate constant expressions at compile time */
-void constant_folding(void) {
-    TACInstruction *instr = get_tac_list();
+int constant_folding(TACInstruction *func_begin) {
+    int changes = 0;
+    TACInstruction *instr = func_begin;
+    TACInstruction *stop = find_function_end(func_begin)->next;
     
-    while (instr) {
-        if (instr->opcode >= TAC_ADD && instr->opcode <= TAC_DIV) {
+    while (instr != stop) {
+        if (is_binary_operation(instr->opcode)) {
             if (is_constant(instr->arg1) && is_constant(instr->arg2)) {
                 int val1 = get_constant_value(instr->arg1);
                 int val2 = get_constant_value(instr->arg2);
                 int result = 0;
+                int folded = 1;
                 
                 switch (instr->opcode) {
                     case TAC_ADD: result = val1 + val2; break;
                     case TAC_SUB: result = val1 - val2; break;
                     case TAC_MUL: result = val1 * val2; break;
                     case TAC_DIV: 
-                        if (val2 != 0) result = val1 / val2;
-                        else continue;  /* Skip division by zero */
+                        /* Division by zero is left to trap at run time, and
+                           INT_MIN / -1 wraps as it does on the target */
+                        if (val2 == 0) folded = 0;
+                        else if (val2 == -1) result = (int)(0u - (unsigned int)val1);
+                        else result = val1 / val2;
                         break;
-                    default: continue;
+                    case TAC_LT:  result = val1 < val2; break;
+                    case TAC_LTE: result = val1 <= val2; break;
+                    case TAC_GT:  result = val1 > val2; break;
+                    case TAC_GTE: result = val1 >= val2; break;
+                    case TAC_EQ:  result = val1 == val2; break;
+                    case TAC_NEQ: result = val1 != val2; break;
+                    default: folded = 0; break;
                 }
                 
                 /* Replace with constant load */
-                instr->opcode = TAC_LOAD_CONST;
-                free(instr->arg1);
-                instr->arg1 = make_string("%d", result);
-                free(instr->arg2);
-                instr->arg2 = NULL;
-                
-                opt_stats.constants_folded++;
+                if (folded) {
+                    instr->opcode = TAC_LOAD_CONST;
+                    free(instr->arg1);
+                    instr->arg1 = make_string("%d", result);
+                    free(instr->arg2);
+                    instr->arg2 = NULL;
+                    
+                    opt_stats.constants_folded++;
+                    
+                    changes++;
+                }
             }
         }
         instr = instr->next;
     }
+    
+    return changes;
 }
 
 /* Constant propagation - replace variables with known constant values */
-void constant_propagation(void) {
-    TACInstruction *instr = get_tac_list();
+int constant_propagation(TACInstruction *func_begin) {
+    int changes = 0;
+    TACInstruction *instr = func_begin;
+    TACInstruction *stop = find_function_end(func_begin)->next;
     
     /* Simple constant tracking (local to basic blocks) */
     typedef struct {
@@ -103,100 +113,138 @@ void constant_propagation(void) {
     ConstantEntry constants[100];
     int const_count = 0;
     
-    while (instr) {
-        /* Check if this is a constant assignment */
-        if (instr->opcode == TAC_LOAD_CONST) {
-            /* Record constant */
-            int found = 0;
-            for (int i = 0; i < const_count; i++) {
-                if (strcmp(constants[i].var, instr->result) == 0) {
-                    free(constants[i].value);
-                    constants[i].value = copy_string(instr->arg1);
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found && const_count < 100) {
-                constants[const_count].var = copy_string(instr->result);
-                constants[const_count].value = copy_string(instr->arg1);
-                const_count++;
-            }
-        }
+    while (instr != stop) {
         /* Replace uses of constants */
-        else if (instr->opcode != TAC_FUNC_BEGIN && instr->opcode != TAC_FUNC_END) {
+        if (instr->opcode != TAC_FUNC_BEGIN && instr->opcode != TAC_FUNC_END &&
+            instr->opcode != TAC_CALL) {
             for (int i = 0; i < const_count; i++) {
                 if (instr->arg1 && strcmp(instr->arg1, constants[i].var) == 0) {
                     free(instr->arg1);
                     instr->arg1 = copy_string(constants[i].value);
                     opt_stats.constants_folded++;
+                    changes++;
                 }
                 if (instr->arg2 && strcmp(instr->arg2, constants[i].var) == 0) {
                     free(instr->arg2);
                     instr->arg2 = copy_string(constants[i].value);
                     opt_stats.constants_folded++;
+                    changes++;
+                }
+                /* Branch conditions, params and return values read result */
+                if (uses_result(instr) && instr->opcode != TAC_ARRAY_STORE &&
+                    instr->result && strcmp(instr->result, constants[i].var) == 0) {
+                    free(instr->result);
+                    instr->result = copy_string(constants[i].value);
+                    opt_stats.constants_folded++;
+                    changes++;
                 }
             }
         }
         
-        /* Clear constants at labels (conservative) */
-        if (instr->opcode == TAC_LABEL) {
-            const_count = 0;
+        /* Forget constants invalidated by this instruction: a redefinition
+           kills its target, a call may write any global */
+        for (int i = 0; i < const_count; ) {
+            int killed = (defines_result(instr) &&
+                          strcmp(constants[i].var, instr->result) == 0) ||
+                         (instr->opcode == TAC_CALL && !is_temporary(constants[i].var));
+            if (killed) {
+                free(constants[i].var);
+                free(constants[i].value);
+                constants[i] = constants[--const_count];
+            } else {
+                i++;
+            }
+        }
+        
+        /* Check if this is a constant assignment */
+        if (instr->opcode == TAC_LOAD_CONST && const_count < 100) {
+            constants[const_count].var = copy_string(instr->result);
+            constants[const_count].value = copy_string(instr->arg1);
+            const_count++;
+        }
+        
+        /* Clear constants at block boundaries (conservative) */
+        if (is_block_boundary(instr)) {
+            while (const_count > 0) {
+                const_count--;
+                free(constants[const_count].var);
+                free(constants[const_count].value);
+            }
         }
         
         instr = instr->next;
     }
+    
+    return changes;
 }
 
-/* Dead code elimination - remove code that doesn't affect output */
-void dead_code_elimination(void) {
-    TACInstruction *instr = get_tac_list();
-    TACInstruction *prev = NULL;
-    
-    while (instr) {
-        TACInstruction *next = instr->next;
-        int is_dead = 0;
-        
-        /* Check if instruction result is never used */
-        if (instr->result && is_temporary(instr->result)) {
-            /* Simple check: is this temp used in any following instruction? */
-            TACInstruction *check = instr->next;
-            int used = 0;
-            
-            while (check && !used) {
-                if ((check->arg1 && strcmp(check->arg1, instr->result) == 0) ||
-                    (check->arg2 && strcmp(check->arg2, instr->result) == 0) ||
-                    (check->opcode == TAC_PARAM && check->result && 
-                     strcmp(check->result, instr->result) == 0)) {
-                    used = 1;
-                }
-                check = check->next;
+/* Dead code elimination - remove code that doesn't affect output.
+   Walks each block backward from its live-out set, so a definition is
+   dead when no path reads it before it is redefined or the function
+   returns (globals stay live at calls and exits) */
+int dead_code_elimination(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = get_function_liveness(func_begin);
+    if (cfg->block_count == 0) return 0;
+
+    unsigned int *live = (unsigned int *)malloc(cfg->live_words * sizeof(unsigned int));
+    TACInstruction **body = NULL;
+    int capacity = 0;
+    int changes = 0;
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        int count = 0;
+
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 32;
+                body = (TACInstruction **)realloc(body, capacity * sizeof(TACInstruction *));
             }
-            
-            if (!used && instr->opcode != TAC_CALL) {
-                is_dead = 1;
+            body[count++] = instr;
+            if (instr == block->end) break;
+        }
+
+        /* Calls keep their side effects and formals fix parameter order */
+        memcpy(live, block->live_out, cfg->live_words * sizeof(unsigned int));
+        for (int i = count - 1; i >= 0; i--) {
+            TACInstruction *instr = body[i];
+            int removable = defines_result(instr) && instr->opcode != TAC_CALL &&
+                            instr->opcode != TAC_FORMAL &&
+                            variable_index(cfg->variables, instr->result) >= 0;
+
+            if (removable && !bit_is_set(live, variable_index(cfg->variables, instr->result))) {
+                body[i] = NULL;
+            } else {
+                update_live_set(cfg, live, instr);
             }
         }
-        
-        if (is_dead) {
-            /* Remove instruction */
-            if (prev) {
-                prev->next = next;
+
+        /* Unlink the dead instructions, keeping the next block's anchor valid */
+        TACInstruction *prev = block->before;
+        for (int i = 0; i < count; i++) {
+            if (body[i] == NULL) {
+                remove_tac_after(prev);
+                opt_stats.dead_code_removed++;
+                changes++;
             } else {
-                set_tac_list(next);
+                prev = body[i];
             }
-            free(instr);
-            opt_stats.dead_code_removed++;
-        } else {
-            prev = instr;
         }
-        
-        instr = next;
+        if (b + 1 < cfg->block_count) {
+            cfg->blocks[b + 1]->before = prev;
+        }
     }
+
+    free(body);
+    free(live);
+    return changes;
 }
 
 /* Copy propagation - replace copies with original values */
-void copy_propagation(void) {
-    TACInstruction *instr = get_tac_list();
+int copy_propagation(TACInstruction *func_begin) {
+    int changes = 0;
+    TACInstruction *instr = func_begin;
+    TACInstruction *stop = find_function_end(func_begin)->next;
     
     typedef struct {
         char *dest;
@@ -206,55 +254,80 @@ void copy_propagation(void) {
     CopyEntry copies[100];
     int copy_count = 0;
     
-    while (instr) {
-        /* Check if this is a copy: x = y */
-        if (instr->opcode == TAC_ASSIGN) {
-            /* Record copy */
-            int found = 0;
-            for (int i = 0; i < copy_count; i++) {
-                if (strcmp(copies[i].dest, instr->result) == 0) {
-                    free(copies[i].source);
-                    copies[i].source = copy_string(instr->arg1);
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found && copy_count < 100) {
-                copies[copy_count].dest = copy_string(instr->result);
-                copies[copy_count].source = copy_string(instr->arg1);
-                copy_count++;
-            }
-        }
+    while (instr != stop) {
         /* Replace uses of copies */
-        else if (instr->opcode != TAC_FUNC_BEGIN && instr->opcode != TAC_FUNC_END) {
+        if (instr->opcode != TAC_ASSIGN && instr->opcode != TAC_CALL &&
+            instr->opcode != TAC_FUNC_BEGIN && instr->opcode != TAC_FUNC_END) {
             for (int i = 0; i < copy_count; i++) {
                 if (instr->arg1 && strcmp(instr->arg1, copies[i].dest) == 0) {
                     free(instr->arg1);
                     instr->arg1 = copy_string(copies[i].source);
                     opt_stats.copies_propagated++;
+                    changes++;
                 }
                 if (instr->arg2 && strcmp(instr->arg2, copies[i].dest) == 0) {
                     free(instr->arg2);
                     instr->arg2 = copy_string(copies[i].source);
                     opt_stats.copies_propagated++;
+                    changes++;
+                }
+                if (uses_result(instr) && instr->opcode != TAC_ARRAY_STORE &&
+                    instr->result && strcmp(instr->result, copies[i].dest) == 0) {
+                    free(instr->result);
+                    instr->result = copy_string(copies[i].source);
+                    opt_stats.copies_propagated++;
+                    changes++;
                 }
             }
         }
         
-        /* Clear copies at labels (conservative) */
-        if (instr->opcode == TAC_LABEL) {
-            copy_count = 0;
+        /* A copy dies when either side is redefined; a call may
+           write any global */
+        for (int i = 0; i < copy_count; ) {
+            int killed = (defines_result(instr) &&
+                          (strcmp(copies[i].dest, instr->result) == 0 ||
+                           strcmp(copies[i].source, instr->result) == 0)) ||
+                         (instr->opcode == TAC_CALL &&
+                          (!is_temporary(copies[i].dest) || !is_temporary(copies[i].source)));
+            if (killed) {
+                free(copies[i].dest);
+                free(copies[i].source);
+                copies[i] = copies[--copy_count];
+            } else {
+                i++;
+            }
+        }
+        
+        /* Check if this is a copy: x = y */
+        if (instr->opcode == TAC_ASSIGN && !is_constant(instr->arg1) &&
+            strcmp(instr->result, instr->arg1) != 0 && copy_count < 100) {
+            copies[copy_count].dest = copy_string(instr->result);
+            copies[copy_count].source = copy_string(instr->arg1);
+            copy_count++;
+        }
+        
+        /* Clear copies at block boundaries (conservative) */
+        if (is_block_boundary(instr)) {
+            while (copy_count > 0) {
+                copy_count--;
+                free(copies[copy_count].dest);
+                free(copies[copy_count].source);
+            }
         }
         
         instr = instr->next;
     }
+    
+    return changes;
 }
 
 /* Algebraic simplification - simplify algebraic expressions */
-void algebraic_simplification(void) {
-    TACInstruction *instr = get_tac_list();
+int algebraic_simplification(TACInstruction *func_begin) {
+    int changes = 0;
+    TACInstruction *instr = func_begin;
+    TACInstruction *stop = find_function_end(func_begin)->next;
     
-    while (instr) {
+    while (instr != stop) {
         /* x = y + 0  =>  x = y */
         if (instr->opcode == TAC_ADD) {
             if (is_constant(instr->arg2) && get_constant_value(instr->arg2) == 0) {
@@ -262,12 +335,14 @@ void algebraic_simplification(void) {
                 free(instr->arg2);
                 instr->arg2 = NULL;
                 opt_stats.expressions_simplified++;
+                changes++;
             } else if (is_constant(instr->arg1) && get_constant_value(instr->arg1) == 0) {
                 instr->opcode = TAC_ASSIGN;
                 free(instr->arg1);
                 instr->arg1 = instr->arg2;
                 instr->arg2 = NULL;
                 opt_stats.expressions_simplified++;
+                changes++;
             }
         }
         
@@ -278,12 +353,14 @@ void algebraic_simplification(void) {
                 free(instr->arg2);
                 instr->arg2 = NULL;
                 opt_stats.expressions_simplified++;
+                changes++;
             } else if (is_constant(instr->arg1) && get_constant_value(instr->arg1) == 1) {
                 instr->opcode = TAC_ASSIGN;
                 free(instr->arg1);
                 instr->arg1 = instr->arg2;
                 instr->arg2 = NULL;
                 opt_stats.expressions_simplified++;
+                changes++;
             }
         }
         
@@ -297,16 +374,21 @@ void algebraic_simplification(void) {
                 free(instr->arg2);
                 instr->arg2 = NULL;
                 opt_stats.expressions_simplified++;
+                changes++;
             }
         }
         
         instr = instr->next;
     }
+    
+    return changes;
 }
 
 /* Common subexpression elimination */
-void common_subexpression_elimination(void) {
-    TACInstruction *instr = get_tac_list();
+int common_subexpression_elimination(TACInstruction *func_begin) {
+    int changes = 0;
+    TACInstruction *instr = func_begin;
+    TACInstruction *stop = find_function_end(func_begin)->next;
     
     typedef struct {
         TACOpcode op;
@@ -318,10 +400,14 @@ void common_subexpression_elimination(void) {
     ExprEntry expressions[100];
     int expr_count = 0;
     
-    while (instr) {
-        if (instr->opcode >= TAC_ADD && instr->opcode <= TAC_NEQ) {
+    while (instr != stop) {
+        int candidate = is_binary_operation(instr->opcode) &&
+                        strcmp(instr->result, instr->arg1) != 0 &&
+                        strcmp(instr->result, instr->arg2) != 0;
+        int found = -1;
+        
+        if (candidate) {
             /* Check if expression already computed */
-            int found = -1;
             for (int i = 0; i < expr_count; i++) {
                 if (expressions[i].op == instr->opcode &&
                     strcmp(expressions[i].arg1, instr->arg1) == 0 &&
@@ -339,67 +425,89 @@ void common_subexpression_elimination(void) {
                 free(instr->arg2);
                 instr->arg2 = NULL;
                 opt_stats.subexpressions_eliminated++;
-            } else if (expr_count < 100) {
-                /* Record new expression */
-                expressions[expr_count].op = instr->opcode;
-                expressions[expr_count].arg1 = copy_string(instr->arg1);
-                expressions[expr_count].arg2 = copy_string(instr->arg2);
-                expressions[expr_count].result = copy_string(instr->result);
-                expr_count++;
+                changes++;
+            }
+        }
+        
+        /* Forget expressions whose operands or result were redefined;
+           a call may write any global */
+        for (int i = 0; i < expr_count; ) {
+            ExprEntry *e = &expressions[i];
+            int killed = (defines_result(instr) &&
+                          (strcmp(e->arg1, instr->result) == 0 ||
+                           strcmp(e->arg2, instr->result) == 0 ||
+                           strcmp(e->result, instr->result) == 0)) ||
+                         (instr->opcode == TAC_CALL &&
+                          (!is_temporary(e->arg1) || !is_temporary(e->arg2) ||
+                           !is_temporary(e->result)));
+            if (killed) {
+                free(e->arg1);
+                free(e->arg2);
+                free(e->result);
+                expressions[i] = expressions[--expr_count];
+            } else {
+                i++;
             }
         }
         
-        /* Clear expressions at labels (conservative) */
-        if (instr->opcode == TAC_LABEL) {
-            expr_count = 0;
+        if (candidate && found < 0 && expr_count < 100) {
+            /* Record new expression */
+            expressions[expr_count].op = instr->opcode;
+            expressions[expr_count].arg1 = copy_string(instr->arg1);
+            expressions[expr_count].arg2 = copy_string(instr->arg2);
+            expressions[expr_count].result = copy_string(instr->result);
+            expr_count++;
+        }
+        
+        /* Clear expressions at block boundaries (conservative) */
+        if (is_block_boundary(instr)) {
+            while (expr_count > 0) {
+                expr_count--;
+                free(expressions[expr_count].arg1);
+                free(expressions[expr_count].arg2);
+                free(expressions[expr_count].result);
+            }
         }
         
         instr = instr->next;
     }
+    
+    return changes;
 }
 
 /* Peephole optimization - optimize small instruction sequences */
-void peephole_optimization(void) {
-    remove_redundant_jumps();
-    combine_operations();
+int peephole_optimization(TACInstruction *func_begin) {
+    return remove_redundant_jumps(func_begin) + combine_operations(func_begin);
 }
 
-/* Remove redundant jumps */
-void remove_redundant_jumps(void) {
-    TACInstruction *instr = get_tac_list();
+/* Remove jumps to the next instruction, keeping the predecessor at hand
+   so each removal is constant time */
+int remove_redundant_jumps(TACInstruction *func_begin) {
+    TACInstruction *prev = func_begin;
+    int changes = 0;
     
-    while (instr && instr->next) {
-        /* Remove jump to next instruction */
-        if (instr->opcode == TAC_GOTO && 
+    while (prev->next && prev->next->opcode != TAC_FUNC_END) {
+        TACInstruction *instr = prev->next;
+        
+        if (instr->opcode == TAC_GOTO && instr->next &&
             instr->next->opcode == TAC_LABEL &&
             instr->label == instr->next->label) {
-            /* Remove the goto */
-            TACInstruction *to_remove = instr;
-            instr = instr->next;
-            
-            /* Fix linked list */
-            TACInstruction *prev = get_tac_list();
-            if (prev == to_remove) {
-                set_tac_list(instr);
-            } else {
-                while (prev->next != to_remove) {
-                    prev = prev->next;
-                }
-                prev->next = instr;
-            }
-            
-            free(to_remove);
+            remove_tac_after(prev);
             opt_stats.dead_code_removed++;
+            changes++;
         } else {
-            instr = instr->next;
+            prev = instr;
         }
     }
+    
+    return changes;
 }
 
 /* Combine operations */
-void combine_operations(void) {
+int combine_operations(TACInstruction *func_begin) {
     /* Example: combine consecutive adds/multiplies */
     /* This is a placeholder for more complex operation combining */
+    return 0;
 }
 
 /* Check if operand is a constant */
@@ -428,6 +536,90 @@ int is_temporary(char *operand) {
     return operand && operand[0] == 't' && isdigit(operand[1]);
 }
 
+/* Check if a name refers to a global variable (semantic analysis renames
+   the locals that shadow one) */
+int is_global_name(char *name) {
+    SymbolEntry *symbol = lookup_symbol_in_scope(name, global_scope);
+    return symbol != NULL && symbol->kind != SYMBOL_FUNCTION;
+}
+
+/* Check if opcode is a two-operand arithmetic or comparison */
+int is_binary_operation(TACOpcode op) {
+    return (op >= TAC_ADD && op <= TAC_DIV) || (op >= TAC_LT && op <= TAC_NEQ);
+}
+
+/* Check if the result field of an instruction is a definition */
+int defines_result(TACInstruction *instr) {
+    switch (instr->opcode) {
+        case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV: case TAC_NEG:
+        case TAC_ASSIGN: case TAC_LOAD_CONST: case TAC_ARRAY_LOAD:
+        case TAC_LT: case TAC_LTE: case TAC_GT: case TAC_GTE: case TAC_EQ: case TAC_NEQ:
+            return instr->result != NULL;
+        case TAC_CALL: case TAC_FORMAL:
+            return instr->result != NULL;
+        default:
+            return 0;
+    }
+}
+
+/* Check if the result field of an instruction is read rather than written */
+int uses_result(TACInstruction *instr) {
+    return instr->opcode == TAC_IF_TRUE || instr->opcode == TAC_IF_FALSE ||
+           instr->opcode == TAC_PARAM || instr->opcode == TAC_RETURN ||
+           instr->opcode == TAC_ARRAY_STORE;
+}
+
+/* Check if instruction ends the straight-line region the local passes track */
+int is_block_boundary(TACInstruction *instr) {
+    switch (instr->opcode) {
+        case TAC_LABEL: case TAC_GOTO: case TAC_IF_TRUE: case TAC_IF_FALSE:
+        case TAC_RETURN: case TAC_FUNC_BEGIN: case TAC_FUNC_END:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Print how many bounds checks each function still performs */
+void print_bounds_check_report(void) {
+    printf("Bounds checks eliminated:  %d\n", opt_stats.bounds_checks_eliminated);
+    printf("Bounds checks remaining:\n");
+    
+    char *func = NULL;
+    int remaining = 0;
+    for (TACInstruction *instr = get_tac_list(); instr; instr = instr->next) {
+        if (instr->opcode == TAC_FUNC_BEGIN) {
+            func = instr->result;
+            remaining = 0;
+        } else if (instr->opcode == TAC_BOUNDS_CHECK) {
+            remaining++;
+        } else if (instr->opcode == TAC_FUNC_END) {
+            printf("  %-24s %d\n", func, remaining);
+        }
+    }
+}
+
+/* Print what each pass of the pipeline did and cost */
+void print_pass_stats(void) {
+    printf("Pipeline iterations:       %d\n", opt_stats.pipeline_iterations);
+    printf("Analyses computed/reused:  %d/%d\n",
+           opt_stats.analyses_computed, opt_stats.analyses_reused);
+    printf("  %-12s %6s %8s %10s\n", "Pass", "Runs", "Changes", "Time (ms)");
+    for (int i = 0; i < opt_stats.pass_count; i++) {
+        PassStats *pass = &opt_stats.passes[i];
+        printf("  %-12s %6d %8d %10.3f\n",
+               pass->name, pass->runs, pass->changes, pass->milliseconds);
+    }
+    
+    printf("Function tiers:%s\n", opt_stats.budget_exceeded ? " (time budget exceeded)" : "");
+    printf("  %-24s %10s %8s %6s\n", "Function", "Cost", "Tier", "Rounds");
+    for (int i = 0; i < opt_stats.function_count; i++) {
+        FunctionTierStats *func = &opt_stats.functions[i];
+        printf("  %-24s %10ld %8s %6d%s\n", func->name, func->cost,
+               tier_name(func->tier), func->rounds, func->degraded ? "  (budget)" : "");
+    }
+}
+
 /* Print optimization statistics */
 void print_optimization_stats(void) {
     printf("\n=== OPTIMIZATION STATISTICS ===\n");
@@ -440,6 +632,23 @@ void print_optimization_stats(void) {
     printf("Copies propagated:         %d\n", opt_stats.copies_propagated);
     printf("Expressions simplified:    %d\n", opt_stats.expressions_simplified);
     printf("Subexpressions eliminated: %d\n", opt_stats.subexpressions_eliminated);
+    printf("Loads eliminated:          %d\n", opt_stats.loads_eliminated);
+    printf("Dead stores removed:       %d\n", opt_stats.dead_stores_removed);
+    printf("Partial redundancies:      %d (%d computations inserted)\n",
+           opt_stats.partial_redundancies, opt_stats.expressions_inserted);
+    printf("Alias queries:             %d (%d no alias, %d must alias)\n",
+           opt_stats.alias_queries, opt_stats.alias_no_alias, opt_stats.alias_must_alias);
+    printf("Branches threaded:         %d\n", opt_stats.branches_threaded);
+    printf("Labels removed:            %d\n", opt_stats.labels_removed);
+    printf("Arguments propagated:      %d\n", opt_stats.arguments_propagated);
+    printf("Functions specialized:     %d\n", opt_stats.functions_specialized);
+    printf("Comparisons range-folded:  %d\n", opt_stats.comparisons_folded);
+    
+    if (bounds_checking) {
+        print_bounds_check_report();
+    }
+    
+    print_pass_stats();
     
     if (opt_stats.original_instruction_count > 0) {
         float reduction = 100.0 * (opt_stats.original_instruction_count - 
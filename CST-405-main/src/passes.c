@@ -0,0 +1,464 @@
+/*
+ * Optimization Pass Manager Implementation
+ * CST-405 Compiler Design
+ *
+ * Runs a pipeline of named passes (-passes=a,b,c or the default for the
+ * -O level) on each function, round after round, until a round changes
+ * nothing in that function or the round limit is reached.
+ *
+ * Every function gets a cost estimate before the first round.  Functions
+ * whose estimate passes the configured thresholds take a cheaper tier
+ * that drops the expensive passes and runs fewer rounds, and once the
+ * whole phase exceeds --opt-time-budget every remaining pass run is
+ * lowered a tier (two tiers past twice the budget).
+ *
+ * CFGs and liveness are cached per function and thrown away only after a
+ * pass changed that function, so later passes in a quiet round reuse
+ * them.  The global arrays passed anywhere in the program are found once
+ * per pipeline run and kept until a module pass changes the program.
+ * Every pass run is timed and its changes are counted in opt_stats.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "passes.h"
+#include "optimize.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "globals.h"
+
+/* Longest pipeline accepted from the command line */
+#define MAX_PIPELINE_LENGTH 64
+
+/* Rounds allowed in the cheaper tiers */
+#define REDUCED_TIER_ROUNDS 2
+#define MINIMAL_TIER_ROUNDS 1
+
+long reduced_tier_cost = DEFAULT_REDUCED_TIER_COST;
+long minimal_tier_cost = DEFAULT_MINIMAL_TIER_COST;
+int opt_time_budget_ms = 0;
+
+/* Every pass that can appear in a pipeline */
+static const PassInfo pass_registry[] = {
+    {"constfold", constant_folding,                  NULL, PASS_LINEAR,
+     "fold constant expressions"},
+    {"constprop", constant_propagation,              NULL, PASS_LINEAR,
+     "propagate constants within blocks"},
+    {"dce",       dead_code_elimination,             NULL, PASS_DATAFLOW,
+     "remove dead definitions (liveness)"},
+    {"copyprop",  copy_propagation,                  NULL, PASS_LINEAR,
+     "propagate copies within blocks"},
+    {"simplify",  algebraic_simplification,          NULL, PASS_LINEAR,
+     "algebraic identities"},
+    {"cse",       common_subexpression_elimination,  NULL, PASS_LINEAR,
+     "common subexpressions within blocks"},
+    {"pre",       partial_redundancy_elimination,    NULL, PASS_DATAFLOW,
+     "partial redundancies (lazy code motion)"},
+    {"loads",     redundant_load_elimination,        NULL, PASS_LINEAR,
+     "reuse loaded and stored array elements"},
+    {"dse",       dead_store_elimination,            NULL, PASS_DATAFLOW,
+     "remove stores to local arrays never read"},
+    {"ranges",    propagate_function_ranges,         NULL, PASS_EXPENSIVE,
+     "value ranges, compare and check folding"},
+    {"ipcp",      NULL, interprocedural_constant_propagation, PASS_DATAFLOW,
+     "interprocedural constants, cloning"},
+    {"thread",    thread_function_jumps,             NULL, PASS_EXPENSIVE,
+     "jump threading"},
+    {"peephole",  peephole_optimization,             NULL, PASS_LINEAR,
+     "peephole clean-up"},
+};
+
+#define PASS_COUNT ((int)(sizeof(pass_registry) / sizeof(pass_registry[0])))
+
+/* Per-function state while a pipeline runs */
+typedef struct {
+    TACInstruction *func_begin;
+    long cost;
+    OptimizationTier tier;         /* Tier chosen from the cost estimate */
+    OptimizationTier used;         /* Cheapest tier actually run */
+    int degraded;
+    int rounds;
+    int changes;                   /* Changes in the current round */
+    int done;
+} FunctionState;
+
+/* One cached function analysis */
+typedef struct {
+    TACInstruction *func_begin;
+    ControlFlowGraph *cfg;
+} CachedAnalysis;
+
+static CachedAnalysis *analysis_cache = NULL;
+static int cache_count = 0;
+static int cache_capacity = 0;
+
+/* Global arrays passed as an argument anywhere in the program */
+static char **escaped_globals = NULL;
+static int escaped_global_count = -1;     /* -1 until computed */
+
+/* Find a pass by name */
+static const PassInfo *find_pass(const char *name, int length) {
+    for (int i = 0; i < PASS_COUNT; i++) {
+        if ((int)strlen(pass_registry[i].name) == length &&
+            strncmp(pass_registry[i].name, name, length) == 0) {
+            return &pass_registry[i];
+        }
+    }
+    return NULL;
+}
+
+/* Split a comma separated pipeline; returns the pass count or -1 */
+static int parse_pipeline(const char *spec, const PassInfo **passes) {
+    int count = 0;
+    const char *p = spec;
+
+    while (1) {
+        const char *comma = strchr(p, ',');
+        int length = comma ? (int)(comma - p) : (int)strlen(p);
+        const PassInfo *pass = find_pass(p, length);
+
+        if (pass == NULL) {
+            fprintf(stderr, "Error: Unknown pass '%.*s' in -passes=%s\n", length, p, spec);
+            return -1;
+        }
+        if (count == MAX_PIPELINE_LENGTH) {
+            fprintf(stderr, "Error: Pipeline longer than %d passes\n", MAX_PIPELINE_LENGTH);
+            return -1;
+        }
+        passes[count++] = pass;
+
+        if (comma == NULL) break;
+        p = comma + 1;
+    }
+    return count;
+}
+
+/* Pipeline used when -passes= is not given */
+const char *default_pass_pipeline(OptimizationLevel level) {
+    if (level >= OPT_AGGRESSIVE) {
+        /* ipcp goes early so the later passes clean up the constants it
+           pushes into callees */
+        return "constprop,ipcp,constfold,constprop,dce,copyprop,simplify,cse,pre,"
+               "loads,dse,ranges,thread,peephole";
+    }
+    if (bounds_checking) {
+        /* Range analysis is what keeps -fbounds-check affordable */
+        return "constfold,constprop,dce,copyprop,simplify,ranges";
+    }
+    return "constfold,constprop,dce,copyprop,simplify";
+}
+
+/* Check that every name in a pipeline is a known pass */
+int validate_pass_pipeline(const char *spec) {
+    const PassInfo *passes[MAX_PIPELINE_LENGTH];
+    return parse_pipeline(spec, passes) >= 0;
+}
+
+/* List the registry for error messages */
+void print_available_passes(void) {
+    static const char *cost_names[] = {"linear", "data flow", "expensive"};
+
+    fprintf(stderr, "Available passes:\n");
+    for (int i = 0; i < PASS_COUNT; i++) {
+        fprintf(stderr, "  %-10s %-40s %s%s\n", pass_registry[i].name,
+                pass_registry[i].description, cost_names[pass_registry[i].cost],
+                pass_registry[i].run_module ? ", first round only" : "");
+    }
+}
+
+const char *tier_name(OptimizationTier tier) {
+    switch (tier) {
+        case TIER_FULL:    return "full";
+        case TIER_REDUCED: return "reduced";
+        case TIER_MINIMAL: return "minimal";
+    }
+    return "?";
+}
+
+/* Rough work of one data flow sweep: every instruction once, plus one
+   bit-vector word per 32 variables for every block */
+long estimate_function_cost(TACInstruction *func_begin) {
+    long instructions = 0;
+    long blocks = 1;
+    long definitions = 0;
+
+    for (TACInstruction *instr = func_begin->next;
+         instr && instr->opcode != TAC_FUNC_END; instr = instr->next) {
+        instructions++;
+        if (instr->opcode == TAC_LABEL) blocks++;
+        if (defines_result(instr)) definitions++;
+    }
+    return instructions + blocks * (definitions / 32 + 1);
+}
+
+/* Most expensive pass class and round count a tier allows */
+static PassCost tier_cost_limit(OptimizationTier tier) {
+    switch (tier) {
+        case TIER_FULL:    return PASS_EXPENSIVE;
+        case TIER_REDUCED: return PASS_DATAFLOW;
+        default:           return PASS_LINEAR;
+    }
+}
+
+static int tier_rounds(OptimizationTier tier) {
+    switch (tier) {
+        case TIER_FULL:    return MAX_PIPELINE_ITERATIONS;
+        case TIER_REDUCED: return REDUCED_TIER_ROUNDS;
+        default:           return MINIMAL_TIER_ROUNDS;
+    }
+}
+
+/* Tier forced on everything by the time spent so far */
+static OptimizationTier budget_tier(clock_t start) {
+    if (opt_time_budget_ms <= 0) return TIER_FULL;
+
+    double elapsed = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+    if (elapsed > 2.0 * opt_time_budget_ms) return TIER_MINIMAL;
+    if (elapsed > opt_time_budget_ms) return TIER_REDUCED;
+    return TIER_FULL;
+}
+
+/* Tier a function runs its next pass at */
+static OptimizationTier effective_tier(FunctionState *func, OptimizationTier forced) {
+    OptimizationTier tier = func->tier > forced ? func->tier : forced;
+
+    if (tier > func->tier) {
+        func->degraded = 1;
+        opt_stats.budget_exceeded = 1;
+    }
+    if (tier > func->used) func->used = tier;
+    return tier;
+}
+
+/* Collect the functions of the program and pick their tiers */
+static FunctionState *collect_functions(int *count) {
+    int capacity = 8;
+    FunctionState *functions = (FunctionState *)malloc(capacity * sizeof(FunctionState));
+    *count = 0;
+
+    for (TACInstruction *instr = get_tac_list(); instr; instr = instr->next) {
+        if (instr->opcode != TAC_FUNC_BEGIN) continue;
+
+        if (*count == capacity) {
+            capacity *= 2;
+            functions = (FunctionState *)realloc(functions, capacity * sizeof(FunctionState));
+        }
+        FunctionState *func = &functions[(*count)++];
+        memset(func, 0, sizeof(FunctionState));
+        func->func_begin = instr;
+        func->cost = estimate_function_cost(instr);
+        if (func->cost > minimal_tier_cost) {
+            func->tier = TIER_MINIMAL;
+        } else if (func->cost > reduced_tier_cost) {
+            func->tier = TIER_REDUCED;
+        } else {
+            func->tier = TIER_FULL;
+        }
+        func->used = func->tier;
+    }
+    return functions;
+}
+
+/* Per-pass record in opt_stats, created on first use */
+static PassStats *pass_stats_for(const PassInfo *pass) {
+    for (int i = 0; i < opt_stats.pass_count; i++) {
+        if (strcmp(opt_stats.passes[i].name, pass->name) == 0) {
+            return &opt_stats.passes[i];
+        }
+    }
+    PassStats *stats = &opt_stats.passes[opt_stats.pass_count++];
+    stats->name = pass->name;
+    return stats;
+}
+
+/* Run one pass and account for it */
+static int timed_run(const PassInfo *pass, TACInstruction *func_begin) {
+    clock_t start = clock();
+    int changes = pass->run_module ? pass->run_module() : pass->run_function(func_begin);
+    clock_t stop = clock();
+
+    PassStats *stats = pass_stats_for(pass);
+    stats->runs++;
+    stats->changes += changes;
+    stats->milliseconds += 1000.0 * (stop - start) / CLOCKS_PER_SEC;
+    return changes;
+}
+
+/* Keep the tier each surviving function ended up with */
+static void record_function_tiers(FunctionState *functions, int count) {
+    opt_stats.functions = (FunctionTierStats *)realloc(opt_stats.functions,
+        (opt_stats.function_count + count) * sizeof(FunctionTierStats));
+
+    for (int i = 0; i < count; i++) {
+        FunctionTierStats *record = &opt_stats.functions[opt_stats.function_count++];
+        record->name = copy_string(functions[i].func_begin->result);
+        record->cost = functions[i].cost;
+        record->tier = functions[i].used;
+        record->degraded = functions[i].degraded;
+        record->rounds = functions[i].rounds;
+    }
+}
+
+/* Run a pipeline on every function to a fixed point */
+void run_pass_pipeline(const char *spec) {
+    const PassInfo *passes[MAX_PIPELINE_LENGTH];
+    int count = parse_pipeline(spec, passes);
+    if (count < 0) return;
+
+    printf("Pass pipeline: %s\n", spec);
+
+    clock_t start = clock();
+    int function_count;
+    FunctionState *functions = collect_functions(&function_count);
+
+    for (int round = 0; round < MAX_PIPELINE_ITERATIONS; round++) {
+        int active = 0;
+
+        for (int i = 0; i < count; i++) {
+            const PassInfo *pass = passes[i];
+            OptimizationTier forced = budget_tier(start);
+
+            if (pass->run_module) {
+                if (round > 0 || pass->cost > tier_cost_limit(forced)) continue;
+                if (forced > TIER_FULL) opt_stats.budget_exceeded = 1;
+
+                if (timed_run(pass, NULL) > 0) {
+                    /* Functions may have been cloned or deleted */
+                    invalidate_analyses();
+                    free(functions);
+                    functions = collect_functions(&function_count);
+                }
+                continue;
+            }
+
+            for (int f = 0; f < function_count; f++) {
+                FunctionState *func = &functions[f];
+                if (func->done) continue;
+
+                OptimizationTier tier = effective_tier(func, budget_tier(start));
+                if (pass->cost > tier_cost_limit(tier) || round >= tier_rounds(tier)) continue;
+
+                int changes = timed_run(pass, func->func_begin);
+                if (changes > 0) {
+                    invalidate_function_analyses(func->func_begin);
+                    func->changes += changes;
+                }
+            }
+        }
+
+        /* A function is finished once a round leaves it unchanged */
+        for (int f = 0; f < function_count; f++) {
+            FunctionState *func = &functions[f];
+            if (func->done) continue;
+
+            func->rounds++;
+            if (func->changes == 0 || func->rounds >= tier_rounds(func->used)) {
+                func->done = 1;
+            } else {
+                active++;
+            }
+            func->changes = 0;
+        }
+
+        opt_stats.pipeline_iterations++;
+        if (active == 0) break;
+    }
+
+    record_function_tiers(functions, function_count);
+    free(functions);
+    invalidate_analyses();
+}
+
+/* CFG of a function, built on first request after an invalidation */
+ControlFlowGraph *get_function_cfg(TACInstruction *func_begin) {
+    for (int i = 0; i < cache_count; i++) {
+        if (analysis_cache[i].func_begin == func_begin) {
+            opt_stats.analyses_reused++;
+            return analysis_cache[i].cfg;
+        }
+    }
+
+    if (cache_count == cache_capacity) {
+        cache_capacity = cache_capacity ? cache_capacity * 2 : 8;
+        analysis_cache = (CachedAnalysis *)realloc(analysis_cache,
+                                                   cache_capacity * sizeof(CachedAnalysis));
+    }
+    analysis_cache[cache_count].func_begin = func_begin;
+    analysis_cache[cache_count].cfg = build_cfg(func_begin);
+    opt_stats.analyses_computed++;
+    return analysis_cache[cache_count++].cfg;
+}
+
+/* CFG of a function with live_in/live_out filled */
+ControlFlowGraph *get_function_liveness(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = get_function_cfg(func_begin);
+
+    if (cfg->live_words > 0) {
+        opt_stats.analyses_reused++;
+    } else {
+        compute_liveness(cfg);
+        opt_stats.analyses_computed++;
+    }
+    return cfg;
+}
+
+/* Global arrays passed as an argument anywhere in the program. Function
+   passes only ever remove arguments, so the set stays a safe superset
+   until a module pass changes the program */
+char **get_escaped_globals(int *count) {
+    if (escaped_global_count >= 0) {
+        opt_stats.analyses_reused++;
+        *count = escaped_global_count;
+        return escaped_globals;
+    }
+
+    int capacity = 0;
+    escaped_global_count = 0;
+    for (TACInstruction *instr = get_tac_list(); instr; instr = instr->next) {
+        if (instr->opcode != TAC_PARAM || instr->result == NULL ||
+            is_constant(instr->result) || !is_global_name(instr->result)) {
+            continue;
+        }
+        int known = 0;
+        for (int i = 0; i < escaped_global_count && !known; i++) {
+            known = strcmp(escaped_globals[i], instr->result) == 0;
+        }
+        if (known) continue;
+        if (escaped_global_count == capacity) {
+            capacity = capacity ? capacity * 2 : 8;
+            escaped_globals = (char **)realloc(escaped_globals, capacity * sizeof(char *));
+        }
+        escaped_globals[escaped_global_count++] = copy_string(instr->result);
+    }
+    opt_stats.analyses_computed++;
+    *count = escaped_global_count;
+    return escaped_globals;
+}
+
+/* Drop the cached analyses of one function after it changed */
+void invalidate_function_analyses(TACInstruction *func_begin) {
+    for (int i = 0; i < cache_count; i++) {
+        if (analysis_cache[i].func_begin == func_begin) {
+            free_cfg(analysis_cache[i].cfg);
+            analysis_cache[i] = analysis_cache[--cache_count];
+            return;
+        }
+    }
+}
+
+/* Drop every cached analysis */
+void invalidate_analyses(void) {
+    for (int i = 0; i < cache_count; i++) {
+        free_cfg(analysis_cache[i].cfg);
+    }
+    cache_count = 0;
+
+    for (int i = 0; i < escaped_global_count; i++) {
+        free(escaped_globals[i]);
+    }
+    free(escaped_globals);
+    escaped_globals = NULL;
+    escaped_global_count = -1;
+}
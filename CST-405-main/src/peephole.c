@@ -0,0 +1,339 @@
+/*
+ * Machine-Level Peephole Optimization Implementation
+ * CST-405 Compiler Design
+ *
+ * A table of rewrite rules slides over each function's machine
+ * instructions after selection, looking at an instruction and the
+ * entries right after it (or at a branch's target), until no rule
+ * applies. Labels end a window: a value known before a label may not
+ * hold when control arrives from elsewhere
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peephole.h"
+#include "globals.h"
+#include "optimize.h"
+
+/* Peephole pass use chosen by -f[no-]peephole */
+PeepholeMode peephole_mode = PEEPHOLE_DEFAULT;
+
+/* Passes over a function before giving up on a fixed point (a cycle of
+   jumps to jumps would otherwise be retargeted forever) */
+#define PEEPHOLE_MAX_PASSES 8
+
+/* The function being optimized and where its numbered labels are */
+typedef struct {
+    MachineFunction *mf;
+    int *label_at;             /* Entry of label Ln, or -1 */
+    int *references;           /* Jumps and branches to Ln */
+    int label_limit;
+    int removed;               /* Instructions deleted so far */
+} PeepholeContext;
+
+typedef int (*PeepholeAction)(PeepholeContext *ctx, int i);
+
+/* Rule: applied at each instruction in turn */
+typedef struct {
+    const char *name;
+    PeepholeAction apply;
+    int applied;               /* Times it fired, over the program */
+    int removed;               /* Instructions it deleted */
+} PeepholeRule;
+
+/* ---- Instruction helpers ---- */
+
+/* Branch taken exactly when the given one is not */
+static MachineOpcode inverted_branch(MachineOpcode op) {
+    switch (op) {
+        case MOP_BEQ:  return MOP_BNE;
+        case MOP_BNE:  return MOP_BEQ;
+        case MOP_BEQZ: return MOP_BNEZ;
+        case MOP_BNEZ: return MOP_BEQZ;
+        case MOP_BLTZ: return MOP_BGEZ;
+        case MOP_BGEZ: return MOP_BLTZ;
+        case MOP_BLEZ: return MOP_BGTZ;
+        case MOP_BGTZ: return MOP_BLEZ;
+        default:       return op;
+    }
+}
+
+static int same_address(MachineOperand *a, MachineOperand *b) {
+    if (a->kind != MO_MEM || b->kind != MO_MEM) return 0;
+    if (a->reg != b->reg || a->value != b->value) return 0;
+    if (a->symbol || b->symbol) {
+        return a->symbol && b->symbol && strcmp(a->symbol, b->symbol) == 0;
+    }
+    return 1;
+}
+
+static int is_live_entry(MachineInstr *mi) {
+    return mi->op != MOP_COMMENT && mi->op != MOP_DELETED;
+}
+
+/* Entry after i that is an instruction or label, or -1 */
+static int next_entry(PeepholeContext *ctx, int i) {
+    for (i++; i < ctx->mf->count; i++) {
+        if (is_live_entry(&ctx->mf->code[i])) return i;
+    }
+    return -1;
+}
+
+/* Check if control falls from entry i straight into the label target */
+static int label_follows(PeepholeContext *ctx, int i, MachineOperand *target) {
+    for (i = next_entry(ctx, i); i >= 0 && ctx->mf->code[i].op == MOP_LABEL;
+         i = next_entry(ctx, i)) {
+        if (machine_same_label(&ctx->mf->code[i].operand[0], target)) return 1;
+    }
+    return 0;
+}
+
+/* Entry of a label, or -1 */
+static int label_entry(PeepholeContext *ctx, MachineOperand *label) {
+    if (label->symbol == NULL) {
+        return label->value < ctx->label_limit ? ctx->label_at[label->value] : -1;
+    }
+    for (int i = 0; i < ctx->mf->count; i++) {
+        MachineInstr *mi = &ctx->mf->code[i];
+        if (mi->op == MOP_LABEL && machine_same_label(&mi->operand[0], label)) return i;
+    }
+    return -1;
+}
+
+/* First instruction executed on reaching a label, or -1 */
+static int first_instruction_at(PeepholeContext *ctx, MachineOperand *label) {
+    int i = label_entry(ctx, label);
+    while (i >= 0 && ctx->mf->code[i].op == MOP_LABEL) {
+        i = next_entry(ctx, i);
+    }
+    return i;
+}
+
+static void delete_entry(PeepholeContext *ctx, int i) {
+    if (is_machine_instruction(&ctx->mf->code[i])) ctx->removed++;
+    ctx->mf->code[i].op = MOP_DELETED;
+}
+
+/* ---- Rules ---- */
+
+/* move $x, $x */
+static int redundant_move(PeepholeContext *ctx, int i) {
+    MachineInstr *mi = &ctx->mf->code[i];
+    if (mi->op != MOP_MOVE || mi->operand[0].reg != mi->operand[1].reg) return 0;
+    delete_entry(ctx, i);
+    return 1;
+}
+
+/* sw $x, M; lw $y, M: the load becomes move $y, $x (or goes when y = x) */
+static int store_to_load(PeepholeContext *ctx, int i) {
+    MachineInstr *store = &ctx->mf->code[i];
+    int j = next_entry(ctx, i);
+    if (store->op != MOP_SW || j < 0) return 0;
+
+    MachineInstr *load = &ctx->mf->code[j];
+    if (load->op != MOP_LW || !same_address(&store->operand[1], &load->operand[1])) return 0;
+    if (load->operand[0].reg == store->operand[0].reg) {
+        delete_entry(ctx, j);
+    } else {
+        load->op = MOP_MOVE;
+        load->operand[1] = store->operand[0];
+    }
+    return 1;
+}
+
+/* lw $x, M; sw $x, M: the store writes back what is there (unless the
+   load replaced M's base register) */
+static int load_to_store(PeepholeContext *ctx, int i) {
+    MachineInstr *load = &ctx->mf->code[i];
+    int j = next_entry(ctx, i);
+    if (load->op != MOP_LW || j < 0) return 0;
+
+    MachineInstr *store = &ctx->mf->code[j];
+    if (store->op != MOP_SW || store->operand[0].reg != load->operand[0].reg ||
+        load->operand[1].reg == load->operand[0].reg ||
+        !same_address(&load->operand[1], &store->operand[1])) {
+        return 0;
+    }
+    delete_entry(ctx, j);
+    return 1;
+}
+
+/* j L or a branch to L where L: j L2 is the next thing run: go to L2
+   directly, and j L where L: jr $ra becomes the jr */
+static int jump_chain(PeepholeContext *ctx, int i) {
+    MachineInstr *mi = &ctx->mf->code[i];
+    MachineOperand *target = machine_jump_target(mi);
+    if (target == NULL) return 0;
+
+    int k = first_instruction_at(ctx, target);
+    if (k < 0 || k == i) return 0;
+    MachineInstr *next = &ctx->mf->code[k];
+    MachineOperand *final = machine_jump_target(next);
+
+    if (next->op == MOP_J && final && !machine_same_label(final, target)) {
+        *target = *final;
+        return 1;
+    }
+    if (mi->op == MOP_J && next->op == MOP_JR) {
+        mi->op = MOP_JR;
+        mi->operand[0] = next->operand[0];
+        return 1;
+    }
+    return 0;
+}
+
+/* bcond L1; j L2; L1: becomes the inverted branch to L2 */
+static int branch_over_jump(PeepholeContext *ctx, int i) {
+    MachineInstr *branch = &ctx->mf->code[i];
+    int j = next_entry(ctx, i);
+    if (!is_conditional_branch(branch->op) || j < 0) return 0;
+
+    MachineInstr *jump = &ctx->mf->code[j];
+    MachineOperand *over = machine_jump_target(branch);
+    if (jump->op != MOP_J || jump->operand[0].kind != MO_LABEL ||
+        !label_follows(ctx, j, over)) {
+        return 0;
+    }
+    branch->op = inverted_branch(branch->op);
+    *over = jump->operand[0];
+    delete_entry(ctx, j);
+    return 1;
+}
+
+/* j L or a branch to L right before L: (such as j f_exit before f_exit:) */
+static int jump_to_next(PeepholeContext *ctx, int i) {
+    MachineOperand *target = machine_jump_target(&ctx->mf->code[i]);
+    if (target == NULL || !label_follows(ctx, i, target)) return 0;
+    delete_entry(ctx, i);
+    return 1;
+}
+
+/* Instructions after j or jr up to the next label never run */
+static int unreachable_code(PeepholeContext *ctx, int i) {
+    MachineOpcode op = ctx->mf->code[i].op;
+    int applied = 0;
+    if (op != MOP_J && op != MOP_JR) return 0;
+
+    for (int j = next_entry(ctx, i); j >= 0 && ctx->mf->code[j].op != MOP_LABEL;
+         j = next_entry(ctx, j)) {
+        delete_entry(ctx, j);
+        applied = 1;
+    }
+    return applied;
+}
+
+static PeepholeRule peephole_rules[] = {
+    {"redundant move",     redundant_move},
+    {"store to load",      store_to_load},
+    {"load to store",      load_to_store},
+    {"jump chain",         jump_chain},
+    {"branch over jump",   branch_over_jump},
+    {"jump to next",       jump_to_next},
+    {"unreachable code",   unreachable_code},
+};
+
+#define PEEPHOLE_RULE_COUNT ((int)(sizeof(peephole_rules) / sizeof(peephole_rules[0])))
+
+/* ---- Driver ---- */
+
+/* Check if a jump or branch of the function goes to a named label */
+static int symbol_referenced(PeepholeContext *ctx, MachineOperand *label) {
+    for (int i = 0; i < ctx->mf->count; i++) {
+        MachineOperand *target = machine_jump_target(&ctx->mf->code[i]);
+        if (target && target->symbol && machine_same_label(target, label)) return 1;
+    }
+    return 0;
+}
+
+/* Find the numbered labels and count the jumps to each; a label nothing
+   jumps to is dropped, so it no longer ends windows. Named labels other
+   than the function's entry (its exit label) go the same way */
+static void index_labels(PeepholeContext *ctx) {
+    MachineFunction *mf = ctx->mf;
+    int limit = 0;
+    int entry = 1;
+
+    for (int i = 0; i < mf->count; i++) {
+        MachineInstr *mi = &mf->code[i];
+        MachineOperand *label = mi->op == MOP_LABEL ? &mi->operand[0] : machine_jump_target(mi);
+        if (label && label->symbol == NULL && label->value >= limit) {
+            limit = label->value + 1;
+        }
+    }
+    ctx->label_limit = limit;
+    ctx->label_at = (int *)realloc(ctx->label_at, (limit + 1) * sizeof(int));
+    ctx->references = (int *)realloc(ctx->references, (limit + 1) * sizeof(int));
+    for (int l = 0; l < limit; l++) {
+        ctx->label_at[l] = -1;
+        ctx->references[l] = 0;
+    }
+
+    for (int i = 0; i < mf->count; i++) {
+        MachineInstr *mi = &mf->code[i];
+        MachineOperand *target = machine_jump_target(mi);
+        if (mi->op == MOP_LABEL && mi->operand[0].symbol == NULL) {
+            ctx->label_at[mi->operand[0].value] = i;
+        } else if (mi->op == MOP_LABEL) {
+            if (!entry && !symbol_referenced(ctx, &mi->operand[0])) delete_entry(ctx, i);
+            entry = 0;
+        } else if (target && target->symbol == NULL) {
+            ctx->references[target->value]++;
+        }
+    }
+    for (int l = 0; l < limit; l++) {
+        if (ctx->label_at[l] >= 0 && ctx->references[l] == 0) {
+            delete_entry(ctx, ctx->label_at[l]);
+            ctx->label_at[l] = -1;
+        }
+    }
+}
+
+/* Check if the peephole pass runs at this optimization level */
+int peephole_enabled(void) {
+    if (peephole_mode == PEEPHOLE_DEFAULT) {
+        return optimization_level >= OPT_BASIC;
+    }
+    return peephole_mode == PEEPHOLE_ON;
+}
+
+/* Apply the rules to a function until none fires; returns the
+   instructions removed */
+int peephole_optimize(MachineFunction *mf) {
+    PeepholeContext ctx = {mf, NULL, NULL, 0, 0};
+
+    for (int pass = 0; pass < PEEPHOLE_MAX_PASSES; pass++) {
+        int changed = 0;
+        index_labels(&ctx);
+
+        for (int i = 0; i < mf->count; i++) {
+            for (int r = 0; r < PEEPHOLE_RULE_COUNT && is_machine_instruction(&mf->code[i]); r++) {
+                int before = ctx.removed;
+                if (peephole_rules[r].apply(&ctx, i)) {
+                    peephole_rules[r].applied++;
+                    peephole_rules[r].removed += ctx.removed - before;
+                    changed = 1;
+                }
+            }
+        }
+        machine_compact(mf);
+        if (!changed) break;
+    }
+
+    free(ctx.label_at);
+    free(ctx.references);
+    return ctx.removed;
+}
+
+/* Print how often each rule fired and what it removed, over the program */
+void print_peephole_statistics(void) {
+    int removed = 0;
+    for (int r = 0; r < PEEPHOLE_RULE_COUNT; r++) {
+        removed += peephole_rules[r].removed;
+    }
+    printf("Peephole optimization: %d instructions removed\n", removed);
+    for (int r = 0; r < PEEPHOLE_RULE_COUNT; r++) {
+        printf("  %-18s %5d applied, %5d removed\n", peephole_rules[r].name,
+               peephole_rules[r].applied, peephole_rules[r].removed);
+    }
+}
@@ -0,0 +1,522 @@
+/*
+ * Partial Redundancy Elimination Implementation
+ * CST-405 Compiler Design
+ *
+ * Lazy code motion (Knoop, Ruthing and Steffen) over the CFG of a
+ * function. An expression a op b is partially redundant where it is
+ * already computed on some paths but not all, like j + 1 before an if and
+ * again inside its body. The pass computes, per expression:
+ *   - anticipability: every path from a point computes it before an
+ *     operand changes (so computing it there is safe)
+ *   - availability: every path to a point has computed it since an
+ *     operand last changed
+ *   - the earliest edges where it is anticipated but not yet available,
+ *     then delays each insertion along the paths as far as it can go
+ *     without a path losing the computation (lazy placement)
+ * A computation is inserted on each edge where the delayed placement
+ * stops, into a new temporary; computations whose value is then always
+ * in that temporary become copies of it, and the computations left in
+ * place also save their value into it. Every path evaluates each
+ * expression at most once, and no temporary is live longer than needed.
+ *
+ * An edge from a block with two successors into a block with two
+ * predecessors has no place of its own: it is split into a new block, in
+ * the fall-through path after the branch, or for the jump edge by
+ * inverting the branch and jumping on from the new block.
+ *
+ * Expressions are additions, subtractions, multiplications and divisions
+ * by a non-zero constant; a division by a variable is never moved since
+ * it may fault on a path that did not divide. Comparisons are left to
+ * the branches that read them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "passes.h"
+#include "codegen.h"
+
+/* Expressions considered in one function */
+#define MAX_MOTION_EXPRESSIONS 512
+
+/* An expression a op b and the temporary holding it once moved */
+typedef struct {
+    TACOpcode op;
+    char *arg1;
+    char *arg2;
+    int reads_global;          /* A call may change an operand */
+    char *holder;              /* NULL unless the expression is moved */
+} Expression;
+
+/* A computation of an expression in a block */
+typedef struct {
+    TACInstruction *instr;
+    int expr;
+    int block;
+    int upward;                /* No operand changes before it in the block */
+    int downward;              /* ...nor after it */
+} Occurrence;
+
+typedef struct {
+    ControlFlowGraph *cfg;
+    Expression exprs[MAX_MOTION_EXPRESSIONS];
+    int expr_count;
+    Occurrence *occurrences;
+    int occurrence_count;
+    int occurrence_capacity;
+    int words;
+
+    /* Per block bit vectors over the expressions */
+    unsigned int **upward;     /* Computed before any operand changes */
+    unsigned int **downward;   /* Computed after the last operand change */
+    unsigned int **killed;     /* Some operand changes */
+    unsigned int **avail_out;
+    unsigned int **ant_in;
+    unsigned int **ant_out;
+    unsigned int **later_in;
+} MotionState;
+
+static int same_name(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/* Check if an instruction computes an expression the pass may move */
+static int is_movable(TACInstruction *instr) {
+    if (instr->opcode != TAC_ADD && instr->opcode != TAC_SUB &&
+        instr->opcode != TAC_MUL && instr->opcode != TAC_DIV) {
+        return 0;
+    }
+    if (!instr->result || !instr->arg1 || !instr->arg2) return 0;
+    if (is_constant(instr->arg1) && is_constant(instr->arg2)) return 0;
+    if (instr->opcode == TAC_DIV &&
+        (!is_constant(instr->arg2) || get_constant_value(instr->arg2) == 0)) {
+        return 0;
+    }
+    return 1;
+}
+
+static int find_expression(MotionState *s, TACInstruction *instr) {
+    for (int i = 0; i < s->expr_count; i++) {
+        Expression *e = &s->exprs[i];
+        if (e->op == instr->opcode && same_name(e->arg1, instr->arg1) &&
+            same_name(e->arg2, instr->arg2)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int add_expression(MotionState *s, TACInstruction *instr) {
+    int found = find_expression(s, instr);
+    if (found >= 0 || s->expr_count == MAX_MOTION_EXPRESSIONS) return found;
+
+    Expression *e = &s->exprs[s->expr_count];
+    e->op = instr->opcode;
+    e->arg1 = copy_string(instr->arg1);
+    e->arg2 = copy_string(instr->arg2);
+    e->reads_global = is_global_name(instr->arg1) || is_global_name(instr->arg2);
+    e->holder = NULL;
+    return s->expr_count++;
+}
+
+static unsigned int **new_sets(MotionState *s, int fill) {
+    unsigned int **sets = (unsigned int **)malloc(s->cfg->block_count * sizeof(unsigned int *));
+    for (int b = 0; b < s->cfg->block_count; b++) {
+        sets[b] = (unsigned int *)malloc(s->words * sizeof(unsigned int));
+        memset(sets[b], fill ? 0xff : 0, s->words * sizeof(unsigned int));
+    }
+    return sets;
+}
+
+static void free_sets(MotionState *s, unsigned int **sets) {
+    for (int b = 0; b < s->cfg->block_count; b++) {
+        free(sets[b]);
+    }
+    free(sets);
+}
+
+static void add_occurrence(MotionState *s, TACInstruction *instr, int expr, int block, int upward) {
+    if (s->occurrence_count == s->occurrence_capacity) {
+        s->occurrence_capacity = s->occurrence_capacity ? 2 * s->occurrence_capacity : 32;
+        s->occurrences = (Occurrence *)realloc(s->occurrences,
+                                               s->occurrence_capacity * sizeof(Occurrence));
+    }
+    Occurrence *o = &s->occurrences[s->occurrence_count++];
+    o->instr = instr;
+    o->expr = expr;
+    o->block = block;
+    o->upward = upward;
+    o->downward = 0;
+}
+
+/* Mark the expressions an instruction invalidates as killed in a block */
+static void kill_expressions(MotionState *s, TACInstruction *instr, unsigned int *killed,
+                             int *pending) {
+    int writes = defines_result(instr);
+    int call = instr->opcode == TAC_CALL;
+
+    if (!writes && !call) return;
+    for (int i = 0; i < s->expr_count; i++) {
+        Expression *e = &s->exprs[i];
+        if ((call && e->reads_global) ||
+            (writes && (same_name(e->arg1, instr->result) || same_name(e->arg2, instr->result)))) {
+            set_bit(killed, i);
+            pending[i] = -1;
+        }
+    }
+}
+
+/* Record the computations of each block and what it computes and kills */
+static void compute_local_properties(MotionState *s) {
+    int *pending = (int *)malloc(s->expr_count * sizeof(int));
+
+    for (int i = 0; i < s->expr_count; i++) pending[i] = -1;
+    for (int b = 0; b < s->cfg->block_count; b++) {
+        BasicBlock *block = s->cfg->blocks[b];
+        int first = s->occurrence_count;
+
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            int e = is_movable(instr) ? find_expression(s, instr) : -1;
+            if (e >= 0) {
+                int upward = !bit_is_set(s->killed[b], e);
+                if (upward) set_bit(s->upward[b], e);
+                pending[e] = s->occurrence_count;
+                add_occurrence(s, instr, e, b, upward);
+            }
+            kill_expressions(s, instr, s->killed[b], pending);
+            if (instr == block->end) break;
+        }
+
+        for (int o = first; o < s->occurrence_count; o++) {
+            int e = s->occurrences[o].expr;
+            if (pending[e] == o) {
+                s->occurrences[o].downward = 1;
+                set_bit(s->downward[b], e);
+            }
+        }
+        for (int o = first; o < s->occurrence_count; o++) {
+            pending[s->occurrences[o].expr] = -1;
+        }
+    }
+    free(pending);
+}
+
+static int single_successor(BasicBlock *block) {
+    if (block_exits_function(block)) return 0;
+    return block->succ_count == 1 ||
+           (block->succ_count == 2 && block->successors[0] == block->successors[1]);
+}
+
+/* Available and anticipated expressions */
+static void compute_availability(MotionState *s) {
+    ControlFlowGraph *cfg = s->cfg;
+    unsigned int *in = (unsigned int *)malloc(s->words * sizeof(unsigned int));
+    int changed = 1;
+
+    while (changed) {
+        changed = 0;
+        for (int b = 0; b < cfg->block_count; b++) {
+            BasicBlock *block = cfg->blocks[b];
+            memset(in, b == 0 ? 0 : 0xff, s->words * sizeof(unsigned int));
+            for (int p = 0; b != 0 && p < block->pred_count; p++) {
+                BasicBlock *pred = block->predecessors[p];
+                if (!pred->reachable) continue;
+                for (int w = 0; w < s->words; w++) in[w] &= s->avail_out[pred->id][w];
+            }
+            for (int w = 0; w < s->words; w++) {
+                unsigned int out = s->downward[b][w] | (in[w] & ~s->killed[b][w]);
+                if (out != s->avail_out[b][w]) {
+                    s->avail_out[b][w] = out;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int b = cfg->block_count - 1; b >= 0; b--) {
+            BasicBlock *block = cfg->blocks[b];
+            int exits = block_exits_function(block);
+            for (int w = 0; w < s->words; w++) {
+                unsigned int out = exits ? 0 : ~0u;
+                for (int i = 0; !exits && i < block->succ_count; i++) {
+                    out &= s->ant_in[block->successors[i]->id][w];
+                }
+                unsigned int anticipated = s->upward[b][w] | (out & ~s->killed[b][w]);
+                if (anticipated != s->ant_in[b][w]) changed = 1;
+                s->ant_out[b][w] = out;
+                s->ant_in[b][w] = anticipated;
+            }
+        }
+    }
+    free(in);
+}
+
+/* Expressions still delayed on the edge pred -> block: placed no earlier
+   than here, or delayed through pred without being computed in it */
+static unsigned int later_word(MotionState *s, BasicBlock *pred, BasicBlock *block, int w) {
+    int p = pred->id;
+    unsigned int earliest = s->ant_in[block->id][w] & ~s->avail_out[p][w] &
+                            (s->killed[p][w] | ~s->ant_out[p][w]);
+    return earliest | (s->later_in[p][w] & ~s->upward[p][w]);
+}
+
+/* Delay each placement as far as every path allows */
+static void compute_latest_placement(MotionState *s) {
+    ControlFlowGraph *cfg = s->cfg;
+    int changed = 1;
+
+    /* The entry block is reached from outside the function, where every
+       anticipated expression is earliest */
+    while (changed) {
+        changed = 0;
+        for (int b = 0; b < cfg->block_count; b++) {
+            BasicBlock *block = cfg->blocks[b];
+            for (int w = 0; w < s->words; w++) {
+                unsigned int in = b == 0 ? s->ant_in[0][w] : ~0u;
+                for (int p = 0; p < block->pred_count; p++) {
+                    if (block->predecessors[p]->reachable) {
+                        in &= later_word(s, block->predecessors[p], block, w);
+                    }
+                }
+                if (in != s->later_in[b][w]) {
+                    s->later_in[b][w] = in;
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+/* Label at the head of a block, creating one if it has none */
+static int block_label(BasicBlock *block) {
+    if (block->start->opcode == TAC_LABEL) {
+        return block->start->label;
+    }
+
+    TACInstruction *label = create_tac(TAC_LABEL, NULL, NULL, NULL);
+    label->label = new_label();
+    insert_tac_after(block->before, label);
+    block->start = label;
+    return label->label;
+}
+
+/* Insert h = a op b after pos for every expression in the set; returns
+   the last instruction inserted */
+static TACInstruction *insert_computations(MotionState *s, TACInstruction *pos, unsigned int *set) {
+    for (int i = 0; i < s->expr_count; i++) {
+        if (!bit_is_set(set, i)) continue;
+        Expression *e = &s->exprs[i];
+        TACInstruction *compute = create_tac(e->op, e->holder, e->arg1, e->arg2);
+        insert_tac_after(pos, compute);
+        pos = compute;
+        opt_stats.expressions_inserted++;
+    }
+    return pos;
+}
+
+/* Instruction right before the last one of a block */
+static TACInstruction *before_end(BasicBlock *block) {
+    TACInstruction *instr = block->before;
+    while (instr->next != block->end) instr = instr->next;
+    return instr;
+}
+
+/* Insert on an edge that has its own place: the end of a block with one
+   successor or the start of a block with one predecessor */
+static void insert_on_edge(MotionState *s, BasicBlock *pred, BasicBlock *block, unsigned int *set) {
+    if (single_successor(pred)) {
+        if (is_jump(pred->end)) {
+            insert_computations(s, before_end(pred), set);
+        } else {
+            pred->end = insert_computations(s, pred->end, set);
+        }
+        return;
+    }
+
+    TACInstruction *pos = block->before;
+    for (TACInstruction *instr = block->start; instr->opcode == TAC_LABEL; instr = instr->next) {
+        pos = instr;
+        if (instr == block->end) break;
+    }
+    insert_computations(s, pos, set);
+}
+
+/* Split the edges out of a conditional branch that have no place of their
+   own. The fall-through edge gets a block right after the branch; the
+   jump edge gets one by inverting the branch to skip it */
+static void split_edges(MotionState *s, BasicBlock *pred, unsigned int *fall_set,
+                        unsigned int *jump_set) {
+    TACInstruction *branch = pred->end;
+
+    if (fall_set) {
+        insert_computations(s, branch, fall_set);
+    }
+    if (jump_set) {
+        int skip;
+        if (fall_set || pred->fall_through == NULL) {
+            TACInstruction *label = create_tac(TAC_LABEL, NULL, NULL, NULL);
+            label->label = new_label();
+            insert_tac_after(branch, label);
+            skip = label->label;
+        } else {
+            skip = block_label(pred->fall_through);
+        }
+
+        TACInstruction *jump = create_tac(TAC_GOTO, NULL, NULL, NULL);
+        jump->label = branch->label;
+        insert_tac_after(branch, jump);
+        insert_computations(s, branch, jump_set);
+
+        branch->opcode = branch->opcode == TAC_IF_TRUE ? TAC_IF_FALSE : TAC_IF_TRUE;
+        branch->label = skip;
+    }
+}
+
+/* Turn the computations of moved expressions into copies of their
+   temporaries, or save the value into it; returns the deletions */
+static int rewrite_occurrences(MotionState *s, unsigned int **deleted) {
+    int removed = 0;
+
+    for (int o = 0; o < s->occurrence_count; o++) {
+        Occurrence *occ = &s->occurrences[o];
+        Expression *e = &s->exprs[occ->expr];
+        TACInstruction *instr = occ->instr;
+
+        if (e->holder == NULL) continue;
+        if (occ->upward && bit_is_set(deleted[occ->block], occ->expr)) {
+            instr->opcode = TAC_ASSIGN;
+            free(instr->arg1);
+            free(instr->arg2);
+            instr->arg1 = copy_string(e->holder);
+            instr->arg2 = NULL;
+            opt_stats.partial_redundancies++;
+            removed++;
+        } else if (occ->downward) {
+            TACInstruction *save = create_tac(TAC_ASSIGN, NULL, e->holder, NULL);
+            BasicBlock *block = s->cfg->blocks[occ->block];
+            save->result = instr->result;
+            instr->result = copy_string(e->holder);
+            insert_tac_after(instr, save);
+            if (block->end == instr) block->end = save;
+        }
+    }
+    return removed;
+}
+
+/* Move partially redundant expressions to where they are needed */
+int partial_redundancy_elimination(TACInstruction *func_begin) {
+    TACInstruction *end = find_function_end(func_begin);
+    MotionState *s = (MotionState *)calloc(1, sizeof(MotionState));
+    int changes = 0;
+
+    for (TACInstruction *instr = func_begin->next; instr != end; instr = instr->next) {
+        if (is_movable(instr)) add_expression(s, instr);
+    }
+    if (s->expr_count == 0) {
+        free(s);
+        return 0;
+    }
+
+    s->cfg = get_function_cfg(func_begin);
+    mark_reachable_blocks(s->cfg);
+    s->words = (s->expr_count + 31) / 32;
+    s->upward = new_sets(s, 0);
+    s->downward = new_sets(s, 0);
+    s->killed = new_sets(s, 0);
+    s->avail_out = new_sets(s, 1);
+    s->ant_in = new_sets(s, 1);
+    s->ant_out = new_sets(s, 0);
+    s->later_in = new_sets(s, 1);
+
+    compute_local_properties(s);
+    compute_availability(s);
+    compute_latest_placement(s);
+
+    /* A computation is redundant where its expression is no longer being
+       delayed: the inserted or saved value reaches it on every path */
+    ControlFlowGraph *cfg = s->cfg;
+    unsigned int **deleted = new_sets(s, 0);
+    unsigned int *moved = (unsigned int *)calloc(s->words, sizeof(unsigned int));
+    for (int b = 0; b < cfg->block_count; b++) {
+        if (!cfg->blocks[b]->reachable) continue;
+        for (int w = 0; w < s->words; w++) {
+            deleted[b][w] = s->upward[b][w] & ~s->later_in[b][w];
+            moved[w] |= deleted[b][w];
+        }
+    }
+    for (int i = 0; i < s->expr_count; i++) {
+        if (bit_is_set(moved, i)) s->exprs[i].holder = new_temp();
+    }
+
+    changes = rewrite_occurrences(s, deleted);
+    if (changes > 0) {
+        /* Insertions: on the edge into the entry block from outside, then
+           on edges with a place of their own, then on split edges */
+        unsigned int **insert = (unsigned int **)malloc(cfg->block_count * 2 * sizeof(unsigned int *));
+        unsigned int *set = (unsigned int *)malloc(s->words * sizeof(unsigned int));
+
+        for (int w = 0; w < s->words; w++) {
+            set[w] = s->ant_in[0][w] & ~s->later_in[0][w] & moved[w];
+        }
+        insert_computations(s, cfg->blocks[0]->before, set);
+
+        for (int b = 0; b < cfg->block_count; b++) {
+            BasicBlock *pred = cfg->blocks[b];
+            unsigned int **sets = &insert[2 * b];
+            sets[0] = sets[1] = NULL;
+            if (!pred->reachable) continue;
+
+            for (int i = 0; i < pred->succ_count; i++) {
+                BasicBlock *block = pred->successors[i];
+                int any = 0;
+                if (i > 0 && block == pred->successors[0]) continue;
+                for (int w = 0; w < s->words; w++) {
+                    set[w] = later_word(s, pred, block, w) & ~s->later_in[block->id][w] & moved[w];
+                    any |= set[w] != 0;
+                }
+                if (!any) continue;
+
+                if (single_successor(pred) || (block->pred_count == 1 && block->id != 0)) {
+                    insert_on_edge(s, pred, block, set);
+                } else {
+                    sets[block == pred->fall_through ? 0 : 1] =
+                        (unsigned int *)malloc(s->words * sizeof(unsigned int));
+                    memcpy(sets[block == pred->fall_through ? 0 : 1], set,
+                           s->words * sizeof(unsigned int));
+                }
+            }
+        }
+
+        for (int b = 0; b < cfg->block_count; b++) {
+            if (insert[2 * b] || insert[2 * b + 1]) {
+                split_edges(s, cfg->blocks[b], insert[2 * b], insert[2 * b + 1]);
+            }
+            free(insert[2 * b]);
+            free(insert[2 * b + 1]);
+        }
+        free(insert);
+        free(set);
+    }
+
+    free_sets(s, deleted);
+    free(moved);
+    free_sets(s, s->upward);
+    free_sets(s, s->downward);
+    free_sets(s, s->killed);
+    free_sets(s, s->avail_out);
+    free_sets(s, s->ant_in);
+    free_sets(s, s->ant_out);
+    free_sets(s, s->later_in);
+    for (int i = 0; i < s->expr_count; i++) {
+        free(s->exprs[i].arg1);
+        free(s->exprs[i].arg2);
+        free(s->exprs[i].holder);
+    }
+    free(s->occurrences);
+    free(s);
+    return changes;
+}
@@ -0,0 +1,462 @@
+/*
+ * Value Range Analysis Implementation
+ * CST-405 Compiler Design
+ *
+ * Computes an interval [lo, hi] for every scalar at every point of a
+ * function by forward data flow over the CFG:
+ *   - arithmetic is evaluated on intervals, going to the full range on
+ *     possible overflow
+ *   - each conditional branch narrows the compared operands on its two
+ *     outgoing edges
+ *   - loop headers are widened after a few visits so the analysis ends;
+ *     the branch narrowing inside the loop then recovers tight ranges
+ * The ranges then fold compares whose outcome is fixed and delete
+ * -fbounds-check checks whose index provably fits the array.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "optimize.h"
+#include "cfg.h"
+#include "passes.h"
+#include "codegen.h"
+#include "globals.h"
+
+/* Visits of a loop header before its entry ranges are widened */
+#define WIDEN_AFTER_VISITS 3
+
+typedef struct {
+    long long lo;
+    long long hi;
+} Interval;
+
+static const Interval full_range = {INT_MIN, INT_MAX};
+
+/* Clamp a computed bound pair to int, or give up on overflow */
+static Interval make_interval(long long lo, long long hi) {
+    Interval result = {lo, hi};
+    if (lo < INT_MIN || hi > INT_MAX) return full_range;
+    return result;
+}
+
+/* Interval of an operand in a state */
+static Interval operand_range(VariableTable *vars, Interval *state, char *operand) {
+    if (is_constant(operand)) {
+        long long value = get_constant_value(operand);
+        Interval result = {value, value};
+        return result;
+    }
+
+    int index = variable_index(vars, operand);
+    return (index >= 0) ? state[index] : full_range;
+}
+
+static long long min4(long long a, long long b, long long c, long long d) {
+    long long m = a;
+    if (b < m) m = b;
+    if (c < m) m = c;
+    if (d < m) m = d;
+    return m;
+}
+
+static long long max4(long long a, long long b, long long c, long long d) {
+    long long m = a;
+    if (b > m) m = b;
+    if (c > m) m = c;
+    if (d > m) m = d;
+    return m;
+}
+
+/* Outcome of a compare on two intervals: 1, 0, or -1 if undecided */
+static int decide_compare(TACOpcode op, Interval x, Interval y) {
+    switch (op) {
+        case TAC_LT:
+            if (x.hi < y.lo) return 1;
+            if (x.lo >= y.hi) return 0;
+            break;
+        case TAC_LTE:
+            if (x.hi <= y.lo) return 1;
+            if (x.lo > y.hi) return 0;
+            break;
+        case TAC_GT:
+            if (x.lo > y.hi) return 1;
+            if (x.hi <= y.lo) return 0;
+            break;
+        case TAC_GTE:
+            if (x.lo >= y.hi) return 1;
+            if (x.hi < y.lo) return 0;
+            break;
+        case TAC_EQ:
+            if (x.lo == x.hi && y.lo == y.hi && x.lo == y.lo) return 1;
+            if (x.hi < y.lo || y.hi < x.lo) return 0;
+            break;
+        case TAC_NEQ:
+            if (x.lo == x.hi && y.lo == y.hi && x.lo == y.lo) return 0;
+            if (x.hi < y.lo || y.hi < x.lo) return 1;
+            break;
+        default:
+            break;
+    }
+    return -1;
+}
+
+/* Interval of the value an instruction computes */
+static Interval evaluate(VariableTable *vars, Interval *state, TACInstruction *instr) {
+    Interval x, y;
+
+    switch (instr->opcode) {
+        case TAC_LOAD_CONST:
+        case TAC_ASSIGN:
+            return operand_range(vars, state, instr->arg1);
+
+        case TAC_NEG:
+            x = operand_range(vars, state, instr->arg1);
+            return make_interval(-x.hi, -x.lo);
+
+        case TAC_ADD:
+            x = operand_range(vars, state, instr->arg1);
+            y = operand_range(vars, state, instr->arg2);
+            return make_interval(x.lo + y.lo, x.hi + y.hi);
+
+        case TAC_SUB:
+            x = operand_range(vars, state, instr->arg1);
+            y = operand_range(vars, state, instr->arg2);
+            return make_interval(x.lo - y.hi, x.hi - y.lo);
+
+        case TAC_MUL:
+            x = operand_range(vars, state, instr->arg1);
+            y = operand_range(vars, state, instr->arg2);
+            return make_interval(min4(x.lo * y.lo, x.lo * y.hi, x.hi * y.lo, x.hi * y.hi),
+                                 max4(x.lo * y.lo, x.lo * y.hi, x.hi * y.lo, x.hi * y.hi));
+
+        case TAC_DIV:
+            x = operand_range(vars, state, instr->arg1);
+            y = operand_range(vars, state, instr->arg2);
+            if (y.lo <= 0 && y.hi >= 0) return full_range;
+            return make_interval(min4(x.lo / y.lo, x.lo / y.hi, x.hi / y.lo, x.hi / y.hi),
+                                 max4(x.lo / y.lo, x.lo / y.hi, x.hi / y.lo, x.hi / y.hi));
+
+        case TAC_LT: case TAC_LTE: case TAC_GT: case TAC_GTE: case TAC_EQ: case TAC_NEQ: {
+            int outcome = decide_compare(instr->opcode,
+                                         operand_range(vars, state, instr->arg1),
+                                         operand_range(vars, state, instr->arg2));
+            Interval boolean = {outcome == 1 ? 1 : 0, outcome == 0 ? 0 : 1};
+            return boolean;
+        }
+
+        default:
+            return full_range;
+    }
+}
+
+static int narrow(VariableTable *vars, Interval *state, char *name, long long lo, long long hi);
+
+/* Apply one instruction to a state */
+static void transfer(VariableTable *vars, Interval *state, TACInstruction *instr) {
+    if (instr->opcode == TAC_CALL) {
+        /* The callee may write any global */
+        for (int i = 0; i < vars->count; i++) {
+            if (vars->is_global[i]) state[i] = full_range;
+        }
+    }
+
+    if (instr->opcode == TAC_BOUNDS_CHECK) {
+        /* Execution only continues past a check that passed */
+        narrow(vars, state, instr->arg1, 0, get_constant_value(instr->arg2) - 1);
+        return;
+    }
+
+    if (defines_result(instr)) {
+        int index = variable_index(vars, instr->result);
+        if (index >= 0) {
+            state[index] = evaluate(vars, state, instr);
+        }
+    }
+}
+
+/* Intersect a variable's interval with [lo, hi]; returns 0 if empty */
+static int narrow(VariableTable *vars, Interval *state, char *name, long long lo, long long hi) {
+    int index = variable_index(vars, name);
+    Interval value = operand_range(vars, state, name);
+
+    if (lo > value.lo) value.lo = lo;
+    if (hi < value.hi) value.hi = hi;
+    if (value.lo > value.hi) return 0;
+
+    if (index >= 0) state[index] = value;
+    return 1;
+}
+
+/* Narrow x and y so that "x op y" holds; returns 0 if it cannot */
+static int assume_compare(VariableTable *vars, Interval *state, TACOpcode op, char *x, char *y) {
+    Interval a = operand_range(vars, state, x);
+    Interval b = operand_range(vars, state, y);
+
+    switch (op) {
+        case TAC_LT:
+            return narrow(vars, state, x, INT_MIN, b.hi - 1) &&
+                   narrow(vars, state, y, a.lo + 1, INT_MAX);
+        case TAC_LTE:
+            return narrow(vars, state, x, INT_MIN, b.hi) &&
+                   narrow(vars, state, y, a.lo, INT_MAX);
+        case TAC_GT:
+            return assume_compare(vars, state, TAC_LT, y, x);
+        case TAC_GTE:
+            return assume_compare(vars, state, TAC_LTE, y, x);
+        case TAC_EQ:
+            return narrow(vars, state, x, b.lo, b.hi) &&
+                   narrow(vars, state, y, a.lo, a.hi);
+        case TAC_NEQ:
+            /* Only a single excluded value at an interval edge narrows */
+            if (b.lo == b.hi) {
+                if (a.lo == b.lo && !narrow(vars, state, x, a.lo + 1, INT_MAX)) return 0;
+                if (a.hi == b.lo && !narrow(vars, state, x, INT_MIN, a.hi - 1)) return 0;
+            }
+            if (a.lo == a.hi) {
+                if (b.lo == a.lo && !narrow(vars, state, y, b.lo + 1, INT_MAX)) return 0;
+                if (b.hi == a.lo && !narrow(vars, state, y, INT_MIN, b.hi - 1)) return 0;
+            }
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+/* Compare opcode for the negated condition */
+static TACOpcode negate_compare(TACOpcode op) {
+    switch (op) {
+        case TAC_LT:  return TAC_GTE;
+        case TAC_LTE: return TAC_GT;
+        case TAC_GT:  return TAC_LTE;
+        case TAC_GTE: return TAC_LT;
+        case TAC_EQ:  return TAC_NEQ;
+        default:      return TAC_EQ;
+    }
+}
+
+/* The compare in block that still defines the branch condition, if its
+   operands are unchanged up to the branch */
+static TACInstruction *condition_compare(BasicBlock *block) {
+    char *cond = block->end->result;
+    TACInstruction *compare = NULL;
+
+    for (TACInstruction *instr = block->start; instr != block->end; instr = instr->next) {
+        if (!defines_result(instr)) continue;
+
+        if (strcmp(instr->result, cond) == 0) {
+            compare = (instr->opcode >= TAC_LT && instr->opcode <= TAC_NEQ &&
+                       strcmp(instr->arg1, cond) != 0 && strcmp(instr->arg2, cond) != 0)
+                      ? instr : NULL;
+        } else if (compare && (strcmp(instr->result, compare->arg1) == 0 ||
+                               strcmp(instr->result, compare->arg2) == 0)) {
+            compare = NULL;
+        }
+    }
+    return compare;
+}
+
+/* Narrow a block's exit state for the edge on which its branch condition
+   is known to be truth; returns 0 if the edge can never be taken */
+static int assume_branch(VariableTable *vars, Interval *state, BasicBlock *block, int truth) {
+    char *cond = block->end->result;
+
+    if (truth) {
+        Interval c = operand_range(vars, state, cond);
+        if (c.lo == 0 && c.hi == 0) return 0;
+        if (c.lo == 0 && !narrow(vars, state, cond, 1, INT_MAX)) return 0;
+        if (c.hi == 0 && !narrow(vars, state, cond, INT_MIN, -1)) return 0;
+    } else if (!narrow(vars, state, cond, 0, 0)) {
+        return 0;
+    }
+
+    TACInstruction *compare = condition_compare(block);
+    if (compare == NULL) return 1;
+
+    TACOpcode op = truth ? compare->opcode : negate_compare(compare->opcode);
+    return assume_compare(vars, state, op, compare->arg1, compare->arg2);
+}
+
+/* Merge an edge's state into a block entry; returns 1 if it changed.
+   visits is negative for blocks that are not loop headers and never widen */
+static int merge_into(Interval **entry, int *visits, BasicBlock *block, Interval *state, int count) {
+    if (entry[block->id] == NULL) {
+        entry[block->id] = (Interval *)malloc((count + 1) * sizeof(Interval));
+        memcpy(entry[block->id], state, count * sizeof(Interval));
+        if (visits[block->id] >= 0) visits[block->id]++;
+        return 1;
+    }
+
+    int widen = visits[block->id] >= WIDEN_AFTER_VISITS;
+    int changed = 0;
+    Interval *old = entry[block->id];
+    for (int i = 0; i < count; i++) {
+        if (state[i].lo < old[i].lo) {
+            old[i].lo = widen ? INT_MIN : state[i].lo;
+            changed = 1;
+        }
+        if (state[i].hi > old[i].hi) {
+            old[i].hi = widen ? INT_MAX : state[i].hi;
+            changed = 1;
+        }
+    }
+    if (changed && visits[block->id] >= 0) visits[block->id]++;
+    return changed;
+}
+
+/* Propagate the exit state of a block along its outgoing edges */
+static int propagate_block(VariableTable *vars, Interval **entry, int *visits,
+                           BasicBlock *block, Interval *state, Interval *scratch) {
+    int changed = 0;
+    int count = vars->count;
+
+    if (is_conditional_jump(block->end) && block->jump_target != block->fall_through) {
+        int taken_truth = (block->end->opcode == TAC_IF_TRUE);
+
+        if (block->jump_target) {
+            memcpy(scratch, state, count * sizeof(Interval));
+            if (assume_branch(vars, scratch, block, taken_truth)) {
+                changed |= merge_into(entry, visits, block->jump_target, scratch, count);
+            }
+        }
+        if (block->fall_through) {
+            memcpy(scratch, state, count * sizeof(Interval));
+            if (assume_branch(vars, scratch, block, !taken_truth)) {
+                changed |= merge_into(entry, visits, block->fall_through, scratch, count);
+            }
+        }
+        return changed;
+    }
+
+    for (int i = 0; i < block->succ_count; i++) {
+        changed |= merge_into(entry, visits, block->successors[i], state, count);
+    }
+    return changed;
+}
+
+/* Rewrite instructions whose outcome the ranges decide */
+static int fold_with_ranges(ControlFlowGraph *cfg, VariableTable *vars, Interval **entry,
+                            Interval *state) {
+    int changes = 0;
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        if (entry[block->id] == NULL) continue;
+
+        memcpy(state, entry[block->id], vars->count * sizeof(Interval));
+
+        TACInstruction *prev = block->before;
+        while (1) {
+            TACInstruction *instr = prev->next;
+            int last = (instr == block->end);
+
+            if (instr->opcode >= TAC_LT && instr->opcode <= TAC_NEQ) {
+                int outcome = decide_compare(instr->opcode,
+                                             operand_range(vars, state, instr->arg1),
+                                             operand_range(vars, state, instr->arg2));
+                if (outcome >= 0) {
+                    instr->opcode = TAC_LOAD_CONST;
+                    free(instr->arg1);
+                    instr->arg1 = make_string("%d", outcome);
+                    free(instr->arg2);
+                    instr->arg2 = NULL;
+                    opt_stats.comparisons_folded++;
+                    changes++;
+                }
+            } else if (instr->opcode == TAC_BOUNDS_CHECK) {
+                Interval index = operand_range(vars, state, instr->arg1);
+                if (index.lo >= 0 && index.hi < get_constant_value(instr->arg2)) {
+                    remove_tac_after(prev);
+                    opt_stats.bounds_checks_eliminated++;
+                    changes++;
+                    if (last) {
+                        block->end = prev;
+                        if (b + 1 < cfg->block_count) cfg->blocks[b + 1]->before = prev;
+                        break;
+                    }
+                    continue;
+                }
+            } else if (is_conditional_jump(instr) && !is_constant(instr->result)) {
+                Interval cond = operand_range(vars, state, instr->result);
+                if (cond.lo > 0 || cond.hi < 0 || (cond.lo == 0 && cond.hi == 0)) {
+                    free(instr->result);
+                    instr->result = copy_string(cond.lo == 0 && cond.hi == 0 ? "0" : "1");
+                    opt_stats.comparisons_folded++;
+                    changes++;
+                }
+            }
+
+            transfer(vars, state, instr);
+            prev = instr;
+            if (last) break;
+        }
+    }
+
+    return changes;
+}
+
+/* Run value range analysis on one function and apply its results */
+int propagate_function_ranges(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = get_function_cfg(func_begin);
+    if (cfg->block_count == 0) return 0;
+
+    VariableTable *vars = cfg_variables(cfg);
+    int count = vars->count;
+    Interval **entry = (Interval **)calloc(cfg->block_count, sizeof(Interval *));
+    int *visits = (int *)calloc(cfg->block_count, sizeof(int));
+    Interval *state = (Interval *)malloc((count + 1) * sizeof(Interval));
+    Interval *scratch = (Interval *)malloc((count + 1) * sizeof(Interval));
+
+    /* Blocks in reverse postorder so most edges are seen in flow order */
+    compute_dominators(cfg);
+    BasicBlock **order = (BasicBlock **)calloc(cfg->block_count, sizeof(BasicBlock *));
+    for (int i = 0; i < cfg->block_count; i++) {
+        if (cfg->blocks[i]->rpo_number >= 0) {
+            order[cfg->blocks[i]->rpo_number] = cfg->blocks[i];
+        }
+    }
+
+    /* Only targets of back edges are widened */
+    for (int i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        visits[i] = -1;
+        for (int j = 0; j < block->pred_count; j++) {
+            if (dominates(block, block->predecessors[j])) visits[i] = 0;
+        }
+    }
+
+    /* Nothing is known on entry */
+    for (int i = 0; i < count; i++) {
+        state[i] = full_range;
+    }
+    merge_into(entry, visits, cfg->blocks[0], state, count);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < cfg->block_count && order[i]; i++) {
+            BasicBlock *block = order[i];
+            if (entry[block->id] == NULL) continue;
+
+            memcpy(state, entry[block->id], count * sizeof(Interval));
+            for (TACInstruction *instr = block->start; ; instr = instr->next) {
+                transfer(vars, state, instr);
+                if (instr == block->end) break;
+            }
+            changed |= propagate_block(vars, entry, visits, block, state, scratch);
+        }
+    }
+
+    int changes = fold_with_ranges(cfg, vars, entry, state);
+
+    for (int i = 0; i < cfg->block_count; i++) {
+        free(entry[i]);
+    }
+    free(entry);
+    free(visits);
+    free(order);
+    free(state);
+    free(scratch);
+    return changes;
+}
@@ -0,0 +1,1457 @@
+/*
+ * Graph Coloring Register Allocation
+ * CST-405 Compiler Design
+ *
+ * Chaitin-Briggs allocation over one function at a time:
+ *   - build: walk each block backward from its live-out set; a value
+ *     interferes with everything live where it is defined. Physical
+ *     registers are precolored nodes, so calls clobbering $t/$v/$a and
+ *     argument registers set up for a call show up as ordinary edges
+ *   - coalesce: merge copies (x = y, param x, x = call, return x) whose
+ *     ends do not interfere, Briggs' test between two values and George's
+ *     test against a physical register, so no merge makes the graph
+ *     harder to color
+ *   - simplify: remove nodes of degree < K, and when none is left push
+ *     the cheapest one per neighbor optimistically
+ *   - select: pop nodes and give each a color its neighbors do not have,
+ *     preferring the color of a copy partner; nodes with no color left
+ *     are spilled to a frame slot, unless they lost only for living
+ *     across calls: those are split around the calls instead, kept in a
+ *     $t register and stored and reloaded at each call they cross
+ * Spilled values are reloaded into the reserved scratch registers $t8/$t9
+ * around each use, so no rebuild is needed after spilling.
+ *
+ * Either allocator is followed by the frame layout: spill slots and local
+ * arrays are packed into the local area by their live intervals, so
+ * objects never live at the same time share stack space.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "regalloc.h"
+#include "mips.h"
+#include "optimize.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "globals.h"
+
+/* Allocator chosen by -fregalloc= */
+RegisterAllocatorKind register_allocator = REGALLOC_DEFAULT;
+
+/* Physical registers are nodes 0..31, variable i is node FIRST_VALUE + i */
+#define FIRST_VALUE 32
+
+/* Loop nesting beyond which uses weigh no more */
+#define MAX_WEIGHTED_LOOP_DEPTH 5
+
+/* Registers in the order colors are tried: caller-saved first, since
+   $s registers cost a save and restore in the prologue and epilogue */
+static const int color_order[ALLOCATABLE_REGISTER_COUNT] = {
+    8, 9, 10, 11, 12, 13, 14, 15,       /* $t0-$t7 */
+    3, 2, 7, 6, 5, 4,                   /* $v1, $v0, $a3-$a0 */
+    16, 17, 18, 19, 20, 21, 22, 23      /* $s0-$s7 */
+};
+
+static const unsigned int allocatable_mask = 0x00FFFFFCu;   /* $v0-$s7 */
+
+/* Interference graph */
+typedef struct {
+    int node_count;
+    int **adjacent;            /* Neighbor lists of value nodes */
+    int *adjacent_count;
+    int *adjacent_capacity;
+    int *degree;
+    unsigned long long *edges; /* Open addressing set of node pairs */
+    int edge_slots;
+    int edge_count;
+    int **partners;            /* Copy partners, for coalescing and biasing */
+    int *partner_count;
+    int *partner_capacity;
+    int *alias;                /* Coalesced into, or itself */
+    double *cost;              /* Spill cost */
+    double *crossing;          /* Cost of saving around the calls crossed */
+    int *split;                /* Colored by saving around calls */
+    int *color;                /* Register, or -1 */
+    int *candidate;            /* Value competes for a register */
+} InterferenceGraph;
+
+/* Copy instructions between two nodes */
+typedef struct {
+    int a;
+    int b;
+} Move;
+
+static Move *moves = NULL;
+static int move_count = 0;
+static int move_capacity = 0;
+
+/* Append to a growable int list */
+static void push_int(int **list, int *count, int *capacity, int value) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4;
+        *list = (int *)realloc(*list, *capacity * sizeof(int));
+    }
+    (*list)[(*count)++] = value;
+}
+
+static unsigned int edge_hash(unsigned long long key, int slots) {
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> 32) & (slots - 1);
+}
+
+static unsigned long long edge_key(int a, int b) {
+    if (a > b) { int t = a; a = b; b = t; }
+    return ((unsigned long long)a << 32) | (unsigned int)b;
+}
+
+/* Check if two nodes interfere */
+static int interferes(InterferenceGraph *graph, int a, int b) {
+    unsigned long long key = edge_key(a, b);
+    unsigned int slot = edge_hash(key, graph->edge_slots);
+    while (graph->edges[slot]) {
+        if (graph->edges[slot] == key) return 1;
+        slot = (slot + 1) & (graph->edge_slots - 1);
+    }
+    return 0;
+}
+
+/* Insert a key into the edge set, growing it past half full */
+static int insert_edge_key(InterferenceGraph *graph, unsigned long long key) {
+    if (2 * (graph->edge_count + 1) > graph->edge_slots) {
+        unsigned long long *old = graph->edges;
+        int old_slots = graph->edge_slots;
+        graph->edge_slots *= 2;
+        graph->edges = (unsigned long long *)calloc(graph->edge_slots,
+                                                    sizeof(unsigned long long));
+        for (int i = 0; i < old_slots; i++) {
+            if (old[i]) {
+                unsigned int slot = edge_hash(old[i], graph->edge_slots);
+                while (graph->edges[slot]) slot = (slot + 1) & (graph->edge_slots - 1);
+                graph->edges[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    unsigned int slot = edge_hash(key, graph->edge_slots);
+    while (graph->edges[slot]) {
+        if (graph->edges[slot] == key) return 0;
+        slot = (slot + 1) & (graph->edge_slots - 1);
+    }
+    graph->edges[slot] = key;
+    graph->edge_count++;
+    return 1;
+}
+
+/* Add an interference edge; physical registers keep no neighbor lists */
+static void add_interference(InterferenceGraph *graph, int a, int b) {
+    if (a == b || (a < FIRST_VALUE && b < FIRST_VALUE)) return;
+    if (a >= FIRST_VALUE && !graph->candidate[a]) return;
+    if (b >= FIRST_VALUE && !graph->candidate[b]) return;
+    if (!insert_edge_key(graph, edge_key(a, b))) return;
+
+    if (a >= FIRST_VALUE) {
+        push_int(&graph->adjacent[a], &graph->adjacent_count[a], &graph->adjacent_capacity[a], b);
+        graph->degree[a]++;
+    }
+    if (b >= FIRST_VALUE) {
+        push_int(&graph->adjacent[b], &graph->adjacent_count[b], &graph->adjacent_capacity[b], a);
+        graph->degree[b]++;
+    }
+}
+
+/* Record a copy between two nodes */
+static void add_move(InterferenceGraph *graph, int a, int b) {
+    if (a < 0 || b < 0 || a == b) return;
+    if (a >= FIRST_VALUE && !graph->candidate[a]) return;
+    if (b >= FIRST_VALUE && !graph->candidate[b]) return;
+    if (a < FIRST_VALUE && b < FIRST_VALUE) return;
+
+    if (move_count == move_capacity) {
+        move_capacity = move_capacity ? move_capacity * 2 : 64;
+        moves = (Move *)realloc(moves, move_capacity * sizeof(Move));
+    }
+    moves[move_count].a = a;
+    moves[move_count].b = b;
+    move_count++;
+
+    if (a >= FIRST_VALUE) {
+        push_int(&graph->partners[a], &graph->partner_count[a], &graph->partner_capacity[a], b);
+    }
+    if (b >= FIRST_VALUE) {
+        push_int(&graph->partners[b], &graph->partner_count[b], &graph->partner_capacity[b], a);
+    }
+}
+
+/* Node of an operand, or -1 if it does not compete for a register */
+static int value_node(InterferenceGraph *graph, VariableTable *vars, char *name) {
+    int index = variable_index(vars, name);
+    if (index < 0 || !graph->candidate[FIRST_VALUE + index]) return -1;
+    return FIRST_VALUE + index;
+}
+
+/* A definition interferes with every value live after it except itself
+   and, for a copy, its source */
+static void add_definition_edges(InterferenceGraph *graph, unsigned int *live, int words,
+                                 unsigned int phys_live, int def, int except) {
+    for (int w = 0; w < words; w++) {
+        unsigned int bits = live[w];
+        while (bits) {
+            int bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+            int node = FIRST_VALUE + w * 32 + bit;
+            if (node != except) add_interference(graph, def, node);
+        }
+    }
+    for (int r = 0; r < FIRST_VALUE; r++) {
+        if (phys_live & (1u << r)) add_interference(graph, def, r);
+    }
+}
+
+/* Scope of a function's locals, kept by semantic analysis; specialized
+   copies share the original's */
+static Scope *function_locals(char *name) {
+    SymbolEntry *symbol = lookup_symbol_in_scope(name, global_scope);
+    return symbol && symbol->kind == SYMBOL_FUNCTION ? symbol->locals : NULL;
+}
+
+/* Check if a name is an array declared in the function */
+static int declared_array(Scope *locals, char *name) {
+    SymbolEntry *symbol = locals ? lookup_symbol_in_scope(name, locals) : NULL;
+    return symbol != NULL && symbol->kind == SYMBOL_ARRAY;
+}
+
+/* Mark the variables that can live in registers: non-global scalars.
+   Arrays declared in the function stay in its frame. Without its scope,
+   names indexed as arrays are taken as local arrays unless a formal
+   defines them (then they hold the address passed by the caller) */
+static int *find_candidates(ControlFlowGraph *cfg) {
+    Scope *locals = function_locals(cfg->func_begin->result);
+    VariableTable *vars = cfg_variables(cfg);
+    int *candidate = (int *)malloc((vars->count + 1) * sizeof(int));
+    int *indexed = (int *)calloc(vars->count + 1, sizeof(int));
+    int *formal = (int *)calloc(vars->count + 1, sizeof(int));
+
+    for (TACInstruction *instr = cfg->func_begin->next; instr != cfg->func_end;
+         instr = instr->next) {
+        int index = -1;
+        if (instr->opcode == TAC_ARRAY_LOAD) index = variable_index(vars, instr->arg1);
+        else if (instr->opcode == TAC_ARRAY_STORE || instr->opcode == TAC_BOUNDS_CHECK) {
+            index = variable_index(vars, instr->result);
+        } else if (instr->opcode == TAC_FORMAL) {
+            formal[variable_index(vars, instr->result) + 1] = 1;
+        }
+        indexed[index + 1] = 1;
+    }
+
+    for (int i = 0; i < vars->count; i++) {
+        if (locals) {
+            candidate[i] = !vars->is_global[i] && !declared_array(locals, vars->names[i]);
+        } else {
+            candidate[i] = !vars->is_global[i] && (!indexed[i + 1] || formal[i + 1]);
+        }
+    }
+    free(indexed);
+    free(formal);
+    return candidate;
+}
+
+/* Live interval of each candidate over the instructions in layout order:
+   the first and last position where it is defined, used or live across a
+   block boundary. Returns the number of positions */
+static int compute_live_intervals(ControlFlowGraph *cfg, int *candidate, int *start, int *end) {
+    VariableTable *vars = cfg->variables;
+    int words = cfg->live_words;
+    int position = 0;
+
+    for (int v = 0; v < vars->count; v++) {
+        start[v] = -1;
+        end[v] = -1;
+    }
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        int first = position;
+
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            int operands[4] = {-1, -1, -1, -1};
+            if (defines_result(instr)) operands[0] = variable_index(vars, instr->result);
+            if (uses_result(instr)) operands[1] = variable_index(vars, instr->result);
+            if (instr->opcode != TAC_LABEL && instr->opcode != TAC_GOTO &&
+                instr->opcode != TAC_CALL) {
+                operands[2] = variable_index(vars, instr->arg1);
+                operands[3] = variable_index(vars, instr->arg2);
+            }
+            for (int k = 0; k < 4; k++) {
+                int v = operands[k];
+                if (v < 0 || !candidate[v]) continue;
+                if (start[v] < 0 || position < start[v]) start[v] = position;
+                if (position > end[v]) end[v] = position;
+            }
+            position++;
+            if (instr == block->end) break;
+        }
+
+        /* Live through the boundaries: extend to the block's first and
+           last position */
+        for (int w = 0; w < words; w++) {
+            unsigned int bits = block->live_in[w] | block->live_out[w];
+            while (bits) {
+                int bit = __builtin_ctz(bits);
+                bits &= bits - 1;
+                int v = w * 32 + bit;
+                if (!candidate[v]) continue;
+                int lo = bit_is_set(block->live_in, v) ? first : position - 1;
+                int hi = bit_is_set(block->live_out, v) ? position - 1 : first;
+                if (start[v] < 0 || lo < start[v]) start[v] = lo;
+                if (hi > end[v]) end[v] = hi;
+            }
+        }
+    }
+    return position;
+}
+
+/* Find the variables that always hold one constant: defined exactly
+   once, by a constant load or a copy of a constant. Spilling them costs
+   an li at each use instead of a store and reloads */
+static void find_rematerializable(ControlFlowGraph *cfg, int *candidate, int *remat, int *value) {
+    VariableTable *vars = cfg->variables;
+    int *defs = (int *)calloc(vars->count + 1, sizeof(int));
+
+    for (int v = 0; v < vars->count; v++) remat[v] = 0;
+    for (TACInstruction *instr = cfg->func_begin->next; instr != cfg->func_end;
+         instr = instr->next) {
+        if (!defines_result(instr)) continue;
+        int v = variable_index(vars, instr->result);
+        if (v < 0 || !candidate[v]) continue;
+
+        defs[v]++;
+        if (instr->opcode == TAC_LOAD_CONST ||
+            (instr->opcode == TAC_ASSIGN && is_constant(instr->arg1))) {
+            remat[v] = defs[v] == 1;
+            value[v] = atoi(instr->arg1);
+        } else {
+            remat[v] = 0;
+        }
+    }
+    for (int v = 0; v < vars->count; v++) {
+        if (defs[v] != 1) remat[v] = 0;
+    }
+    free(defs);
+}
+
+/* Execution estimate of a block: 10^loop depth, capped */
+static double block_weight(BasicBlock *block) {
+    double weight = 1;
+    for (int d = 0; d < block->loop_depth && d < MAX_WEIGHTED_LOOP_DEPTH; d++) {
+        weight *= 10;
+    }
+    return weight;
+}
+
+/* Spill cost of each candidate: every definition and use weighted by
+   10^loop depth (capped), so spill code stays out of inner loops.
+   Rematerializable values only pay for an li at each use */
+static double *compute_spill_costs(ControlFlowGraph *cfg, int *candidate, int *remat) {
+    VariableTable *vars = cfg->variables;
+    double *cost = (double *)calloc(vars->count + 1, sizeof(double));
+
+    compute_loop_depths(cfg);
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        double weight = block_weight(block);
+
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            int def = defines_result(instr) ? variable_index(vars, instr->result) : -1;
+            if (def >= 0 && candidate[def] && !remat[def]) cost[def] += weight;
+
+            int uses[3] = {-1, -1, -1};
+            if (instr->opcode != TAC_LABEL && instr->opcode != TAC_GOTO &&
+                instr->opcode != TAC_CALL) {
+                uses[0] = variable_index(vars, instr->arg1);
+                uses[1] = variable_index(vars, instr->arg2);
+            }
+            if (uses_result(instr)) uses[2] = variable_index(vars, instr->result);
+            for (int u = 0; u < 3; u++) {
+                int v = uses[u];
+                if (v >= 0 && candidate[v]) cost[v] += remat[v] ? weight / 2 : weight;
+            }
+            if (instr == block->end) break;
+        }
+    }
+    return cost;
+}
+
+/* Calls each value is live across: the call defines its result, so a
+   value live after it other than the result must survive it */
+static void for_each_call_crossing(ControlFlowGraph *cfg, int *candidate,
+                                   void (*visit)(void *, TACInstruction *, BasicBlock *, int),
+                                   void *data) {
+    VariableTable *vars = cfg->variables;
+    int words = cfg->live_words;
+    unsigned int *live = (unsigned int *)malloc(words * sizeof(unsigned int));
+    TACInstruction **body = NULL;
+    int body_capacity = 0;
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        int count = 0;
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            if (count == body_capacity) {
+                body_capacity = body_capacity ? body_capacity * 2 : 64;
+                body = (TACInstruction **)realloc(body, body_capacity * sizeof(TACInstruction *));
+            }
+            body[count++] = instr;
+            if (instr == block->end) break;
+        }
+
+        memcpy(live, block->live_out, words * sizeof(unsigned int));
+        for (int i = count - 1; i >= 0; i--) {
+            TACInstruction *instr = body[i];
+            if (instr->opcode == TAC_CALL) {
+                int def = instr->result ? variable_index(vars, instr->result) : -1;
+                for (int w = 0; w < words; w++) {
+                    unsigned int bits = live[w];
+                    while (bits) {
+                        int bit = __builtin_ctz(bits);
+                        bits &= bits - 1;
+                        int v = w * 32 + bit;
+                        if (v != def && candidate[v]) visit(data, instr, block, v);
+                    }
+                }
+            }
+            update_live_set(cfg, live, instr);
+        }
+    }
+    free(body);
+    free(live);
+}
+
+/* A store before the call and a reload after it */
+static void add_crossing_cost(void *data, TACInstruction *call, BasicBlock *block, int v) {
+    ((double *)data)[v] += 2 * block_weight(block);
+}
+
+/* Cost of keeping each candidate in a caller-saved register by saving it
+   around every call it crosses. Needs the loop depths of the spill costs */
+static double *compute_crossing_costs(ControlFlowGraph *cfg, int *candidate) {
+    double *crossing = (double *)calloc(cfg->variables->count + 1, sizeof(double));
+    for_each_call_crossing(cfg, candidate, add_crossing_cost, crossing);
+    return crossing;
+}
+
+/* Record a save around a call for each split value live across it */
+static void add_call_save(void *data, TACInstruction *call, BasicBlock *block, int v) {
+    RegisterAllocation *alloc = (RegisterAllocation *)data;
+    if (alloc->location[v] < 0 || alloc->spill_slot[v] < 0) return;
+    if (alloc->call_save_count % 16 == 0) {
+        alloc->call_saves = (CallSave *)realloc(alloc->call_saves,
+                                                (alloc->call_save_count + 16) * sizeof(CallSave));
+    }
+    alloc->call_saves[alloc->call_save_count].call = call;
+    alloc->call_saves[alloc->call_save_count].value = v;
+    alloc->call_save_count++;
+}
+
+/* Build the interference graph and the copy list from liveness */
+static void build_graph(InterferenceGraph *graph, ControlFlowGraph *cfg) {
+    VariableTable *vars = cfg->variables;
+    int words = cfg->live_words;
+    unsigned int *live = (unsigned int *)malloc(words * sizeof(unsigned int));
+    TACInstruction **body = NULL;
+    int body_capacity = 0;
+
+    /* Position of each formal among the incoming parameters */
+    int formal_number = 0;
+
+    for (int b = 0; b < cfg->block_count; b++) {
+        BasicBlock *block = cfg->blocks[b];
+        int count = 0;
+        for (TACInstruction *instr = block->start; ; instr = instr->next) {
+            if (count == body_capacity) {
+                body_capacity = body_capacity ? body_capacity * 2 : 64;
+                body = (TACInstruction **)realloc(body, body_capacity * sizeof(TACInstruction *));
+            }
+            body[count++] = instr;
+            if (instr == block->end) break;
+        }
+
+        /* Formals come first in the entry block; count them forward so the
+           backward walk knows each one's register */
+        int formals_here = 0;
+        for (int i = 0; i < count; i++) {
+            if (body[i]->opcode == TAC_FORMAL) formals_here++;
+        }
+        int formal = formal_number + formals_here;
+        formal_number += formals_here;
+
+        /* Globals and arrays stay in the live set but never get edges */
+        memcpy(live, block->live_out, words * sizeof(unsigned int));
+        unsigned int phys_live = 0;
+        int pending_params = 0;
+
+        for (int i = count - 1; i >= 0; i--) {
+            TACInstruction *instr = body[i];
+            int def = defines_result(instr) ? value_node(graph, vars, instr->result) : -1;
+
+            switch (instr->opcode) {
+                case TAC_CALL: {
+                    if (def >= 0) {
+                        add_definition_edges(graph, live, words, phys_live, def, -1);
+                        add_move(graph, def, REG_V0);
+                        clear_bit(live, def - FIRST_VALUE);
+                    }
+                    /* Values live across the call lose the caller-saved registers */
+                    for (int w = 0; w < words; w++) {
+                        unsigned int bits = live[w];
+                        while (bits) {
+                            int bit = __builtin_ctz(bits);
+                            bits &= bits - 1;
+                            int node = FIRST_VALUE + w * 32 + bit;
+                            if (!graph->candidate[node]) continue;
+                            for (int r = 0; r < FIRST_VALUE; r++) {
+                                if (CALLER_SAVED_MASK & allocatable_mask & (1u << r)) {
+                                    add_interference(graph, node, r);
+                                }
+                            }
+                        }
+                    }
+                    pending_params = instr->arg2 ? atoi(instr->arg2) : 0;
+                    phys_live = 0;
+                    for (int k = 0; k < pending_params && k < 4; k++) {
+                        phys_live |= 1u << (REG_A0 + k);
+                    }
+                    break;
+                }
+
+                case TAC_PARAM: {
+                    int k = pending_params > 0 ? --pending_params : 4;
+                    int use = value_node(graph, vars, instr->result);
+                    if (k < 4) {
+                        /* $a_k is written here and read by the call */
+                        phys_live &= ~(1u << (REG_A0 + k));
+                        add_definition_edges(graph, live, words, 0, REG_A0 + k, use);
+                        add_move(graph, use, REG_A0 + k);
+                    }
+                    break;
+                }
+
+                case TAC_FORMAL:
+                    formal--;
+                    if (def >= 0) {
+                        add_definition_edges(graph, live, words, phys_live, def, -1);
+                        /* Arrives in $a_k: coalescing can leave it there */
+                        if (formal < 4) add_move(graph, def, REG_A0 + formal);
+                    }
+                    /* Later parameters wait in their $a registers until read */
+                    if (formal < 4) phys_live |= 1u << (REG_A0 + formal);
+                    break;
+
+                case TAC_RETURN:
+                    add_move(graph, value_node(graph, vars, instr->result), REG_V0);
+                    break;
+
+                case TAC_ASSIGN: {
+                    int source = value_node(graph, vars, instr->arg1);
+                    if (def >= 0) {
+                        add_definition_edges(graph, live, words, phys_live, def, source);
+                        add_move(graph, def, source);
+                    }
+                    break;
+                }
+
+                default:
+                    if (def >= 0) {
+                        add_definition_edges(graph, live, words, phys_live, def, -1);
+                    }
+                    break;
+            }
+
+            update_live_set(cfg, live, instr);
+        }
+    }
+
+    free(body);
+    free(live);
+}
+
+/* Representative of a node, compressing the chain of merges behind it */
+static int find_alias(InterferenceGraph *graph, int node) {
+    int root = node;
+    while (graph->alias[root] != root) root = graph->alias[root];
+    while (graph->alias[node] != root) {
+        int next = graph->alias[node];
+        graph->alias[node] = root;
+        node = next;
+    }
+    return root;
+}
+
+/* George: every neighbor of y already conflicts with x or is
+   insignificant, so merging y into x adds no constraint */
+static int george_safe(InterferenceGraph *graph, int x, int y) {
+    for (int i = 0; i < graph->adjacent_count[y]; i++) {
+        int t = find_alias(graph, graph->adjacent[y][i]);
+        if (t < FIRST_VALUE || t == y || t == x) continue;
+        if (!interferes(graph, t, x) && graph->degree[t] >= ALLOCATABLE_REGISTER_COUNT) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Briggs: the merged node has fewer than K significant neighbors.
+   stamp marks neighbors already counted, tagged with this query's id */
+static int briggs_safe(InterferenceGraph *graph, int x, int y, int *stamp, int query) {
+    int significant = 0;
+    int pair[2] = {x, y};
+    for (int p = 0; p < 2; p++) {
+        int node = pair[p];
+        for (int i = 0; i < graph->adjacent_count[node]; i++) {
+            int t = find_alias(graph, graph->adjacent[node][i]);
+            if (t == x || t == y || stamp[t] == query) continue;
+            stamp[t] = query;
+            if (t < FIRST_VALUE) {
+                significant++;
+            } else if (graph->degree[t] >= ALLOCATABLE_REGISTER_COUNT) {
+                /* A neighbor of both loses one edge in the merge */
+                int degree = graph->degree[t];
+                if (interferes(graph, t, x) && interferes(graph, t, y)) degree--;
+                if (degree >= ALLOCATABLE_REGISTER_COUNT) significant++;
+            }
+            if (significant >= ALLOCATABLE_REGISTER_COUNT) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Merge node y into x */
+static void merge_nodes(InterferenceGraph *graph, int x, int y) {
+    graph->alias[y] = x;
+    if (x >= FIRST_VALUE) {
+        graph->cost[x] += graph->cost[y];
+        graph->crossing[x] += graph->crossing[y];
+    }
+
+    for (int i = 0; i < graph->adjacent_count[y]; i++) {
+        int t = find_alias(graph, graph->adjacent[y][i]);
+        if (t == x || t == y) continue;
+        if (t >= FIRST_VALUE && interferes(graph, t, x)) {
+            graph->degree[t]--;        /* Loses y, already had x */
+        } else {
+            add_interference(graph, t, x);
+            if (t >= FIRST_VALUE) graph->degree[t]--;   /* y replaced by x */
+        }
+    }
+
+    if (x >= FIRST_VALUE) {
+        for (int i = 0; i < graph->partner_count[y]; i++) {
+            push_int(&graph->partners[x], &graph->partner_count[x],
+                     &graph->partner_capacity[x], graph->partners[y][i]);
+        }
+    }
+}
+
+/* Coalesce copies until no more merges are safe */
+static void coalesce(InterferenceGraph *graph, int *stamp) {
+    int query = -1;
+    int merged = 1;
+    while (merged) {
+        merged = 0;
+        for (int m = 0; m < move_count; m++) {
+            int x = find_alias(graph, moves[m].a);
+            int y = find_alias(graph, moves[m].b);
+            if (y < FIRST_VALUE) { int t = x; x = y; y = t; }
+            if (x == y || y < FIRST_VALUE || interferes(graph, x, y)) continue;
+
+            /* George against a register; between two values try George
+               from the smaller side first, it only scans that side */
+            int safe;
+            if (x < FIRST_VALUE) {
+                safe = george_safe(graph, x, y);
+            } else {
+                if (graph->adjacent_count[x] < graph->adjacent_count[y]) {
+                    int t = x; x = y; y = t;
+                }
+                safe = george_safe(graph, x, y) || briggs_safe(graph, x, y, stamp, --query);
+            }
+            if (safe) {
+                merge_nodes(graph, x, y);
+                merged = 1;
+            }
+        }
+    }
+    for (int node = 0; node < graph->node_count; node++) stamp[node] = -1;
+}
+
+/* Min-heap of spill candidates keyed by cost / degree; entries go stale
+   as degrees drop and are refreshed when they reach the top */
+typedef struct {
+    double key;
+    int node;
+    int degree;
+} SpillEntry;
+
+static void heap_push(SpillEntry **heap, int *count, int *capacity, SpillEntry entry) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *heap = (SpillEntry *)realloc(*heap, *capacity * sizeof(SpillEntry));
+    }
+    int i = (*count)++;
+    while (i > 0 && (*heap)[(i - 1) / 2].key > entry.key) {
+        (*heap)[i] = (*heap)[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    (*heap)[i] = entry;
+}
+
+static SpillEntry heap_pop(SpillEntry *heap, int *count) {
+    SpillEntry top = heap[0];
+    SpillEntry last = heap[--(*count)];
+    int i = 0;
+    while (2 * i + 1 < *count) {
+        int child = 2 * i + 1;
+        if (child + 1 < *count && heap[child + 1].key < heap[child].key) child++;
+        if (heap[child].key >= last.key) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count > 0) heap[i] = last;
+    return top;
+}
+
+static SpillEntry spill_entry(InterferenceGraph *graph, int node) {
+    SpillEntry entry;
+    entry.node = node;
+    entry.degree = graph->degree[node];
+    entry.key = graph->cost[node] / (entry.degree > 0 ? entry.degree : 1);
+    return entry;
+}
+
+/* Simplify onto a stack, then pop and color */
+static void simplify_and_select(InterferenceGraph *graph, int *stamp) {
+    int n = graph->node_count;
+    int *stack = (int *)malloc(n * sizeof(int));
+    int *low = (int *)malloc(n * sizeof(int));
+    int *removed = (int *)calloc(n, sizeof(int));
+    int stack_count = 0, low_count = 0, remaining = 0;
+    SpillEntry *heap = NULL;
+    int heap_count = 0, heap_capacity = 0;
+
+    for (int node = FIRST_VALUE; node < n; node++) {
+        if (!graph->candidate[node] || graph->alias[node] != node) continue;
+        remaining++;
+        if (graph->degree[node] < ALLOCATABLE_REGISTER_COUNT) {
+            low[low_count++] = node;
+        } else {
+            heap_push(&heap, &heap_count, &heap_capacity, spill_entry(graph, node));
+        }
+    }
+
+    while (remaining > 0) {
+        int node = -1;
+        while (low_count > 0 && node < 0) {
+            int candidate = low[--low_count];
+            if (!removed[candidate]) node = candidate;
+        }
+        while (node < 0 && heap_count > 0) {
+            SpillEntry entry = heap_pop(heap, &heap_count);
+            if (removed[entry.node]) continue;
+            if (entry.degree != graph->degree[entry.node]) {
+                heap_push(&heap, &heap_count, &heap_capacity, spill_entry(graph, entry.node));
+                continue;
+            }
+            node = entry.node;          /* Optimistic: may still get a color */
+        }
+        if (node < 0) break;
+
+        removed[node] = 1;
+        stack[stack_count++] = node;
+        remaining--;
+
+        for (int i = 0; i < graph->adjacent_count[node]; i++) {
+            int t = find_alias(graph, graph->adjacent[node][i]);
+            if (t < FIRST_VALUE || removed[t] || stamp[t] == node) continue;
+            stamp[t] = node;
+            if (--graph->degree[t] == ALLOCATABLE_REGISTER_COUNT - 1) {
+                low[low_count++] = t;
+            }
+        }
+    }
+    for (int node = 0; node < n; node++) stamp[node] = -1;
+
+    while (stack_count > 0) {
+        int node = stack[--stack_count];
+        unsigned int forbidden = 0, taken = 0;
+        for (int i = 0; i < graph->adjacent_count[node]; i++) {
+            int t = find_alias(graph, graph->adjacent[node][i]);
+            if (t < FIRST_VALUE) forbidden |= 1u << t;
+            else if (graph->color[t] >= 0) taken |= 1u << graph->color[t];
+        }
+        unsigned int available = allocatable_mask & ~(forbidden | taken);
+        if (available == 0) {
+            /* Only the calls' clobbers stand in the way of the $t registers
+               (and $v1): keep the value in one and save it around the
+               calls, when that costs less than spilling it */
+            if (graph->crossing[node] == 0 || graph->crossing[node] >= graph->cost[node]) continue;
+            available = SPLIT_MASK & ~taken;
+            if (available == 0) continue;
+            graph->split[node] = 1;
+        }
+
+        /* Biased coloring: reuse a copy partner's register when possible */
+        int chosen = -1;
+        for (int i = 0; i < graph->partner_count[node] && chosen < 0; i++) {
+            int p = find_alias(graph, graph->partners[node][i]);
+            int c = p < FIRST_VALUE ? p : graph->color[p];
+            if (c >= 0 && (available & (1u << c))) chosen = c;
+        }
+        for (int i = 0; i < ALLOCATABLE_REGISTER_COUNT && chosen < 0; i++) {
+            if (available & (1u << color_order[i])) chosen = color_order[i];
+        }
+        graph->color[node] = chosen;
+    }
+
+    free(stack);
+    free(low);
+    free(removed);
+    free(heap);
+}
+
+/* Empty result: candidates unassigned, everything else LOCATION_NONE */
+static RegisterAllocation *new_allocation(ControlFlowGraph *cfg, int *candidate,
+                                          const char *method) {
+    VariableTable *vars = cfg->variables;
+    RegisterAllocation *alloc = (RegisterAllocation *)calloc(1, sizeof(RegisterAllocation));
+    alloc->cfg = cfg;
+    alloc->method = method;
+    alloc->location = (int *)malloc((vars->count + 1) * sizeof(int));
+    alloc->spill_slot = (int *)malloc((vars->count + 1) * sizeof(int));
+    alloc->live_start = (int *)malloc((vars->count + 1) * sizeof(int));
+    alloc->last_use = (int *)malloc((vars->count + 1) * sizeof(int));
+    alloc->rematerializable = (int *)malloc((vars->count + 1) * sizeof(int));
+    alloc->constant = (int *)malloc((vars->count + 1) * sizeof(int));
+    for (int i = 0; i < vars->count; i++) {
+        alloc->location[i] = LOCATION_NONE;
+        alloc->spill_slot[i] = -1;
+        if (candidate[i]) alloc->values++;
+    }
+    find_rematerializable(cfg, candidate, alloc->rematerializable, alloc->constant);
+    return alloc;
+}
+
+/* Send a value without a register to memory, or recompute it at each use
+   when it is a constant. Values coalesced together (same group) share a
+   slot when group_slot is given */
+static void spill_value(RegisterAllocation *alloc, int v, int *group_slot, int group) {
+    if (alloc->rematerializable[v]) {
+        alloc->location[v] = LOCATION_REMAT;
+        alloc->rematerialized++;
+        return;
+    }
+    alloc->location[v] = LOCATION_SPILL;
+    if (group_slot == NULL) {
+        alloc->spill_slot[v] = alloc->spill_count++;
+    } else {
+        if (group_slot[group] < 0) group_slot[group] = alloc->spill_count++;
+        alloc->spill_slot[v] = group_slot[group];
+    }
+    alloc->spilled_values++;
+}
+
+/* Keep a value in its caller-saved register, with a frame slot to hold it
+   while a call runs; shares the slot of its group like spill_value */
+static void split_value(RegisterAllocation *alloc, int v, int reg, int *group_slot, int group) {
+    alloc->location[v] = reg;
+    alloc->used_mask |= 1u << reg;
+    if (group_slot == NULL) {
+        alloc->spill_slot[v] = alloc->spill_count++;
+    } else {
+        if (group_slot[group] < 0) group_slot[group] = alloc->spill_count++;
+        alloc->spill_slot[v] = group_slot[group];
+    }
+    alloc->split++;
+}
+
+/* Allocate registers for one function by graph coloring */
+RegisterAllocation *allocate_registers_graph(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = build_cfg(func_begin);
+    compute_liveness(cfg);
+    VariableTable *vars = cfg->variables;
+
+    InterferenceGraph graph;
+    int n = FIRST_VALUE + vars->count;
+    graph.node_count = n;
+    graph.adjacent = (int **)calloc(n, sizeof(int *));
+    graph.adjacent_count = (int *)calloc(n, sizeof(int));
+    graph.adjacent_capacity = (int *)calloc(n, sizeof(int));
+    graph.degree = (int *)calloc(n, sizeof(int));
+    graph.edge_slots = 1024;
+    graph.edge_count = 0;
+    graph.edges = (unsigned long long *)calloc(graph.edge_slots, sizeof(unsigned long long));
+    graph.partners = (int **)calloc(n, sizeof(int *));
+    graph.partner_count = (int *)calloc(n, sizeof(int));
+    graph.partner_capacity = (int *)calloc(n, sizeof(int));
+    graph.alias = (int *)malloc(n * sizeof(int));
+    graph.cost = (double *)calloc(n, sizeof(double));
+    graph.crossing = (double *)calloc(n, sizeof(double));
+    graph.split = (int *)calloc(n, sizeof(int));
+    graph.color = (int *)malloc(n * sizeof(int));
+    graph.candidate = (int *)calloc(n, sizeof(int));
+    int *candidate = find_candidates(cfg);
+    RegisterAllocation *alloc = new_allocation(cfg, candidate, "graph");
+    double *cost = compute_spill_costs(cfg, candidate, alloc->rematerializable);
+    double *crossing = compute_crossing_costs(cfg, candidate);
+    for (int i = 0; i < vars->count; i++) {
+        graph.candidate[FIRST_VALUE + i] = candidate[i];
+        graph.cost[FIRST_VALUE + i] = cost[i];
+        graph.crossing[FIRST_VALUE + i] = crossing[i];
+    }
+    free(cost);
+    free(crossing);
+    int *stamp = (int *)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        graph.alias[i] = i;
+        graph.color[i] = i < FIRST_VALUE ? i : -1;
+        stamp[i] = -1;
+    }
+    move_count = 0;
+
+    build_graph(&graph, cfg);
+
+    compute_live_intervals(cfg, candidate, alloc->live_start, alloc->last_use);
+    alloc->interference_edges = graph.edge_count;
+    alloc->moves = move_count;
+
+    coalesce(&graph, stamp);
+    simplify_and_select(&graph, stamp);
+
+    /* Values coalesced together share one spill or save slot */
+    int *group_slot = (int *)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) group_slot[i] = -1;
+    
+    for (int i = 0; i < vars->count; i++) {
+        int node = FIRST_VALUE + i;
+        if (!graph.candidate[node]) continue;
+        int root = find_alias(&graph, node);
+        int color = graph.color[root];
+        if (color >= 0 && graph.split[root]) {
+            split_value(alloc, i, color, group_slot, root);
+        } else if (color >= 0) {
+            alloc->location[i] = color;
+            alloc->used_mask |= 1u << color;
+        } else {
+            spill_value(alloc, i, group_slot, root);
+        }
+    }
+    free(group_slot);
+    for_each_call_crossing(cfg, candidate, add_call_save, alloc);
+
+    /* A copy disappears when both ends share a register */
+    for (int m = 0; m < move_count; m++) {
+        int a = graph.color[find_alias(&graph, moves[m].a)];
+        int b = graph.color[find_alias(&graph, moves[m].b)];
+        if (a >= 0 && a == b) alloc->moves_coalesced++;
+    }
+
+    for (int i = 0; i < n; i++) {
+        free(graph.adjacent[i]);
+        free(graph.partners[i]);
+    }
+    free(graph.adjacent);
+    free(graph.adjacent_count);
+    free(graph.adjacent_capacity);
+    free(graph.degree);
+    free(graph.edges);
+    free(graph.partners);
+    free(graph.partner_count);
+    free(graph.partner_capacity);
+    free(graph.alias);
+    free(graph.cost);
+    free(graph.crossing);
+    free(graph.split);
+    free(graph.color);
+    free(graph.candidate);
+    free(candidate);
+    free(stamp);
+
+    return alloc;
+}
+
+/* Linear scan (Poletto and Sarkar): visit live intervals by start point,
+   freeing the registers of intervals that have ended; when none is free,
+   spill the one with the lowest cost per position among the current
+   interval and the active ones. Intervals containing a call take $s
+   registers, or when none is left a $t register saved around each call,
+   if that is cheaper than spilling. $v0 and $a0-$a3 are left out of the
+   pool, so argument set-up and return values need no constraints; only
+   an incoming parameter may stay in the $a register it arrived in, when
+   no argument set-up or call happens while it is live */
+static const int linear_caller_saved[] = {8, 9, 10, 11, 12, 13, 14, 15, 3};   /* $t0-$t7, $v1 */
+static const int linear_callee_saved[] = {16, 17, 18, 19, 20, 21, 22, 23};    /* $s0-$s7 */
+#define LINEAR_CALLER_SAVED 9
+#define LINEAR_CALLEE_SAVED 8
+
+static int *interval_start_key;
+
+/* Instructions in the function */
+static int position_count(ControlFlowGraph *cfg) {
+    int count = 0;
+    for (TACInstruction *instr = cfg->func_begin->next; instr != cfg->func_end;
+         instr = instr->next) {
+        count++;
+    }
+    return count;
+}
+
+/* Check if one of the sorted positions lies in [from, to) */
+static int clobbered_within(int *positions, int count, int from, int to) {
+    int low = 0, high = count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (positions[middle] < from) low = middle + 1;
+        else high = middle;
+    }
+    return low < count && positions[low] < to;
+}
+
+/* Spill cost per position of a live interval: long intervals with few
+   uses go to memory first */
+static double spill_density(double *cost, int *start, int *end, int v) {
+    return cost[v] / (end[v] - start[v] + 1);
+}
+
+static int compare_interval_start(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    if (interval_start_key[x] != interval_start_key[y]) {
+        return interval_start_key[x] - interval_start_key[y];
+    }
+    return x - y;
+}
+
+RegisterAllocation *allocate_registers_linear(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = build_cfg(func_begin);
+    compute_liveness(cfg);
+    VariableTable *vars = cfg->variables;
+    int *candidate = find_candidates(cfg);
+    RegisterAllocation *alloc = new_allocation(cfg, candidate, "linear");
+    int *start = alloc->live_start;
+    int *end = alloc->last_use;
+    double *cost = compute_spill_costs(cfg, candidate, alloc->rematerializable);
+    double *crossing = compute_crossing_costs(cfg, candidate);
+    int *split = (int *)calloc(vars->count + 1, sizeof(int));
+
+    /* Positions of the calls, in order */
+    int call_count = 0;
+    for (TACInstruction *instr = func_begin->next; instr != cfg->func_end; instr = instr->next) {
+        if (instr->opcode == TAC_CALL) call_count++;
+    }
+    int *calls = (int *)malloc((call_count + 1) * sizeof(int));
+    int *clobbers = (int *)malloc((position_count(cfg) + 1) * sizeof(int));
+    int clobber_count = 0;
+    int *incoming = (int *)calloc(vars->count + 1, sizeof(int));
+    int formal = 0;
+    call_count = 0;
+    int position = 0;
+    for (int b = 0; b < cfg->block_count; b++) {
+        for (TACInstruction *instr = cfg->blocks[b]->start; ; instr = instr->next) {
+            if (instr->opcode == TAC_CALL) calls[call_count++] = position;
+            if (instr->opcode == TAC_CALL || instr->opcode == TAC_PARAM) {
+                clobbers[clobber_count++] = position;
+            }
+            if (instr->opcode == TAC_FORMAL) {
+                int v = variable_index(vars, instr->result);
+                if (v >= 0 && formal < 4) incoming[v] = REG_A0 + formal;
+                formal++;
+            }
+            position++;
+            if (instr == cfg->blocks[b]->end) break;
+        }
+    }
+
+    int *order = (int *)malloc((vars->count + 1) * sizeof(int));
+    int order_count = 0;
+    for (int v = 0; v < vars->count; v++) {
+        if (candidate[v]) order[order_count++] = v;
+    }
+    compute_live_intervals(cfg, candidate, start, end);
+    interval_start_key = start;
+    qsort(order, order_count, sizeof(int), compare_interval_start);
+
+    /* Active intervals, sorted by increasing end */
+    int active[ALLOCATABLE_REGISTER_COUNT];
+    int active_count = 0;
+    unsigned int free_mask = 0;
+    for (int i = 0; i < LINEAR_CALLER_SAVED; i++) free_mask |= 1u << linear_caller_saved[i];
+    for (int i = 0; i < LINEAR_CALLEE_SAVED; i++) free_mask |= 1u << linear_callee_saved[i];
+    unsigned int pool_mask = free_mask;
+
+    int next_call = 0;
+    for (int i = 0; i < order_count; i++) {
+        int v = order[i];
+
+        /* Expire intervals ending before this one starts; one ending at
+           its start is an operand of the defining instruction, which reads
+           its operands before writing the result */
+        int kept = 0;
+        for (int a = 0; a < active_count; a++) {
+            int u = active[a];
+            if (end[u] <= start[v]) free_mask |= (1u << alloc->location[u]) & pool_mask;
+            else active[kept++] = u;
+        }
+        active_count = kept;
+
+        while (next_call < call_count && calls[next_call] <= start[v]) next_call++;
+        int crosses_call = next_call < call_count && calls[next_call] < end[v];
+
+        int reg = -1;
+        if (incoming[v] && !clobbered_within(clobbers, clobber_count, start[v], end[v])) {
+            reg = incoming[v];
+        }
+        if (!crosses_call) {
+            for (int r = 0; r < LINEAR_CALLER_SAVED && reg < 0; r++) {
+                if (free_mask & (1u << linear_caller_saved[r])) reg = linear_caller_saved[r];
+            }
+        }
+        for (int r = 0; r < LINEAR_CALLEE_SAVED && reg < 0; r++) {
+            if (free_mask & (1u << linear_callee_saved[r])) reg = linear_callee_saved[r];
+        }
+        if (reg < 0 && crosses_call && crossing[v] < cost[v]) {
+            for (int r = 0; r < LINEAR_CALLER_SAVED && reg < 0; r++) {
+                if (free_mask & (1u << linear_caller_saved[r])) reg = linear_caller_saved[r];
+            }
+            split[v] = reg >= 0;
+        }
+
+        if (reg < 0) {
+            /* Spill the interval with the lowest cost per position, among
+               this one and the active ones whose register suits it */
+            int victim = -1;
+            double lowest = spill_density(cost, start, end, v);
+            for (int a = 0; a < active_count; a++) {
+                int u = active[a];
+                if (!(pool_mask & (1u << alloc->location[u]))) continue;
+                if (crosses_call && !(CALLEE_SAVED_MASK & (1u << alloc->location[u]))) continue;
+                double density = spill_density(cost, start, end, u);
+                if (density < lowest) {
+                    lowest = density;
+                    victim = a;
+                }
+            }
+            if (victim < 0) {
+                alloc->location[v] = LOCATION_SPILL;
+                continue;
+            }
+            int u = active[victim];
+            reg = alloc->location[u];
+            alloc->location[u] = LOCATION_SPILL;
+            split[u] = 0;
+            for (int a = victim; a + 1 < active_count; a++) active[a] = active[a + 1];
+            active_count--;
+        } else {
+            free_mask &= ~(1u << reg);
+        }
+
+        alloc->location[v] = reg;
+        alloc->used_mask |= 1u << reg;
+        int a = active_count++;
+        while (a > 0 && end[active[a - 1]] > end[v]) {
+            active[a] = active[a - 1];
+            a--;
+        }
+        active[a] = v;
+    }
+
+    /* Give each spilled or split value its own slot */
+    for (int v = 0; v < vars->count; v++) {
+        if (alloc->location[v] == LOCATION_SPILL) {
+            spill_value(alloc, v, NULL, 0);
+        } else if (split[v]) {
+            split_value(alloc, v, alloc->location[v], NULL, 0);
+        }
+    }
+    for_each_call_crossing(cfg, candidate, add_call_save, alloc);
+
+    /* Copies whose ends happened to get the same register */
+    for (TACInstruction *instr = func_begin->next; instr != cfg->func_end; instr = instr->next) {
+        if (instr->opcode != TAC_ASSIGN) continue;
+        int d = variable_index(vars, instr->result);
+        int s = variable_index(vars, instr->arg1);
+        if (d < 0 || s < 0 || !candidate[d] || !candidate[s]) continue;
+        alloc->moves++;
+        if (alloc->location[d] >= 0 && alloc->location[d] == alloc->location[s]) {
+            alloc->moves_coalesced++;
+        }
+    }
+
+    free(calls);
+    free(clobbers);
+    free(incoming);
+    free(order);
+    free(cost);
+    free(crossing);
+    free(split);
+    free(candidate);
+    return alloc;
+}
+
+/* Something the frame holds: a spill or save slot, or a local array */
+typedef struct {
+    int size;                  /* Bytes */
+    int start;                 /* Live interval */
+    int end;
+    int order;                 /* Declaration order among arrays, slot number after */
+    int offset;                /* Assigned byte offset in the local area */
+} FrameObject;
+
+static int compare_frame_objects(const void *a, const void *b) {
+    const FrameObject *x = *(const FrameObject * const *)a;
+    const FrameObject *y = *(const FrameObject * const *)b;
+    if (x->start != y->start) return x->start - y->start;
+    return x->order - y->order;
+}
+
+/* Check if a name is an operand that addresses an array */
+static char *array_operand(TACInstruction *instr) {
+    switch (instr->opcode) {
+        case TAC_ARRAY_LOAD: return instr->arg1;
+        case TAC_ARRAY_STORE: case TAC_BOUNDS_CHECK: case TAC_PARAM: return instr->result;
+        default: return NULL;
+    }
+}
+
+/* Find the local arrays and how long they live. An array is never
+   killed, so it lives from entry to the last point where an access can
+   still be reached; an array passed to a call lives through the call */
+static void find_local_arrays(RegisterAllocation *alloc, FrameObject **objects, int *count) {
+    ControlFlowGraph *cfg = alloc->cfg;
+    Scope *locals = function_locals(cfg->func_begin->result);
+    int *block_end = (int *)malloc(cfg->block_count * sizeof(int));
+    int *reaches = (int *)malloc(cfg->block_count * sizeof(int));
+    int *worklist = (int *)malloc(cfg->block_count * sizeof(int));
+
+    int position = 0;
+    for (int b = 0; b < cfg->block_count; b++) {
+        for (TACInstruction *instr = cfg->blocks[b]->start; ; instr = instr->next) {
+            position++;
+            if (instr == cfg->blocks[b]->end) break;
+        }
+        block_end[b] = position - 1;
+    }
+
+    for (TACInstruction *instr = cfg->func_begin->next; instr != cfg->func_end;
+         instr = instr->next) {
+        char *name = array_operand(instr);
+        if (name == NULL || is_constant(name) || !is_local_array(alloc, name)) continue;
+        int known = 0;
+        for (int a = 0; a < alloc->array_count && !known; a++) {
+            known = strcmp(alloc->array_names[a], name) == 0;
+        }
+        if (known) continue;
+
+        SymbolEntry *symbol = locals ? lookup_symbol_in_scope(name, locals) : NULL;
+        int a = alloc->array_count++;
+        alloc->array_names = (char **)realloc(alloc->array_names, alloc->array_count * sizeof(char *));
+        alloc->array_names[a] = name;
+        *objects = (FrameObject *)realloc(*objects, (*count + 1) * sizeof(FrameObject));
+        FrameObject *object = &(*objects)[(*count)++];
+        object->size = symbol && symbol->size > 0 ? 4 * symbol->size : 4;
+        object->start = 0;
+        object->end = 0;
+        object->order = symbol ? symbol->memory_location : a;
+
+        /* Last access in each block, counting the call an argument goes to */
+        int worklist_count = 0;
+        position = 0;
+        for (int b = 0; b < cfg->block_count; b++) {
+            int passed = 0;
+            reaches[b] = 0;
+            for (TACInstruction *i = cfg->blocks[b]->start; ; i = i->next) {
+                char *operand = array_operand(i);
+                if ((operand && strcmp(operand, name) == 0) || (i->opcode == TAC_CALL && passed)) {
+                    passed = i->opcode == TAC_PARAM;
+                    reaches[b] = 1;
+                    if (position > object->end) object->end = position;
+                }
+                position++;
+                if (i == cfg->blocks[b]->end) break;
+            }
+            if (reaches[b]) worklist[worklist_count++] = b;
+        }
+
+        /* Blocks that can reach an access keep the array live to their end */
+        while (worklist_count > 0) {
+            BasicBlock *block = cfg->blocks[worklist[--worklist_count]];
+            for (int p = 0; p < block->pred_count; p++) {
+                int pred = block->predecessors[p]->id;
+                if (block_end[pred] > object->end) object->end = block_end[pred];
+                if (!reaches[pred]) {
+                    reaches[pred] = 1;
+                    worklist[worklist_count++] = pred;
+                }
+            }
+        }
+    }
+
+    free(block_end);
+    free(reaches);
+    free(worklist);
+}
+
+/* Stack slot coloring: visit the frame objects by start of life and give
+   each the lowest offset where it overlaps no object still live. One
+   ending where another starts can share with it: that instruction reads
+   its operands before writing its result */
+static void layout_frame(RegisterAllocation *alloc) {
+    FrameObject *objects = NULL;
+    int count = 0;
+
+    find_local_arrays(alloc, &objects, &count);
+    int arrays = count;
+
+    objects = (FrameObject *)realloc(objects, (count + alloc->spill_count + 1) * sizeof(FrameObject));
+    for (int slot = 0; slot < alloc->spill_count; slot++) {
+        FrameObject *object = &objects[count++];
+        object->size = 4;
+        object->start = -1;
+        object->end = -1;
+        object->order = 0x40000000 + slot;
+    }
+    for (int v = 0; v < alloc->cfg->variables->count; v++) {
+        int slot = alloc->spill_slot[v];
+        if (slot < 0) continue;
+        FrameObject *object = &objects[arrays + slot];
+        if (object->start < 0 || alloc->live_start[v] < object->start) {
+            object->start = alloc->live_start[v];
+        }
+        if (alloc->last_use[v] > object->end) object->end = alloc->last_use[v];
+    }
+
+    FrameObject **order = (FrameObject **)malloc((count + 1) * sizeof(FrameObject *));
+    FrameObject **active = (FrameObject **)malloc((count + 1) * sizeof(FrameObject *));
+    int active_count = 0;
+    for (int i = 0; i < count; i++) order[i] = &objects[i];
+    qsort(order, count, sizeof(FrameObject *), compare_frame_objects);
+
+    alloc->frame_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        FrameObject *object = order[i];
+
+        /* Drop the objects that are dead by now; the rest stay sorted by offset */
+        int kept = 0;
+        for (int a = 0; a < active_count; a++) {
+            if (active[a]->end > object->start) active[kept++] = active[a];
+        }
+        active_count = kept;
+
+        /* First gap between live objects that fits */
+        int offset = 0, a = 0;
+        while (a < active_count && active[a]->offset - offset < object->size) {
+            if (active[a]->offset + active[a]->size > offset) {
+                offset = active[a]->offset + active[a]->size;
+            }
+            a++;
+        }
+        object->offset = offset;
+        for (int k = active_count++; k > a; k--) active[k] = active[k - 1];
+        active[a] = object;
+        if (offset + object->size > alloc->frame_bytes) {
+            alloc->frame_bytes = offset + object->size;
+        }
+    }
+
+    alloc->array_offset = (int *)malloc((arrays + 1) * sizeof(int));
+    alloc->slot_offset = (int *)malloc((alloc->spill_count + 1) * sizeof(int));
+    for (int i = 0; i < arrays; i++) alloc->array_offset[i] = objects[i].offset;
+    for (int slot = 0; slot < alloc->spill_count; slot++) {
+        alloc->slot_offset[slot] = objects[arrays + slot].offset;
+    }
+    free(order);
+    free(active);
+    free(objects);
+}
+
+/* Allocate with the method chosen by -fregalloc, or by optimization level */
+RegisterAllocation *allocate_registers(TACInstruction *func_begin) {
+    RegisterAllocatorKind kind = register_allocator;
+    if (kind == REGALLOC_DEFAULT) {
+        kind = optimization_level >= OPT_AGGRESSIVE ? REGALLOC_GRAPH : REGALLOC_LINEAR;
+    }
+    clock_t started = clock();
+    RegisterAllocation *alloc = kind == REGALLOC_GRAPH ? allocate_registers_graph(func_begin)
+                                                       : allocate_registers_linear(func_begin);
+    layout_frame(alloc);
+    alloc->milliseconds = 1000.0 * (clock() - started) / CLOCKS_PER_SEC;
+    return alloc;
+}
+
+void free_register_allocation(RegisterAllocation *alloc) {
+    if (alloc == NULL) return;
+    free_cfg(alloc->cfg);
+    free(alloc->location);
+    free(alloc->spill_slot);
+    free(alloc->live_start);
+    free(alloc->last_use);
+    free(alloc->rematerializable);
+    free(alloc->constant);
+    free(alloc->call_saves);
+    free(alloc->slot_offset);
+    free(alloc->array_names);
+    free(alloc->array_offset);
+    free(alloc);
+}
+
+/* Register holding a value, or -1 if it lives in memory */
+int register_of(RegisterAllocation *alloc, char *name) {
+    int index = variable_index(alloc->cfg->variables, name);
+    return index < 0 ? -1 : (alloc->location[index] >= 0 ? alloc->location[index] : -1);
+}
+
+/* Frame slot of a spilled value, or -1 */
+int spill_slot_of(RegisterAllocation *alloc, char *name) {
+    int index = variable_index(alloc->cfg->variables, name);
+    return index < 0 ? -1 : alloc->spill_slot[index];
+}
+
+/* Check if a value is recomputed at each use instead of living anywhere,
+   and give its constant */
+int rematerialized_constant(RegisterAllocation *alloc, char *name, int *value) {
+    int index = variable_index(alloc->cfg->variables, name);
+    if (index < 0 || alloc->location[index] != LOCATION_REMAT) return 0;
+    *value = alloc->constant[index];
+    return 1;
+}
+
+/* Check if a name is an array declared in this function */
+int is_local_array(RegisterAllocation *alloc, char *name) {
+    if (is_global_name(name)) return 0;
+    int index = variable_index(alloc->cfg->variables, name);
+    return index < 0 || alloc->location[index] == LOCATION_NONE;
+}
+
+/* Byte offset of a local array in the local area, or -1 */
+int local_array_offset(RegisterAllocation *alloc, char *name) {
+    for (int a = 0; a < alloc->array_count; a++) {
+        if (strcmp(alloc->array_names[a], name) == 0) return alloc->array_offset[a];
+    }
+    return -1;
+}
+
+/* One line per function with the allocation results */
+void print_register_allocation(RegisterAllocation *alloc) {
+    int registers = 0;
+    for (int r = 0; r < 32; r++) {
+        if (alloc->used_mask & (1u << r)) registers++;
+    }
+    printf("  %-16s %-6s %5d values, %2d registers, %4d spilled, %3d rematerialized, "
+           "%3d split, %d/%d copies coalesced, %.2f ms",
+           alloc->cfg->func_begin->result, alloc->method, alloc->values,
+           registers, alloc->spilled_values, alloc->rematerialized, alloc->split,
+           alloc->moves_coalesced, alloc->moves, alloc->milliseconds);
+    if (strcmp(alloc->method, "graph") == 0) {
+        printf(", %d edges", alloc->interference_edges);
+    }
+    printf(", %d bytes of locals", alloc->frame_bytes);
+    printf("\n");
+}
@@ -0,0 +1,207 @@
+/*
+ * Instruction Scheduling Implementation
+ * CST-405 Compiler Design
+ *
+ * A list scheduler over each basic block of a function's machine
+ * instructions. The dependences between the block's instructions carry
+ * the latencies of machine_latency for the MIPS32 pipeline: a load's
+ * result is one cycle late, mul's two, div's quotient is only in LO
+ * about 35 cycles later, and a branch compares its registers a stage
+ * early. Ready instructions are issued cycle by cycle, longest latency
+ * path to the end of the block first, so independent work fills the gaps.
+ *
+ * Scheduling runs after register allocation, so it cannot raise the
+ * register pressure: it only reorders within the registers already
+ * assigned, and the anti- and output dependences on them (including the
+ * scratch registers $t8/$t9) keep it correct
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "schedule.h"
+#include "globals.h"
+#include "optimize.h"
+
+/* Scheduler use chosen by -f[no-]schedule */
+ScheduleMode schedule_mode = SCHEDULE_DEFAULT;
+
+/* Extra cycle for a branch reading a register, since branches resolve in
+   the decode stage, before the ALU result is forwarded */
+#define BRANCH_OPERAND_DELAY 1
+
+#define NO_DEPENDENCE -1
+
+/* Statistics over the program */
+static int regions_scheduled = 0;
+static int instructions_moved = 0;
+static int stalls_before = 0;
+static int stalls_after = 0;
+
+/* Address operand of a load or store, or NULL */
+static MachineOperand *memory_operand(MachineInstr *mi) {
+    if (mi->op != MOP_LW && mi->op != MOP_SW) return NULL;
+    return &mi->operand[1];
+}
+
+/* Latency of the dependence of instruction j on an earlier i, or
+   NO_DEPENDENCE */
+static int dependence(MachineInstr *i, MachineInstr *j) {
+    RegisterMask i_defs = machine_defs(i), i_uses = machine_uses(i);
+    RegisterMask j_defs = machine_defs(j), j_uses = machine_uses(j);
+    int latency = NO_DEPENDENCE;
+
+    if (i_defs & j_uses) {
+        latency = machine_latency(i->op);
+        if (is_conditional_branch(j->op) || j->op == MOP_JR) {
+            latency += BRANCH_OPERAND_DELAY;
+        }
+    }
+    if ((i_defs & j_defs) && latency < 1) latency = 1;
+    if ((i_uses & j_defs) && latency < 0) latency = 0;
+
+    MachineOperand *a = memory_operand(i);
+    MachineOperand *b = memory_operand(j);
+    if (a && b && (i->op == MOP_SW || j->op == MOP_SW) && machine_may_alias(a, b)) {
+        int order = i->op == MOP_SW ? 1 : 0;
+        if (latency < order) latency = order;
+    }
+    return latency;
+}
+
+/* Cycle the last instruction of a region issues in, in the given order,
+   less the cycles it would take without stalls */
+static int stall_cycles(int *latency, int n, int *order, int *issue) {
+    for (int k = 0; k < n; k++) {
+        int j = order[k];
+        issue[j] = k == 0 ? 0 : issue[order[k - 1]] + 1;
+        for (int p = 0; p < k; p++) {
+            int i = order[p];
+            int l = latency[i * n + j];
+            if (l != NO_DEPENDENCE && issue[i] + l > issue[j]) issue[j] = issue[i] + l;
+        }
+    }
+    return n > 0 ? issue[order[n - 1]] - (n - 1) : 0;
+}
+
+/* List-schedule instructions first..first+n-1; the last stays last when
+   it transfers control */
+static void schedule_region(MachineFunction *mf, int first, int n) {
+    MachineInstr *code = mf->code + first;
+    int *latency = (int *)malloc(n * n * sizeof(int));
+    int *priority = (int *)calloc(n, sizeof(int));
+    int *waiting = (int *)calloc(n, sizeof(int));
+    int *earliest = (int *)calloc(n, sizeof(int));
+    int *order = (int *)malloc(n * sizeof(int));
+    int *issue = (int *)malloc(n * sizeof(int));
+    int *done = (int *)calloc(n, sizeof(int));
+    int terminator = is_control_transfer(code[n - 1].op);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            int l = j > i ? dependence(&code[i], &code[j]) : NO_DEPENDENCE;
+            if (j == n - 1 && terminator && j > i && l == NO_DEPENDENCE) l = 0;
+            latency[i * n + j] = l;
+            if (l != NO_DEPENDENCE) waiting[j]++;
+        }
+    }
+
+    /* Priority: the longest latency path from an instruction to the end */
+    for (int i = n - 1; i >= 0; i--) {
+        for (int j = i + 1; j < n; j++) {
+            int l = latency[i * n + j];
+            if (l != NO_DEPENDENCE && l + priority[j] > priority[i]) priority[i] = l + priority[j];
+        }
+    }
+
+    for (int k = 0; k < n; k++) order[k] = k;
+    int before = stall_cycles(latency, n, order, issue);
+
+    int cycle = 0;
+    for (int k = 0; k < n; ) {
+        int best = -1;
+        int soonest = -1;
+        for (int j = 0; j < n; j++) {
+            if (done[j] || waiting[j] > 0) continue;
+            if (earliest[j] <= cycle) {
+                if (best < 0 || priority[j] > priority[best]) best = j;
+            } else if (soonest < 0 || earliest[j] < earliest[soonest]) {
+                soonest = j;
+            }
+        }
+        if (best < 0) {
+            cycle = earliest[soonest];     /* Nothing is ready: stall */
+            continue;
+        }
+        done[best] = 1;
+        order[k++] = best;
+        for (int j = 0; j < n; j++) {
+            int l = latency[best * n + j];
+            if (l == NO_DEPENDENCE) continue;
+            waiting[j]--;
+            if (cycle + l > earliest[j]) earliest[j] = cycle + l;
+        }
+        cycle++;
+    }
+
+    int after = stall_cycles(latency, n, order, issue);
+    if (after < before) {
+        MachineInstr *scheduled = (MachineInstr *)malloc(n * sizeof(MachineInstr));
+        for (int k = 0; k < n; k++) {
+            scheduled[k] = code[order[k]];
+            if (order[k] != k) instructions_moved++;
+        }
+        memcpy(code, scheduled, n * sizeof(MachineInstr));
+        free(scheduled);
+    } else {
+        after = before;            /* Keep the original order */
+    }
+    regions_scheduled++;
+    stalls_before += before;
+    stalls_after += after;
+
+    free(latency);
+    free(priority);
+    free(waiting);
+    free(earliest);
+    free(order);
+    free(issue);
+    free(done);
+}
+
+/* Check if the scheduler runs at this optimization level */
+int scheduling_enabled(void) {
+    if (schedule_mode == SCHEDULE_DEFAULT) {
+        return optimization_level >= OPT_AGGRESSIVE;
+    }
+    return schedule_mode == SCHEDULE_ON;
+}
+
+/* Schedule each basic block of a function: the runs of instructions
+   between labels (and comments), ending at a jump, branch or call */
+void schedule_function(MachineFunction *mf) {
+    int first = 0;
+
+    while (first < mf->count) {
+        if (!is_machine_instruction(&mf->code[first])) {
+            first++;
+            continue;
+        }
+        int n = 0;
+        while (first + n < mf->count && n < SCHEDULE_REGION_LIMIT &&
+               is_machine_instruction(&mf->code[first + n])) {
+            n++;
+            if (is_control_transfer(mf->code[first + n - 1].op)) break;
+        }
+        if (n > 1) schedule_region(mf, first, n);
+        first += n;
+    }
+}
+
+/* Print the regions scheduled, the instructions moved and the stall
+   cycles the latency model predicts before and after */
+void print_schedule_statistics(void) {
+    printf("Instruction scheduling: %d blocks, %d instructions moved, "
+           "estimated stall cycles %d -> %d\n",
+           regions_scheduled, instructions_moved, stalls_before, stalls_after);
+}
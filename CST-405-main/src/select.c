@@ -0,0 +1,1039 @@
+/*
+ * Tree-Pattern Instruction Selection Implementation
+ * CST-405 Compiler Design
+ *
+ * BURS-style selection: each basic block's TAC becomes an expression
+ * DAG, a bottom-up pass labels every node with the cheapest rule of the
+ * tree grammar for each nonterminal, and the reducer emits the chosen
+ * tiles in TAC order. A single-use temporary whose definition sits
+ * right before its user can be covered by the user's tile, so address
+ * arithmetic folds into lw/sw offsets and comparisons into branches
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "select.h"
+#include "mips.h"
+#include "cfg.h"
+#include "optimize.h"
+#include "globals.h"
+
+/* Selector chosen by -fselect= */
+InstructionSelectorKind instruction_selector = SELECT_DEFAULT;
+
+#define TILE_INFINITY   1000000
+#define OP_LEAF         -1          /* Operand defined outside the block */
+#define MAX_TILE_LEAVES 4
+#define MAX_TILE_OPS    4
+
+/* Nonterminals of the tree grammar */
+typedef enum {
+    NT_STMT,                   /* Side effect only */
+    NT_REG,                    /* Value in a register */
+    NT_VAL,                    /* Value computed straight into the destination */
+    NT_CON,                    /* Any constant */
+    NT_ZERO,                   /* The constant 0 */
+    NT_IMM,                    /* Constant fitting a signed 16-bit immediate */
+    NT_IMM1,                   /* Constant c with c+1 fitting one */
+    NT_NIMM,                   /* Constant c with -c fitting one */
+    NT_UIMM,                   /* Constant fitting an unsigned 16-bit immediate */
+    NT_POW2,                   /* Power of two up to 2^16 */
+    NT_MULC,                   /* Multiplier worth a shift-and-add sequence */
+    NT_DIVC,                   /* Divisor other than 0 */
+    NT_DISP,                   /* Array index c with 4c fitting an offset */
+    NT_NDISP,                  /* Array index c with -4c fitting an offset */
+    NT_INDEX,                  /* Element offset in $t9 plus a displacement */
+    NT_GARR,                   /* Global array */
+    NT_LARR,                   /* Array in the frame */
+    NT_COUNT
+} Nonterminal;
+
+static const char *nonterminal_names[NT_COUNT] = {
+    "stmt", "reg", "val", "con", "zero", "imm", "imm1", "nimm", "uimm",
+    "pow2", "mulc", "divc", "disp", "ndisp", "index", "garr", "larr"
+};
+
+/* Operators of the tree grammar: TAC opcodes, with IF_TRUE and IF_FALSE
+   both BRANCH (the node records which) */
+static const struct {
+    const char *name;
+    int opcode;
+} operator_names[] = {
+    {"ADD", TAC_ADD}, {"SUB", TAC_SUB}, {"MUL", TAC_MUL}, {"DIV", TAC_DIV},
+    {"NEG", TAC_NEG}, {"LT", TAC_LT}, {"LTE", TAC_LTE}, {"GT", TAC_GT},
+    {"GTE", TAC_GTE}, {"EQ", TAC_EQ}, {"NEQ", TAC_NEQ}, {"ASSIGN", TAC_ASSIGN},
+    {"ALOAD", TAC_ARRAY_LOAD}, {"ASTORE", TAC_ARRAY_STORE}, {"BRANCH", TAC_IF_TRUE},
+    {NULL, 0}
+};
+
+/* Parsed rule pattern */
+typedef struct Pattern {
+    int op;                    /* Operator, or OP_LEAF for a nonterminal */
+    Nonterminal nt;
+    struct Pattern *kids[3];
+    int kid_count;
+} Pattern;
+
+struct TileRule;
+
+/* DAG node: a tiled TAC instruction, or an operand from outside the block */
+struct TileNode {
+    int op;                    /* Operator, or OP_LEAF */
+    TACInstruction *instr;     /* NULL for operands */
+    char *name;                /* Operand, or the instruction's result */
+    int constant;              /* Holds a known constant... */
+    int value;                 /* ...this one */
+    int taken_if_true;         /* BRANCH: IF_TRUE rather than IF_FALSE */
+    TileNode *kids[3];
+    int kid_count;
+    int position;              /* Index of the instruction in the function */
+    int foldable;              /* Single-use temporary: a tile may cover it */
+    int covered;               /* Emitted inside another node's tile */
+    int embedded;              /* Root whose cost a user's tile already counts */
+    int cost[NT_COUNT];
+    struct TileRule *rule[NT_COUNT];
+    int cover_count[NT_COUNT]; /* Instructions the chosen tiling covers below it */
+    int cover_min[NT_COUNT];   /* Position of the first of them */
+};
+
+/* Operand of a tile: a node reduced to a nonterminal */
+typedef struct {
+    TileNode *node;
+    Nonterminal nt;
+    int inline_node;           /* Reduce the node here, else read its register */
+    struct TileRule *chain;    /* Applied to the register when not inline */
+} TileLeaf;
+
+/* What a reduction produces */
+typedef struct {
+    MIPSRegister reg;
+    int value;                 /* Constant, or displacement */
+    const char *label;         /* Global array */
+} TileValue;
+
+typedef TileValue (*TileAction)(TileNode *node, TileLeaf *leaves, MIPSRegister dest);
+
+/* Rule: lhs <- pattern at the given cost in instructions. A pattern that
+   is a lone nonterminal is a chain rule */
+typedef struct TileRule {
+    Nonterminal lhs;
+    const char *pattern;
+    int cost;
+    TileAction action;
+    Pattern *tree;
+} TileRule;
+
+/* A match of a rule at a node */
+typedef struct {
+    TileLeaf leaves[MAX_TILE_LEAVES];
+    int leaf_count;
+    TileNode *interior[MAX_TILE_OPS];
+    int interior_count;
+    int cost;
+    int cover_count;
+    int cover_min;
+} TileMatch;
+
+static Selection *current_selection = NULL;
+
+static TileValue tile_operand(TileLeaf *leaf, MIPSRegister scratch);
+static TileValue reduce(TileNode *node, Nonterminal nt, MIPSRegister dest);
+
+/* ---- Tile actions ---- */
+
+static TileValue in_register(MIPSRegister reg) {
+    TileValue v = {reg, 0, NULL};
+    return v;
+}
+
+static int log2_of(int value) {
+    int shift = 0;
+    while ((1 << shift) < value) shift++;
+    return shift;
+}
+
+/* reg: imm | uimm | con */
+static TileValue tile_constant(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    load_constant(dest, tile_operand(&leaves[0], dest).value);
+    return in_register(dest);
+}
+
+/* val: reg, and reg: ASSIGN(reg | val) */
+static TileValue tile_copy(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    return tile_operand(&leaves[0], dest);
+}
+
+/* reg: OP(reg,reg) */
+static TileValue tile_binary(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    MIPSRegister b = tile_operand(&leaves[1], REG_T9).reg;
+
+    switch (node->op) {
+        case TAC_ADD: emit_rrr(MOP_ADD, dest, a, b); break;
+        case TAC_SUB: emit_rrr(MOP_SUB, dest, a, b); break;
+        case TAC_MUL: emit_rrr(MOP_MUL, dest, a, b); break;
+        case TAC_LT:  emit_rrr(MOP_SLT, dest, a, b); break;
+        case TAC_GT:  emit_rrr(MOP_SLT, dest, b, a); break;
+        case TAC_DIV:
+            emit_rr(MOP_DIV, a, b);
+            emit_instruction(MOP_MFLO, machine_reg(dest), NO_OPERAND, NO_OPERAND);
+            break;
+        case TAC_LTE:
+            emit_rrr(MOP_SLT, dest, b, a);
+            emit_rri(MOP_XORI, dest, dest, 1);
+            break;
+        case TAC_GTE:
+            emit_rrr(MOP_SLT, dest, a, b);
+            emit_rri(MOP_XORI, dest, dest, 1);
+            break;
+        case TAC_EQ:
+            emit_rrr(MOP_XOR, dest, a, b);
+            emit_rri(MOP_SLTIU, dest, dest, 1);
+            break;
+        case TAC_NEQ:
+            emit_rrr(MOP_XOR, dest, a, b);
+            emit_rrr(MOP_SLTU, dest, REG_ZERO, dest);
+            break;
+        default:
+            break;
+    }
+    return in_register(dest);
+}
+
+/* reg: NEG(reg) */
+static TileValue tile_negate(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    emit_rrr(MOP_SUB, dest, REG_ZERO, a);
+    return in_register(dest);
+}
+
+/* reg: ADD(reg,imm) | SUB(reg,nimm) */
+static TileValue tile_add_immediate(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    emit_rri(MOP_ADDI, dest, a, node->op == TAC_SUB ? -c : c);
+    return in_register(dest);
+}
+
+/* reg: MUL(reg,pow2) */
+static TileValue tile_shift(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    emit_rri(MOP_SLL, dest, a, log2_of(c));
+    return in_register(dest);
+}
+
+/* reg: MUL(reg,mulc) */
+static TileValue tile_multiply_constant(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    gen_multiply_constant(dest, a, c);
+    return in_register(dest);
+}
+
+/* reg: DIV(reg,divc) */
+static TileValue tile_divide_constant(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    gen_divide_constant(dest, a, c);
+    return in_register(dest);
+}
+
+/* reg: ADD(MUL(reg,pow2),reg) */
+static TileValue tile_shift_add(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T9).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    emit_rri(MOP_SLL, REG_T9, a, log2_of(c));
+    MIPSRegister b = tile_operand(&leaves[2], REG_T8).reg;
+    emit_rrr(MOP_ADD, dest, REG_T9, b);
+    return in_register(dest);
+}
+
+/* reg: CMP(reg, constant) */
+static TileValue tile_compare_immediate(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    gen_comparison_immediate(node->op, dest, a, c);
+    return in_register(dest);
+}
+
+/* index: reg */
+static TileValue tile_scale(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister i = tile_operand(&leaves[0], REG_T9).reg;
+    emit_rri(MOP_SLL, REG_T9, i, 2);
+    return in_register(REG_T9);
+}
+
+/* index: ADD(reg,disp) | SUB(reg,ndisp) | MUL(reg,pow2) */
+static TileValue tile_scale_folded(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister i = tile_operand(&leaves[0], REG_T9).reg;
+    int c = tile_operand(&leaves[1], REG_T9).value;
+    TileValue v = in_register(REG_T9);
+
+    if (node->op == TAC_MUL) {
+        emit_rri(MOP_SLL, REG_T9, i, log2_of(c) + 2);
+    } else {
+        emit_rri(MOP_SLL, REG_T9, i, 2);
+        v.value = node->op == TAC_SUB ? -4 * c : 4 * c;
+    }
+    return v;
+}
+
+/* Address operand of an element: the index (in $t9 plus a displacement,
+   or a constant) is evaluated first, then the array's base */
+static MachineOperand element_address(TileLeaf *array, TileLeaf *index, MIPSRegister base_scratch) {
+    TileValue i = tile_operand(index, REG_T9);
+    int indexed = index->nt != NT_DISP;
+    int displacement = indexed ? i.value : 4 * i.value;
+
+    if (array->nt == NT_GARR) {
+        const char *label = tile_operand(array, REG_T8).label;
+        return machine_symbol_mem(label, displacement, indexed ? REG_T9 : -1);
+    } else if (array->nt == NT_LARR) {
+        TileValue frame = tile_operand(array, REG_T8);
+        if (indexed) {
+            emit_rrr(MOP_ADD, REG_T9, REG_T9, frame.reg);
+            return machine_mem(frame.value + displacement, REG_T9);
+        }
+        return machine_mem(frame.value + displacement, frame.reg);
+    } else if (indexed) {
+        MIPSRegister base = tile_operand(array, REG_T8).reg;
+        emit_rrr(MOP_ADD, REG_T9, REG_T9, base);
+        return machine_mem(displacement, REG_T9);
+    }
+    MIPSRegister base = tile_operand(array, base_scratch).reg;
+    return machine_mem(displacement, base);
+}
+
+/* reg: ALOAD(array, index | disp) */
+static TileValue tile_load(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MachineOperand address = element_address(&leaves[0], &leaves[1], REG_T9);
+    emit_memory(MOP_LW, dest, address);
+    return in_register(dest);
+}
+
+/* stmt: ASTORE(array, index | disp, reg) */
+static TileValue tile_store(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MachineOperand address = element_address(&leaves[0], &leaves[1], REG_T9);
+    MIPSRegister value = tile_operand(&leaves[2], REG_T8).reg;
+    emit_memory(MOP_SW, value, address);
+    return in_register(REG_ZERO);
+}
+
+/* stmt: BRANCH(reg) */
+static TileValue tile_branch(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister c = tile_operand(&leaves[0], REG_T8).reg;
+    emit_branch(node->taken_if_true ? MOP_BNEZ : MOP_BEQZ, c, machine_label(node->instr->label));
+    return in_register(REG_ZERO);
+}
+
+/* stmt: BRANCH(EQ(reg,reg)) | BRANCH(NEQ(reg,reg)) */
+static TileValue tile_branch_equal(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    MIPSRegister b = tile_operand(&leaves[1], REG_T9).reg;
+    int equal = (node->kids[0]->op == TAC_EQ) == node->taken_if_true;
+    emit_branch_equal(equal ? MOP_BEQ : MOP_BNE, a, b, machine_label(node->instr->label));
+    return in_register(REG_ZERO);
+}
+
+/* stmt: BRANCH(CMP(reg,zero)): one compare-with-zero branch */
+static TileValue tile_branch_zero(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    static const MachineOpcode taken[][2] = {
+        /* condition false, true */
+        {MOP_BGEZ, MOP_BLTZ},  /* x < 0 */
+        {MOP_BGTZ, MOP_BLEZ},  /* x <= 0 */
+        {MOP_BLEZ, MOP_BGTZ},  /* x > 0 */
+        {MOP_BLTZ, MOP_BGEZ}   /* x >= 0 */
+    };
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+    int row = node->kids[0]->op - TAC_LT;
+    emit_branch(taken[row][node->taken_if_true], a, machine_label(node->instr->label));
+    return in_register(REG_ZERO);
+}
+
+/* stmt: BRANCH(CMP(reg,reg)) | BRANCH(CMP(reg,imm)): slt or slti into
+   $t9, then branch on it (x <= y is !(y < x), x > c is !(x < c+1)) */
+static TileValue tile_branch_compare(TileNode *node, TileLeaf *leaves, MIPSRegister dest) {
+    int op = node->kids[0]->op;
+    int negated = op == TAC_LTE || op == TAC_GTE;
+    MIPSRegister a = tile_operand(&leaves[0], REG_T8).reg;
+
+    if (leaves[1].nt == NT_REG) {
+        MIPSRegister b = tile_operand(&leaves[1], REG_T9).reg;
+        int swap = op == TAC_GT || op == TAC_LTE;
+        emit_rrr(MOP_SLT, REG_T9, swap ? b : a, swap ? a : b);
+    } else {
+        int c = tile_operand(&leaves[1], REG_T9).value;
+        negated = op == TAC_GT || op == TAC_GTE;
+        emit_rri(MOP_SLTI, REG_T9, a, op == TAC_LTE || op == TAC_GT ? c + 1 : c);
+    }
+    emit_branch(negated == node->taken_if_true ? MOP_BEQZ : MOP_BNEZ, REG_T9,
+                machine_label(node->instr->label));
+    return in_register(REG_ZERO);
+}
+
+/* ---- Rule table ---- */
+
+static TileRule tile_rules[] = {
+    /* Constants */
+    {NT_REG,   "imm",                    1, tile_constant},
+    {NT_REG,   "uimm",                   1, tile_constant},
+    {NT_REG,   "con",                    2, tile_constant},       /* lui, ori */
+    {NT_VAL,   "reg",                    0, tile_copy},
+
+    /* Arithmetic */
+    {NT_REG,   "ADD(reg,reg)",           1, tile_binary},
+    {NT_REG,   "ADD(reg,imm)",           1, tile_add_immediate},
+    {NT_REG,   "ADD(MUL(reg,pow2),reg)", 2, tile_shift_add},
+    {NT_REG,   "SUB(reg,reg)",           1, tile_binary},
+    {NT_REG,   "SUB(reg,nimm)",          1, tile_add_immediate},
+    {NT_REG,   "MUL(reg,reg)",           1, tile_binary},
+    {NT_REG,   "MUL(reg,pow2)",          1, tile_shift},
+    {NT_REG,   "MUL(reg,mulc)",          1, tile_multiply_constant},
+    {NT_REG,   "DIV(reg,reg)",           2, tile_binary},
+    {NT_REG,   "DIV(reg,divc)",          1, tile_divide_constant},
+    {NT_REG,   "NEG(reg)",               1, tile_negate},
+
+    /* Comparisons */
+    {NT_REG,   "LT(reg,reg)",            1, tile_binary},
+    {NT_REG,   "GT(reg,reg)",            1, tile_binary},
+    {NT_REG,   "LTE(reg,reg)",           2, tile_binary},
+    {NT_REG,   "GTE(reg,reg)",           2, tile_binary},
+    {NT_REG,   "EQ(reg,reg)",            2, tile_binary},
+    {NT_REG,   "NEQ(reg,reg)",           2, tile_binary},
+    {NT_REG,   "LT(reg,imm)",            1, tile_compare_immediate},
+    {NT_REG,   "GTE(reg,imm)",           2, tile_compare_immediate},
+    {NT_REG,   "LTE(reg,imm1)",          1, tile_compare_immediate},
+    {NT_REG,   "GT(reg,imm1)",           2, tile_compare_immediate},
+    {NT_REG,   "EQ(reg,zero)",           1, tile_compare_immediate},
+    {NT_REG,   "EQ(reg,uimm)",           2, tile_compare_immediate},
+    {NT_REG,   "EQ(reg,nimm)",           2, tile_compare_immediate},
+    {NT_REG,   "NEQ(reg,zero)",          1, tile_compare_immediate},
+    {NT_REG,   "NEQ(reg,uimm)",          2, tile_compare_immediate},
+    {NT_REG,   "NEQ(reg,nimm)",          2, tile_compare_immediate},
+
+    /* Copies */
+    {NT_REG,   "ASSIGN(reg)",            1, tile_copy},
+    {NT_REG,   "ASSIGN(val)",            0, tile_copy},
+
+    /* Array elements: the scaled index goes to $t9 and constant parts
+       of it into the offset */
+    {NT_INDEX, "reg",                    1, tile_scale},
+    {NT_INDEX, "ADD(reg,disp)",          1, tile_scale_folded},
+    {NT_INDEX, "SUB(reg,ndisp)",         1, tile_scale_folded},
+    {NT_INDEX, "MUL(reg,pow2)",          1, tile_scale_folded},
+    {NT_REG,   "ALOAD(garr,index)",      1, tile_load},
+    {NT_REG,   "ALOAD(garr,disp)",       1, tile_load},
+    {NT_REG,   "ALOAD(larr,index)",      2, tile_load},
+    {NT_REG,   "ALOAD(larr,disp)",       1, tile_load},
+    {NT_REG,   "ALOAD(reg,index)",       2, tile_load},
+    {NT_REG,   "ALOAD(reg,disp)",        1, tile_load},
+    {NT_STMT,  "ASTORE(garr,index,reg)", 1, tile_store},
+    {NT_STMT,  "ASTORE(garr,disp,reg)",  1, tile_store},
+    {NT_STMT,  "ASTORE(larr,index,reg)", 2, tile_store},
+    {NT_STMT,  "ASTORE(larr,disp,reg)",  1, tile_store},
+    {NT_STMT,  "ASTORE(reg,index,reg)",  2, tile_store},
+    {NT_STMT,  "ASTORE(reg,disp,reg)",   1, tile_store},
+
+    /* Branches: the comparison folds into the branch */
+    {NT_STMT,  "BRANCH(reg)",            1, tile_branch},
+    {NT_STMT,  "BRANCH(EQ(reg,reg))",    1, tile_branch_equal},
+    {NT_STMT,  "BRANCH(NEQ(reg,reg))",   1, tile_branch_equal},
+    {NT_STMT,  "BRANCH(LT(reg,zero))",   1, tile_branch_zero},
+    {NT_STMT,  "BRANCH(LTE(reg,zero))",  1, tile_branch_zero},
+    {NT_STMT,  "BRANCH(GT(reg,zero))",   1, tile_branch_zero},
+    {NT_STMT,  "BRANCH(GTE(reg,zero))",  1, tile_branch_zero},
+    {NT_STMT,  "BRANCH(LT(reg,reg))",    2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(LTE(reg,reg))",   2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(GT(reg,reg))",    2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(GTE(reg,reg))",   2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(LT(reg,imm))",    2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(GTE(reg,imm))",   2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(LTE(reg,imm1))",  2, tile_branch_compare},
+    {NT_STMT,  "BRANCH(GT(reg,imm1))",   2, tile_branch_compare},
+};
+
+#define TILE_RULE_COUNT ((int)(sizeof(tile_rules) / sizeof(tile_rules[0])))
+
+/* Parse one pattern, e.g. "ALOAD(garr,ADD(reg,disp))" */
+static Pattern *parse_pattern(const char **text) {
+    Pattern *p = (Pattern *)calloc(1, sizeof(Pattern));
+    const char *start = *text;
+    size_t length = strcspn(start, "(,)");
+    *text += length;
+
+    for (int i = 0; operator_names[i].name; i++) {
+        if (strlen(operator_names[i].name) == length &&
+            strncmp(operator_names[i].name, start, length) == 0) {
+            p->op = operator_names[i].opcode;
+            (*text)++;                              /* ( */
+            while (p->kid_count < 3) {
+                p->kids[p->kid_count++] = parse_pattern(text);
+                if (*(*text)++ == ')') break;       /* , or ) */
+            }
+            return p;
+        }
+    }
+
+    p->op = OP_LEAF;
+    for (int nt = 0; nt < NT_COUNT; nt++) {
+        if (strlen(nonterminal_names[nt]) == length &&
+            strncmp(nonterminal_names[nt], start, length) == 0) {
+            p->nt = nt;
+            return p;
+        }
+    }
+    fprintf(stderr, "Internal error: bad tile pattern at '%s'\n", start);
+    exit(1);
+}
+
+/* Parse the rule table once */
+static void init_tile_rules(void) {
+    if (tile_rules[0].tree) return;
+    for (int r = 0; r < TILE_RULE_COUNT; r++) {
+        const char *text = tile_rules[r].pattern;
+        tile_rules[r].tree = parse_pattern(&text);
+    }
+}
+
+static int is_chain_rule(TileRule *rule) {
+    return rule->tree->op == OP_LEAF;
+}
+
+/* Chain rule lhs <- reg, if there is one */
+static TileRule *chain_from_register(Nonterminal lhs) {
+    for (int r = 0; r < TILE_RULE_COUNT; r++) {
+        TileRule *rule = &tile_rules[r];
+        if (rule->lhs == lhs && is_chain_rule(rule) && rule->tree->nt == NT_REG) return rule;
+    }
+    return NULL;
+}
+
+/* ---- DAG construction ---- */
+
+static TileNode *new_node(Selection *sel, int op) {
+    TileNode *node = (TileNode *)calloc(1, sizeof(TileNode));
+    node->op = op;
+    if (sel->node_count == sel->node_capacity) {
+        sel->node_capacity = sel->node_capacity ? sel->node_capacity * 2 : 64;
+        sel->nodes = (TileNode **)realloc(sel->nodes, sel->node_capacity * sizeof(TileNode *));
+    }
+    sel->nodes[sel->node_count++] = node;
+    return node;
+}
+
+static int is_constant_node(TileNode *node) {
+    return node->constant;
+}
+
+/* Operand node: the in-block instruction that last defined it, or a leaf */
+static TileNode *operand_node(Selection *sel, char *operand, TileNode **last_def,
+                              int *def_block, int block) {
+    int value;
+
+    if (operand_constant(operand, &value)) {
+        TileNode *leaf = new_node(sel, OP_LEAF);
+        leaf->name = operand;
+        leaf->constant = 1;
+        leaf->value = value;
+        return leaf;
+    }
+    int v = variable_index(sel->alloc->cfg->variables, operand);
+    if (v >= 0 && def_block[v] == block && last_def[v]) {
+        return last_def[v];
+    }
+    TileNode *leaf = new_node(sel, OP_LEAF);
+    leaf->name = operand;
+    return leaf;
+}
+
+/* Check if the TAC instruction is covered by the tree grammar */
+static int is_tiled(TACInstruction *instr) {
+    switch (instr->opcode) {
+        case TAC_ADD: case TAC_SUB: case TAC_MUL: case TAC_DIV: case TAC_NEG:
+        case TAC_LT: case TAC_LTE: case TAC_GT: case TAC_GTE: case TAC_EQ: case TAC_NEQ:
+        case TAC_ASSIGN: case TAC_LOAD_CONST: case TAC_ARRAY_LOAD: case TAC_ARRAY_STORE:
+        case TAC_IF_TRUE: case TAC_IF_FALSE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Put constants on the right of commutative operations and comparisons,
+   and a multiplication on the left of an addition, so the grammar needs
+   one pattern for each */
+static void canonicalize(TileNode *node) {
+    if (node->kid_count != 2) return;
+    TileNode *a = node->kids[0];
+    TileNode *b = node->kids[1];
+    int swap = 0;
+
+    switch (node->op) {
+        case TAC_ADD:
+            swap = (is_constant_node(a) && !is_constant_node(b)) ||
+                   (b->op == TAC_MUL && a->op != TAC_MUL && !is_constant_node(b));
+            break;
+        case TAC_MUL: case TAC_EQ: case TAC_NEQ:
+        case TAC_LT: case TAC_LTE: case TAC_GT: case TAC_GTE:
+            swap = is_constant_node(a) && !is_constant_node(b);
+            break;
+        default:
+            break;
+    }
+    if (swap) {
+        node->kids[0] = b;
+        node->kids[1] = a;
+        node->op = mirror_comparison(node->op);
+    }
+}
+
+/* Count the definitions and uses of each variable in the function */
+static void count_references(Selection *sel, TACInstruction *func_begin, int *defs, int *uses) {
+    VariableTable *vars = sel->alloc->cfg->variables;
+
+    for (TACInstruction *instr = func_begin->next; instr && instr->opcode != TAC_FUNC_END;
+         instr = instr->next) {
+        if (defines_result(instr)) {
+            int v = variable_index(vars, instr->result);
+            if (v >= 0) defs[v]++;
+        }
+        if (instr->opcode == TAC_CALL || instr->opcode == TAC_LABEL ||
+            instr->opcode == TAC_GOTO) {
+            continue;
+        }
+        int a = variable_index(vars, instr->arg1);
+        int b = variable_index(vars, instr->arg2);
+        if (a >= 0) uses[a]++;
+        if (b >= 0) uses[b]++;
+        if (uses_result(instr)) {
+            int r = variable_index(vars, instr->result);
+            if (r >= 0) uses[r]++;
+        }
+    }
+}
+
+/* Build the DAGs of every block of the function */
+static void build_dags(Selection *sel, TACInstruction *func_begin) {
+    VariableTable *vars = sel->alloc->cfg->variables;
+    TileNode **last_def = (TileNode **)calloc(vars->count + 1, sizeof(TileNode *));
+    int *def_block = (int *)calloc(vars->count + 1, sizeof(int));
+    int *defs = (int *)calloc(vars->count + 1, sizeof(int));
+    int *uses = (int *)calloc(vars->count + 1, sizeof(int));
+    int block = 1;
+    int position = 0;
+
+    count_references(sel, func_begin, defs, uses);
+
+    for (TACInstruction *instr = func_begin->next; instr && instr->opcode != TAC_FUNC_END;
+         instr = instr->next, position++) {
+        if (instr->opcode == TAC_LABEL) block++;
+
+        TileNode *node = NULL;
+        if (is_tiled(instr)) {
+            char *operands[3];
+            TileNode *kids[3];
+            int count = 0;
+            switch (instr->opcode) {
+                case TAC_LOAD_CONST:
+                    break;
+                case TAC_ARRAY_STORE:
+                    operands[count++] = instr->result;
+                    operands[count++] = instr->arg1;
+                    operands[count++] = instr->arg2;
+                    break;
+                case TAC_IF_TRUE: case TAC_IF_FALSE:
+                    operands[count++] = instr->result;
+                    break;
+                default:
+                    operands[count++] = instr->arg1;
+                    if (instr->arg2) operands[count++] = instr->arg2;
+                    break;
+            }
+            /* Kids first, so nodes are numbered bottom-up */
+            for (int k = 0; k < count; k++) {
+                kids[k] = operand_node(sel, operands[k], last_def, def_block, block);
+            }
+
+            int op = instr->opcode == TAC_IF_FALSE ? TAC_IF_TRUE : instr->opcode;
+            node = new_node(sel, op);
+            node->instr = instr;
+            node->name = instr->result;
+            node->position = position;
+            node->taken_if_true = instr->opcode == TAC_IF_TRUE;
+            if (instr->opcode == TAC_LOAD_CONST) {
+                node->constant = 1;
+                node->value = atoi(instr->arg1);
+            }
+            for (int k = 0; k < count; k++) {
+                node->kids[k] = kids[k];
+            }
+            node->kid_count = count;
+            canonicalize(node);
+
+            int v = defines_result(instr) ? variable_index(vars, instr->result) : -1;
+            node->foldable = v >= 0 && is_temporary(instr->result) && defs[v] == 1 && uses[v] == 1;
+
+            sel->operations = (TileNode **)realloc(sel->operations,
+                                                   (sel->operation_count + 1) * sizeof(TileNode *));
+            sel->operations[sel->operation_count++] = node;
+        }
+
+        if (defines_result(instr)) {
+            int v = variable_index(vars, instr->result);
+            if (v >= 0) {
+                last_def[v] = node;
+                def_block[v] = block;
+            }
+        }
+        if (ends_block(instr)) block++;
+    }
+
+    free(last_def);
+    free(def_block);
+    free(defs);
+    free(uses);
+}
+
+/* ---- Labeling ---- */
+
+/* Match a pattern against the DAG below node, gathering the leaves and
+   the instructions the tile covers */
+static int match_pattern(Pattern *p, TileNode *node, int top, int fold, int fold_leaves,
+                         TileMatch *m) {
+    if (p->op == OP_LEAF) {
+        TileLeaf *leaf = &m->leaves[m->leaf_count++];
+        Nonterminal nt = p->nt;
+        int cost;
+
+        leaf->node = node;
+        leaf->nt = nt;
+        leaf->inline_node = 1;
+        leaf->chain = NULL;
+
+        if (node->instr == NULL) {
+            cost = node->cost[nt];
+        } else {
+            /* Read the node's own register: when it is used only here,
+               this tile pays for computing it */
+            int root = fold && node->foldable ? node->cost[NT_REG] : 0;
+            cost = TILE_INFINITY;
+            if (nt == NT_REG) {
+                cost = root;
+                leaf->inline_node = 0;
+            } else if (nt != NT_VAL && (leaf->chain = chain_from_register(nt)) != NULL) {
+                cost = root + leaf->chain->cost;
+                leaf->inline_node = 0;
+            }
+            /* Or cover it, and emit it as part of this tile */
+            if (fold && fold_leaves && node->foldable && nt != NT_REG &&
+                node->cost[nt] <= cost) {
+                cost = node->cost[nt];
+                leaf->inline_node = 1;
+                leaf->chain = NULL;
+                m->cover_count += 1 + node->cover_count[nt];
+                if (node->cover_min[nt] < m->cover_min) m->cover_min = node->cover_min[nt];
+                if (node->position < m->cover_min) m->cover_min = node->position;
+            }
+        }
+        if (cost >= TILE_INFINITY) return 0;
+        m->cost += cost;
+        return 1;
+    }
+
+    if (node->instr == NULL || node->op != p->op || node->kid_count != p->kid_count) return 0;
+    if (!top) {
+        if (!fold || !node->foldable) return 0;
+        m->interior[m->interior_count++] = node;
+        m->cover_count++;
+        if (node->position < m->cover_min) m->cover_min = node->position;
+    }
+    for (int k = 0; k < p->kid_count; k++) {
+        if (!match_pattern(p->kids[k], node->kids[k], 0, fold, fold_leaves, m)) return 0;
+    }
+    return 1;
+}
+
+/* Match a rule at a node; covered instructions must be exactly the ones
+   between the first of them and the node, so the operands they read are
+   still live when the tile is emitted */
+static int match_rule(TileRule *rule, TileNode *node, int fold, TileMatch *m) {
+    for (int fold_leaves = 1; fold_leaves >= 0; fold_leaves--) {
+        memset(m, 0, sizeof(*m));
+        m->cost = rule->cost;
+        m->cover_min = node->position;
+        if (!match_pattern(rule->tree, node, 1, fold, fold_leaves, m)) continue;
+        if (m->cover_count == 0 || node->position - m->cover_min == m->cover_count) return 1;
+    }
+    return 0;
+}
+
+/* Base costs of an operand, or of a constant */
+static void label_leaf(Selection *sel, TileNode *node) {
+    if (node->constant) {
+        long c = node->value;
+        node->cost[NT_CON] = 0;
+        if (c == 0) node->cost[NT_ZERO] = 0;
+        if (fits_immediate(c)) node->cost[NT_IMM] = 0;
+        if (fits_immediate(c + 1)) node->cost[NT_IMM1] = 0;
+        if (fits_immediate(-c)) node->cost[NT_NIMM] = 0;
+        if (fits_unsigned_immediate(c)) node->cost[NT_UIMM] = 0;
+        if (c >= 1 && c <= 65536 && (c & (c - 1)) == 0) node->cost[NT_POW2] = 0;
+        /* Multiplier and divisor sequences are weighed against mul and
+           div by latency, so they cost nothing more here whatever their
+           length */
+        if (multiply_sequence_length((int)c) > 0) node->cost[NT_MULC] = 0;
+        if (c != 0) node->cost[NT_DIVC] = 0;
+        if (fits_immediate(4 * c)) node->cost[NT_DISP] = 0;
+        if (fits_immediate(-4 * c)) node->cost[NT_NDISP] = 0;
+        if (node->instr == NULL) {
+            /* Read through use_register: $zero, li, or lui and ori */
+            node->cost[NT_REG] = c == 0 ? 0 :
+                                 fits_immediate(c) || fits_unsigned_immediate(c) ? 1 : 2;
+        }
+    } else if (is_local_array(sel->alloc, node->name)) {
+        node->cost[NT_LARR] = 0;
+        node->cost[NT_REG] = 1;
+    } else if (is_global_var(node->name)) {
+        SymbolEntry *symbol = lookup_symbol_in_scope(node->name, global_scope);
+        if (symbol && symbol->kind == SYMBOL_ARRAY) node->cost[NT_GARR] = 0;
+        node->cost[NT_REG] = 1;
+    } else {
+        node->cost[NT_REG] = register_of(sel->alloc, node->name) >= 0 ? 0 : 1;
+    }
+}
+
+/* Apply chain rules until no cost improves */
+static void close_chains(TileNode *node) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int r = 0; r < TILE_RULE_COUNT; r++) {
+            TileRule *rule = &tile_rules[r];
+            if (!is_chain_rule(rule)) continue;
+            if (rule->lhs == NT_VAL && node->instr == NULL) continue;
+            int cost = node->cost[rule->tree->nt] + rule->cost;
+            if (cost < node->cost[rule->lhs]) {
+                node->cost[rule->lhs] = cost;
+                node->rule[rule->lhs] = rule;
+                node->cover_count[rule->lhs] = node->cover_count[rule->tree->nt];
+                node->cover_min[rule->lhs] = node->cover_min[rule->tree->nt];
+                changed = 1;
+            }
+        }
+    }
+}
+
+/* Find the cheapest rule for each nonterminal at a node */
+static void label_node(Selection *sel, TileNode *node, int fold) {
+    for (int nt = 0; nt < NT_COUNT; nt++) {
+        node->cost[nt] = TILE_INFINITY;
+        node->rule[nt] = NULL;
+        node->cover_count[nt] = 0;
+        node->cover_min[nt] = node->position;
+    }
+
+    if (node->instr == NULL || node->constant) {
+        label_leaf(sel, node);
+    } else {
+        for (int r = 0; r < TILE_RULE_COUNT; r++) {
+            TileRule *rule = &tile_rules[r];
+            TileMatch m;
+            if (is_chain_rule(rule) || rule->tree->op != node->op) continue;
+            if (match_rule(rule, node, fold, &m) && m.cost < node->cost[rule->lhs]) {
+                node->cost[rule->lhs] = m.cost;
+                node->rule[rule->lhs] = rule;
+                node->cover_count[rule->lhs] = m.cover_count;
+                node->cover_min[rule->lhs] = m.cover_min;
+            }
+        }
+    }
+    close_chains(node);
+}
+
+/* Label every node, kids before users */
+static void label_nodes(Selection *sel, int fold) {
+    for (int i = 0; i < sel->node_count; i++) {
+        label_node(sel, sel->nodes[i], fold);
+    }
+}
+
+static Nonterminal goal_of(TileNode *node) {
+    return node->op == TAC_ARRAY_STORE || node->op == TAC_IF_TRUE ? NT_STMT : NT_REG;
+}
+
+/* Check if a root emits nothing: the allocator recomputes its value */
+static int is_rematerialized(Selection *sel, TileNode *node) {
+    int value;
+    return node->name && goal_of(node) == NT_REG &&
+           rematerialized_constant(sel->alloc, node->name, &value);
+}
+
+/* Mark what the chosen tiling of node as nt covers */
+static void mark_covered(TileNode *node, Nonterminal nt) {
+    TileRule *rule = node->rule[nt];
+    TileMatch m;
+
+    if (rule == NULL) return;
+    if (is_chain_rule(rule)) {
+        mark_covered(node, rule->tree->nt);
+        return;
+    }
+    match_rule(rule, node, 1, &m);
+    for (int i = 0; i < m.interior_count; i++) {
+        m.interior[i]->covered = 1;
+    }
+    for (int i = 0; i < m.leaf_count; i++) {
+        TileLeaf *leaf = &m.leaves[i];
+        if (leaf->node->instr == NULL) continue;
+        if (leaf->inline_node) {
+            leaf->node->covered = 1;
+            mark_covered(leaf->node, leaf->nt);
+        } else if (leaf->node->foldable) {
+            leaf->node->embedded = 1;
+        }
+    }
+}
+
+/* Tile one function after register allocation */
+Selection *select_instructions(TACInstruction *func_begin, RegisterAllocation *alloc) {
+    Selection *sel = (Selection *)calloc(1, sizeof(Selection));
+    sel->alloc = alloc;
+    init_tile_rules();
+    build_dags(sel, func_begin);
+
+    /* One instruction at a time, for comparison */
+    label_nodes(sel, 0);
+    for (int i = 0; i < sel->operation_count; i++) {
+        TileNode *node = sel->operations[i];
+        if (!is_rematerialized(sel, node)) sel->unfolded_cost += node->cost[goal_of(node)];
+    }
+
+    label_nodes(sel, 1);
+    for (int i = sel->operation_count - 1; i >= 0; i--) {
+        TileNode *node = sel->operations[i];
+        if (!node->covered) mark_covered(node, goal_of(node));
+    }
+    for (int i = 0; i < sel->operation_count; i++) {
+        TileNode *node = sel->operations[i];
+        if (node->covered) {
+            sel->folded++;
+        } else if (!node->embedded && !is_rematerialized(sel, node)) {
+            sel->cost += node->cost[goal_of(node)];
+        }
+    }
+    return sel;
+}
+
+/* ---- Reduction ---- */
+
+/* Evaluate a tile operand */
+static TileValue tile_operand(TileLeaf *leaf, MIPSRegister scratch) {
+    if (leaf->chain) {
+        TileLeaf source = {leaf->node, NT_REG, 0, NULL};
+        current_selection->tiles++;
+        return leaf->chain->action(leaf->node, &source, scratch);
+    }
+    if (!leaf->inline_node) {
+        return in_register(use_register(leaf->node->name, scratch));
+    }
+    return reduce(leaf->node, leaf->nt, scratch);
+}
+
+/* Emit the chosen tiling of node as nt */
+static TileValue reduce(TileNode *node, Nonterminal nt, MIPSRegister dest) {
+    TileRule *rule = node->rule[nt];
+    TileValue v = {dest, 0, NULL};
+
+    if (rule == NULL) {
+        /* An operand or constant as it is */
+        switch (nt) {
+            case NT_REG:
+                v.reg = use_register(node->name, dest);
+                break;
+            case NT_GARR:
+                v.label = node->name;
+                break;
+            case NT_LARR:
+                v.reg = frame_base_register();
+                v.value = get_var_offset(node->name);
+                break;
+            default:
+                v.value = node->value;
+                break;
+        }
+        return v;
+    }
+
+    current_selection->tiles++;
+    if (is_chain_rule(rule)) {
+        TileLeaf source = {node, rule->tree->nt, 1, NULL};
+        return rule->action(node, &source, dest);
+    }
+    TileMatch m;
+    match_rule(rule, node, 1, &m);
+    return rule->action(node, m.leaves, dest);
+}
+
+/* Emit the tile rooted at a TAC instruction; returns 0 if the tree
+   grammar does not cover the instruction */
+int emit_selected(Selection *sel, TACInstruction *instr) {
+    if (sel->cursor >= sel->operation_count || sel->operations[sel->cursor]->instr != instr) {
+        return 0;
+    }
+    TileNode *node = sel->operations[sel->cursor++];
+    if (node->covered || is_rematerialized(sel, node)) return 1;
+
+    current_selection = sel;
+    if (goal_of(node) == NT_STMT) {
+        reduce(node, NT_STMT, REG_ZERO);
+    } else {
+        /* Copies between values sharing a frame slot need no code */
+        int slot = spill_slot_of(sel->alloc, instr->result);
+        if (instr->opcode == TAC_ASSIGN && slot >= 0 && !node->kids[0]->covered &&
+            slot == spill_slot_of(sel->alloc, instr->arg1)) {
+            return 1;
+        }
+        MIPSRegister rd = def_register(instr->result, REG_T8);
+        TileValue v = reduce(node, NT_REG, rd);
+        if (v.reg != rd) {
+            emit_rr(MOP_MOVE, rd, v.reg);
+        }
+        finish_def(instr->result, rd);
+    }
+    current_selection = NULL;
+    return 1;
+}
+
+/* Check if the tree selector is in use at this optimization level */
+int tree_selection_enabled(void) {
+    if (instruction_selector == SELECT_DEFAULT) {
+        return optimization_level >= OPT_BASIC;
+    }
+    return instruction_selector == SELECT_TREE;
+}
+
+void free_selection(Selection *sel) {
+    if (sel == NULL) return;
+    for (int i = 0; i < sel->node_count; i++) {
+        free(sel->nodes[i]);
+    }
+    free(sel->nodes);
+    free(sel->operations);
+    free(sel);
+}
+
+/* Print a function's selection statistics: tiles and their estimated
+   cost against tiling one TAC instruction at a time, and the MIPS
+   instructions actually emitted */
+void print_selection(const char *function, Selection *sel, int emitted) {
+    if (sel == NULL) {
+        printf("  %-16s %-6s %5d instructions emitted\n", function, "direct", emitted);
+        return;
+    }
+    printf("  %-16s %-6s %5d instructions emitted, %4d tiles, %3d of %4d TAC folded, "
+           "cost %5d (%5d one at a time)\n",
+           function, "tree", emitted, sel->tiles, sel->folded, sel->operation_count,
+           sel->cost, sel->unfolded_cost);
+}
@@ -30,6 +30,7 @@ void semantic_analysis(ASTNode *tree) {
     /* Perform final checks */
     check_main_function();
     check_unused_symbols();
+    rename_shadowing_locals();
     
     /* Print symbol table if in trace mode */
     if (trace_semantic) {
@@ -84,6 +85,16 @@ void analyze_node(ASTNode *node) {
             }
             break;
             
+        /* Expression statements reach here as bare expressions */
+        case NODE_ASSIGN:
+        case NODE_CALL:
+        case NODE_BINARY_OP:
+        case NODE_ID:
+        case NODE_ARRAY_ACCESS:
+        case NODE_NUM:
+            analyze_expression(node);
+            break;
+            
         default:
             analyze_node(node->left);
             analyze_node(node->right);
@@ -145,35 +156,38 @@ void analyze_func_decl(ASTNode *node) {
         check_return_paths(node->right, return_type);
     }
     
-    /* Exit function scope */
-    exit_scope();
+    /* Exit function scope, keeping it for the back end's frame layout */
+    func->locals = leave_scope();
     current_function = NULL;
 }
 
 /* Analyze function parameters */
 void analyze_params(ASTNode *params, SymbolEntry *func) {
-    ASTNode *param = params;
+    if (params == NULL) return;
     
-    while (param) {
-        if (param->node_type == NODE_PARAM) {
-            char *param_name = param->value.string_val;
-            DataType param_type = param->data_type;
-            
-            /* Insert parameter into symbol table */
-            SymbolEntry *param_symbol = insert_symbol(param_name, SYMBOL_PARAM, param_type);
-            
-            /* Add to function's parameter list */
-            if (param_symbol) {
-                SymbolEntry *param_copy = (SymbolEntry *)malloc(sizeof(SymbolEntry));
-                *param_copy = *param_symbol;
-                param_copy->next = NULL;
-                add_param_to_function(func, param_copy);
-            }
-            
-            param->symbol = param_symbol;
+    /* param_list is left-recursive: visit earlier parameters first */
+    if (params->node_type == NODE_PARAM_LIST) {
+        analyze_params(params->left, func);
+        analyze_params(params->right, func);
+        return;
+    }
+    
+    if (params->node_type == NODE_PARAM) {
+        char *param_name = params->value.string_val;
+        DataType param_type = params->data_type;
+        
+        /* Insert parameter into symbol table */
+        SymbolEntry *param_symbol = insert_symbol(param_name, SYMBOL_PARAM, param_type);
+        
+        /* Add to function's parameter list */
+        if (param_symbol) {
+            SymbolEntry *param_copy = (SymbolEntry *)malloc(sizeof(SymbolEntry));
+            *param_copy = *param_symbol;
+            param_copy->next = NULL;
+            add_param_to_function(func, param_copy);
         }
         
-        param = (param->node_type == NODE_PARAM_LIST) ? param->right : param->next;
+        params->symbol = param_symbol;
     }
 }
 
@@ -298,6 +312,7 @@ DataType analyze_var(ASTNode *node) {
         if (index_type != TYPE_INT) {
             semantic_error(node, "Array index must be integer");
         }
+        check_array_index(node);
         
         return TYPE_INT;
     }
@@ -379,26 +394,84 @@ DataType analyze_call(ASTNode *node) {
 
 /* Check function arguments */
 void check_function_args(SymbolEntry *func, ASTNode *args) {
-    SymbolEntry *param = func->params;
-    ASTNode *arg = args;
+    /* arg_list is left-recursive: flatten it into source order first */
+    int arg_count = 0;
+    for (ASTNode *arg = args; arg; arg = (arg->node_type == NODE_ARG_LIST) ? arg->left : NULL) {
+        arg_count++;
+    }
     
-    while (arg && param) {
-        DataType arg_type = analyze_expression(
-            (arg->node_type == NODE_ARG_LIST) ? arg->right : arg);
+    ASTNode **ordered = (ASTNode **)malloc((arg_count > 0 ? arg_count : 1) * sizeof(ASTNode *));
+    int i = arg_count;
+    for (ASTNode *arg = args; arg; arg = (arg->node_type == NODE_ARG_LIST) ? arg->left : NULL) {
+        ordered[--i] = (arg->node_type == NODE_ARG_LIST) ? arg->right : arg;
+    }
+    
+    SymbolEntry *param = func->params;
+    for (i = 0; i < arg_count && param; i++) {
+        DataType arg_type = analyze_expression(ordered[i]);
         
         if (!types_compatible(param->type, arg_type)) {
-            semantic_error(arg, "Argument type mismatch in call to '%s'", func->name);
+            semantic_error(ordered[i], "Argument type mismatch in call to '%s'", func->name);
         }
         
         param = param->next;
-        arg = (arg->node_type == NODE_ARG_LIST) ? arg->left : NULL;
     }
     
     if (param) {
         semantic_error(args, "Too few arguments in call to '%s'", func->name);
-    } else if (arg) {
+    } else if (i < arg_count) {
         semantic_error(args, "Too many arguments in call to '%s'", func->name);
     }
+    
+    free(ordered);
+}
+
+/* Give each local or parameter that shadows a global variable a name of
+   its own, <name>_<function>, which no C-Minus identifier can spell.
+   Later phases tell a global from a local by its name alone, and a
+   global is stored under its name. Run once every global is declared,
+   since a global may follow the functions it shadows */
+void rename_shadowing_locals(void) {
+    for (int h = 0; h < SYMTAB_SIZE; h++) {
+        for (SymbolEntry *func = global_scope->table[h]; func; func = func->next) {
+            if (func->kind == SYMBOL_FUNCTION && func->locals) {
+                rename_locals(func->locals, func->name);
+            }
+        }
+    }
+}
+
+/* Rename the shadowing symbols of one function scope, rehashing them */
+void rename_locals(Scope *locals, char *func_name) {
+    SymbolEntry *renamed = NULL;
+
+    for (int h = 0; h < SYMTAB_SIZE; h++) {
+        SymbolEntry **link = &locals->table[h];
+        while (*link) {
+            SymbolEntry *entry = *link;
+            SymbolEntry *global = lookup_symbol_in_scope(entry->name, global_scope);
+            if (global && global->kind != SYMBOL_FUNCTION) {
+                *link = entry->next;
+                entry->next = renamed;
+                renamed = entry;
+            } else {
+                link = &entry->next;
+            }
+        }
+    }
+
+    while (renamed) {
+        SymbolEntry *entry = renamed;
+        renamed = entry->next;
+
+        char *name = (char *)malloc(strlen(entry->name) + strlen(func_name) + 2);
+        sprintf(name, "%s_%s", entry->name, func_name);
+        entry->name = name;
+
+        int index = hash_function(name);
+        entry->next = locals->table[index];
+        locals->table[index] = entry;
+    }
 }
 
 /* Check type compatibility */
@@ -423,6 +496,23 @@ void check_main_function(void) {
     }
 }
 
+/* Check a constant array index against the declared size; other indices
+   are left to the -fbounds-check run-time checks */
+void check_array_index(ASTNode *node) {
+    SymbolEntry *symbol = (SymbolEntry *)node->symbol;
+    ASTNode *index = node->left;
+    
+    if (symbol == NULL || symbol->kind != SYMBOL_ARRAY || symbol->size <= 0 ||
+        index == NULL || index->node_type != NODE_NUM) {
+        return;
+    }
+    
+    if (index->value.int_val < 0 || index->value.int_val >= symbol->size) {
+        semantic_warning(node, "Index %d is out of bounds for array '%s' of size %d",
+                         index->value.int_val, symbol->name, symbol->size);
+    }
+}
+
 /* Check return paths (simplified) */
 void check_return_paths(ASTNode *func_body, DataType return_type) {
     /* This is a simplified check - a full implementation would
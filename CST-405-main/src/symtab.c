@@ -63,29 +63,36 @@ void enter_scope(void) {
 
 /* Exit current scope */
 void exit_scope(void) {
-    if (current_scope != global_scope) {
-        Scope *old_scope = current_scope;
-        current_scope = current_scope->parent;
-        
-        /* Check for unused symbols before freeing */
-        for (int i = 0; i < SYMTAB_SIZE; i++) {
-            SymbolEntry *entry = old_scope->table[i];
-            while (entry) {
-                if (!entry->is_used && entry->kind != SYMBOL_FUNCTION) {
-                    warning("Variable '%s' declared but never used (line %d)", 
-                            entry->name, entry->line_number);
-                }
-                entry = entry->next;
-            }
-        }
-        
-        /* Note: In a real compiler, we might want to keep the scope
-           for later phases, but for demonstration we'll free it */
+    Scope *old_scope = leave_scope();
+    if (old_scope) {
         free(old_scope->table);
         free(old_scope);
     }
 }
 
+/* Exit current scope but keep it for later phases, which look up its
+   symbols with lookup_symbol_in_scope */
+Scope *leave_scope(void) {
+    if (current_scope == global_scope) return NULL;
+    
+    Scope *old_scope = current_scope;
+    current_scope = current_scope->parent;
+    
+    /* Check for unused symbols */
+    for (int i = 0; i < SYMTAB_SIZE; i++) {
+        SymbolEntry *entry = old_scope->table[i];
+        while (entry) {
+            if (!entry->is_used && entry->kind != SYMBOL_FUNCTION) {
+                warning("Variable '%s' declared but never used (line %d)", 
+                        entry->name, entry->line_number);
+            }
+            entry = entry->next;
+        }
+    }
+    
+    return old_scope;
+}
+
 /* Insert a symbol into the current scope */
 SymbolEntry *insert_symbol(char *name, SymbolKind kind, DataType type) {
     int index = hash_function(name);
@@ -110,6 +117,7 @@ SymbolEntry *insert_symbol(char *name, SymbolKind kind, DataType type) {
     new_entry->is_used = 0;
     new_entry->params = NULL;
     new_entry->param_count = 0;
+    new_entry->locals = NULL;
     
     /* Allocate memory based on kind and scope */
     if (kind == SYMBOL_VAR || kind == SYMBOL_PARAM) {
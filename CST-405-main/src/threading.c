@@ -0,0 +1,678 @@
+/*
+ * Jump Threading Implementation
+ * CST-405 Compiler Design
+ *
+ * Collapses branch chains produced by nested if/while statements:
+ *   - branches on a constant become gotos or disappear
+ *   - jumps to a label that immediately jumps elsewhere are retargeted
+ *   - edges on which a conditional branch outcome is already decided by
+ *     a dominating compare are routed straight to the known successor
+ *   - a goto to a small compare-and-branch block is replaced by a copy of
+ *     that block, so loops test their condition at the bottom
+ *   - labels and blocks left without references are removed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "globals.h"
+
+/* Bounds keeping the pass linear-ish on pathological input */
+#define MAX_THREAD_ROUNDS 64
+#define MAX_CHAIN_LENGTH 16
+#define MAX_DOMINATOR_WALK 8
+#define MAX_DUPLICATED_INSTRUCTIONS 6
+#define MAX_KILLED_NAMES 64
+
+/* Outcomes of a compare expressed as a set of possible orderings of x and y */
+#define ORDER_LT 1
+#define ORDER_EQ 2
+#define ORDER_GT 4
+#define ORDER_ALL 7
+
+/* Description of the branch at the end of a candidate block */
+typedef struct {
+    TACInstruction *branch;    /* IF_TRUE / IF_FALSE */
+    TACInstruction *compare;   /* Compare defining the condition, or NULL */
+} BranchTest;
+
+/* Names written between a fact and the branch it should decide */
+typedef struct {
+    char *names[MAX_KILLED_NAMES];
+    int count;
+    int overflow;
+    int call_seen;
+} KilledSet;
+
+/* Thread one function until nothing changes; returns number of changes */
+int thread_function_jumps(TACInstruction *func_begin) {
+    int total = 0;
+
+    for (int round = 0; round < MAX_THREAD_ROUNDS; round++) {
+        int changed = 0;
+        ControlFlowGraph *cfg;
+
+        changed += fold_constant_branches(func_begin);
+        changed += retarget_jump_chains(func_begin);
+
+        cfg = build_cfg(func_begin);
+        changed += thread_decided_branches(cfg);
+        free_cfg(cfg);
+
+        if (changed == 0) {
+            changed += duplicate_branch_blocks(func_begin);
+        }
+
+        changed += invert_branches_over_gotos(func_begin);
+        changed += remove_unreachable_blocks(func_begin);
+        changed += remove_unreferenced_labels(func_begin);
+        changed += remove_jumps_to_next(func_begin);
+
+        total += changed;
+        if (changed == 0) break;
+    }
+
+    return total;
+}
+
+/* First non-label instruction at or after instr */
+static TACInstruction *skip_labels(TACInstruction *instr) {
+    while (instr && instr->opcode == TAC_LABEL) {
+        instr = instr->next;
+    }
+    return instr;
+}
+
+/* Check if label appears in the run of labels starting at instr */
+static int label_run_contains(TACInstruction *instr, int label) {
+    while (instr && instr->opcode == TAC_LABEL) {
+        if (instr->label == label) return 1;
+        instr = instr->next;
+    }
+    return 0;
+}
+
+/* Resolve conditional jumps whose condition is a constant */
+int fold_constant_branches(TACInstruction *func_begin) {
+    int changed = 0;
+
+    TACInstruction *prev = func_begin;
+    while (prev->next && prev->next->opcode != TAC_FUNC_END) {
+        TACInstruction *instr = prev->next;
+        if (!is_conditional_jump(instr) || !is_constant(instr->result)) {
+            prev = instr;
+            continue;
+        }
+
+        int taken = (get_constant_value(instr->result) != 0) ==
+                    (instr->opcode == TAC_IF_TRUE);
+        if (taken) {
+            instr->opcode = TAC_GOTO;
+            free(instr->result);
+            instr->result = NULL;
+            prev = instr;
+        } else {
+            remove_tac_after(prev);
+        }
+        opt_stats.branches_threaded++;
+        changed++;
+    }
+
+    return changed;
+}
+
+/* Retarget jumps whose destination is itself an unconditional jump */
+int retarget_jump_chains(TACInstruction *func_begin) {
+    TACInstruction *func_end = find_function_end(func_begin);
+    int limit = tac_context->label_count;
+    TACInstruction **first_after = (TACInstruction **)calloc(limit + 1, sizeof(TACInstruction *));
+    int changed = 0;
+
+    for (TACInstruction *instr = func_begin->next; instr != func_end; instr = instr->next) {
+        if (instr->opcode == TAC_LABEL && instr->label >= 0 && instr->label < limit) {
+            first_after[instr->label] = skip_labels(instr);
+        }
+    }
+
+    for (TACInstruction *instr = func_begin->next; instr != func_end; instr = instr->next) {
+        if (!is_jump(instr)) continue;
+
+        int target = instr->label;
+        for (int hops = 0; hops < MAX_CHAIN_LENGTH; hops++) {
+            if (target < 0 || target >= limit) break;
+            TACInstruction *dest = first_after[target];
+            if (dest == NULL || dest->opcode != TAC_GOTO || dest->label == target) break;
+            target = dest->label;
+        }
+
+        if (target != instr->label) {
+            instr->label = target;
+            opt_stats.branches_threaded++;
+            changed++;
+        }
+    }
+
+    free(first_after);
+    return changed;
+}
+
+/* Ordering mask for which a compare opcode yields true */
+static int compare_mask(TACOpcode op) {
+    switch (op) {
+        case TAC_LT:  return ORDER_LT;
+        case TAC_LTE: return ORDER_LT | ORDER_EQ;
+        case TAC_GT:  return ORDER_GT;
+        case TAC_GTE: return ORDER_GT | ORDER_EQ;
+        case TAC_EQ:  return ORDER_EQ;
+        case TAC_NEQ: return ORDER_LT | ORDER_GT;
+        default:      return 0;
+    }
+}
+
+/* Mask for y ? x given the mask for x ? y */
+static int swap_mask(int mask) {
+    return (mask & ORDER_EQ) |
+           ((mask & ORDER_LT) ? ORDER_GT : 0) |
+           ((mask & ORDER_GT) ? ORDER_LT : 0);
+}
+
+/* Count uses of a name inside a function */
+static int count_uses(TACInstruction *func_begin, char *name) {
+    int uses = 0;
+    for (TACInstruction *instr = func_begin->next;
+         instr && instr->opcode != TAC_FUNC_END; instr = instr->next) {
+        if (instr->arg1 && strcmp(instr->arg1, name) == 0) uses++;
+        if (instr->arg2 && strcmp(instr->arg2, name) == 0) uses++;
+        if (uses_result(instr) && instr->result && strcmp(instr->result, name) == 0) uses++;
+    }
+    return uses;
+}
+
+/* Recognize a block made only of labels, an optional compare and a branch */
+static int analyze_branch_block(ControlFlowGraph *cfg, BasicBlock *block, BranchTest *test) {
+    TACInstruction *instr = skip_labels(block->start);
+
+    test->compare = NULL;
+    test->branch = NULL;
+
+    if (!is_conditional_jump(block->end) || block->jump_target == NULL ||
+        block->fall_through == NULL || block->jump_target == block->fall_through) {
+        return 0;
+    }
+
+    if (instr != block->end) {
+        if (instr->next != block->end || compare_mask(instr->opcode) == 0 ||
+            strcmp(instr->result, block->end->result) != 0 ||
+            strcmp(instr->result, instr->arg1) == 0 ||
+            strcmp(instr->result, instr->arg2) == 0 ||
+            count_uses(cfg->func_begin, instr->result) != 1) {
+            return 0;
+        }
+        test->compare = instr;
+    }
+
+    test->branch = block->end;
+    return 1;
+}
+
+/* Remember every name defined in a block */
+static void kill_block_definitions(KilledSet *killed, BasicBlock *block) {
+    for (TACInstruction *instr = block->start; ; instr = instr->next) {
+        if (defines_result(instr)) {
+            if (killed->count < MAX_KILLED_NAMES) {
+                killed->names[killed->count++] = instr->result;
+            } else {
+                killed->overflow = 1;
+            }
+        }
+        if (instr->opcode == TAC_CALL) {
+            killed->call_seen = 1;
+        }
+        if (instr == block->end) break;
+    }
+}
+
+/* Check if a name may have changed since the fact was established */
+static int is_killed(KilledSet *killed, char *name) {
+    if (is_constant(name)) return 0;
+    if (killed->overflow) return 1;
+    if (killed->call_seen && !is_temporary(name)) return 1;
+    for (int i = 0; i < killed->count; i++) {
+        if (strcmp(killed->names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Find the compare feeding a branch inside its block, if its operands
+   are not redefined between the compare and the branch */
+static TACInstruction *find_feeding_compare(BasicBlock *block) {
+    TACInstruction *compare = NULL;
+    char *cond = block->end->result;
+
+    for (TACInstruction *instr = block->start; instr != block->end; instr = instr->next) {
+        if (defines_result(instr)) {
+            if (strcmp(instr->result, cond) == 0) {
+                compare = compare_mask(instr->opcode) ? instr : NULL;
+            } else if (compare &&
+                       (strcmp(instr->result, compare->arg1) == 0 ||
+                        strcmp(instr->result, compare->arg2) == 0)) {
+                compare = NULL;
+            }
+        }
+        if (instr->opcode == TAC_CALL && compare &&
+            (!is_temporary(compare->arg1) || !is_temporary(compare->arg2))) {
+            compare = NULL;
+        }
+    }
+
+    if (compare && (strcmp(compare->result, compare->arg1) == 0 ||
+                    strcmp(compare->result, compare->arg2) == 0)) {
+        return NULL;
+    }
+    return compare;
+}
+
+/* Check if two names hold the same value at the end of block, either
+   trivially or through a copy between them that is still intact */
+static int same_value_at_end(BasicBlock *block, char *a, char *b, KilledSet *killed) {
+    int linked = 0;
+
+    if (strcmp(a, b) == 0) return 1;
+    if (is_killed(killed, b)) return 0;
+
+    for (TACInstruction *instr = block->start; ; instr = instr->next) {
+        if (defines_result(instr)) {
+            if (instr->opcode == TAC_ASSIGN &&
+                ((strcmp(instr->result, a) == 0 && strcmp(instr->arg1, b) == 0) ||
+                 (strcmp(instr->result, b) == 0 && strcmp(instr->arg1, a) == 0))) {
+                linked = 1;
+            } else if (strcmp(instr->result, a) == 0 || strcmp(instr->result, b) == 0) {
+                linked = 0;
+            }
+        }
+        if (instr == block->end) break;
+    }
+
+    return linked;
+}
+
+/* Decide the branch of block on the edge pred -> block by walking up the
+   chain of single-predecessor blocks; returns 1 taken, 0 not taken, -1 unknown */
+static int branch_outcome_on_edge(BasicBlock *pred, BasicBlock *block, BranchTest *test) {
+    KilledSet killed;
+    BasicBlock *from = pred;
+    BasicBlock *to = block;
+    char *cond = test->branch->result;
+    int jump_if_true = (test->branch->opcode == TAC_IF_TRUE);
+
+    killed.count = 0;
+    killed.overflow = 0;
+    killed.call_seen = 0;
+
+    for (int depth = 0; depth < MAX_DOMINATOR_WALK; depth++) {
+        TACInstruction *term = from->end;
+
+        if (is_conditional_jump(term) && from->jump_target != from->fall_through &&
+            (to == from->jump_target || to == from->fall_through)) {
+            int taken = (to == from->jump_target);
+            int cond_true = ((term->opcode == TAC_IF_TRUE) == taken);
+            int value = -1;
+
+            if (test->compare == NULL) {
+                /* Same condition variable tested again */
+                if (strcmp(term->result, cond) == 0 && !is_killed(&killed, cond)) {
+                    value = cond_true;
+                }
+            } else {
+                /* Compare implied by the compare feeding the earlier branch */
+                TACInstruction *known = find_feeding_compare(from);
+                if (known && !is_killed(&killed, known->arg1) &&
+                    !is_killed(&killed, known->arg2)) {
+                    int possible = cond_true ? compare_mask(known->opcode)
+                                             : ORDER_ALL & ~compare_mask(known->opcode);
+                    int wanted = compare_mask(test->compare->opcode);
+                    int matched = 1;
+
+                    if (same_value_at_end(from, known->arg1, test->compare->arg1, &killed) &&
+                        same_value_at_end(from, known->arg2, test->compare->arg2, &killed)) {
+                        /* same operand order */
+                    } else if (same_value_at_end(from, known->arg1, test->compare->arg2, &killed) &&
+                               same_value_at_end(from, known->arg2, test->compare->arg1, &killed)) {
+                        possible = swap_mask(possible);
+                    } else {
+                        matched = 0;
+                    }
+
+                    if (matched) {
+                        if ((possible & ~wanted) == 0) value = 1;
+                        else if ((possible & wanted) == 0) value = 0;
+                    }
+                }
+            }
+
+            if (value >= 0) {
+                return (value == jump_if_true) ? 1 : 0;
+            }
+        }
+
+        /* Facts above this block only hold if it has a single entry */
+        if (from->pred_count != 1 || from->predecessors[0] == block) break;
+        kill_block_definitions(&killed, from);
+        to = from;
+        from = from->predecessors[0];
+    }
+
+    return -1;
+}
+
+/* Label at the head of a block, creating one if it has none */
+static int block_label(BasicBlock *block) {
+    if (block->start->opcode == TAC_LABEL) {
+        return block->start->label;
+    }
+
+    TACInstruction *label = create_tac(TAC_LABEL, NULL, NULL, NULL);
+    label->label = new_label();
+    insert_tac_after(block->before, label);
+    block->start = label;
+    return label->label;
+}
+
+/* Route pred's edge into block directly to dest */
+static void redirect_edge(BasicBlock *pred, BasicBlock *block, BasicBlock *dest) {
+    int label = block_label(dest);
+    TACInstruction *last = pred->end;
+
+    if (is_jump(last) && pred->jump_target == block) {
+        last->label = label;
+    } else {
+        TACInstruction *jump = create_tac(TAC_GOTO, NULL, NULL, NULL);
+        jump->label = label;
+        insert_tac_after(last, jump);
+        pred->end = jump;
+    }
+}
+
+/* Thread every edge into the first block whose branch outcome is already
+   known on some incoming edge */
+int thread_decided_branches(ControlFlowGraph *cfg) {
+    for (int i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        BranchTest test;
+        int threaded = 0;
+
+        if (block->pred_count == 0 || !analyze_branch_block(cfg, block, &test)) continue;
+
+        for (int p = 0; p < block->pred_count; p++) {
+            BasicBlock *pred = block->predecessors[p];
+
+            if (pred == block) continue;
+            if (is_conditional_jump(pred->end) && pred->jump_target == pred->fall_through) continue;
+
+            int outcome = branch_outcome_on_edge(pred, block, &test);
+            if (outcome < 0) continue;
+
+            BasicBlock *dest = outcome ? block->jump_target : block->fall_through;
+            if (dest == NULL || dest == block) continue;
+
+            redirect_edge(pred, block, dest);
+            opt_stats.branches_threaded++;
+            threaded++;
+        }
+
+        /* Edges changed; let the caller rebuild the CFG */
+        if (threaded > 0) return threaded;
+    }
+
+    return 0;
+}
+
+/* Check if a block is a short pure computation ending in a branch whose
+   temporaries are not used anywhere else */
+static int is_duplicable_branch_block(ControlFlowGraph *cfg, BasicBlock *block) {
+    int count = 0;
+
+    if (!is_conditional_jump(block->end) || block->jump_target == NULL ||
+        block->fall_through == NULL) {
+        return 0;
+    }
+
+    for (TACInstruction *instr = skip_labels(block->start); instr != block->end;
+         instr = instr->next) {
+        if (!(is_binary_operation(instr->opcode) || instr->opcode == TAC_LOAD_CONST ||
+              instr->opcode == TAC_ASSIGN || instr->opcode == TAC_NEG ||
+              instr->opcode == TAC_ARRAY_LOAD)) {
+            return 0;
+        }
+        if (!is_temporary(instr->result)) return 0;
+        if (++count > MAX_DUPLICATED_INSTRUCTIONS) return 0;
+
+        /* Every use of the temp must be inside this block */
+        int local_uses = 0;
+        for (TACInstruction *use = instr->next; ; use = use->next) {
+            if (use->arg1 && strcmp(use->arg1, instr->result) == 0) local_uses++;
+            if (use->arg2 && strcmp(use->arg2, instr->result) == 0) local_uses++;
+            if (uses_result(use) && use->result && strcmp(use->result, instr->result) == 0) {
+                local_uses++;
+            }
+            if (use == block->end) break;
+        }
+        if (local_uses != count_uses(cfg->func_begin, instr->result)) return 0;
+    }
+
+    return 1;
+}
+
+/* Rename operand through the temp map built while copying a block */
+static char *rename_operand(char *operand, char **from, char **to, int count) {
+    if (operand == NULL) return NULL;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(operand, from[i]) == 0) return to[i];
+    }
+    return operand;
+}
+
+/* Replace one goto into a small branch block with a copy of that block, so
+   the branch falls through to the code already laid out after the goto */
+static int duplicate_one_branch_block(ControlFlowGraph *cfg) {
+    for (int i = 0; i < cfg->block_count; i++) {
+        BasicBlock *pred = cfg->blocks[i];
+        BasicBlock *layout_next = (i + 1 < cfg->block_count) ? cfg->blocks[i + 1] : NULL;
+        BasicBlock *block = pred->jump_target;
+
+        if (pred->end->opcode != TAC_GOTO || block == NULL || block == pred ||
+            layout_next == NULL || !is_duplicable_branch_block(cfg, block)) {
+            continue;
+        }
+
+        /* The copy only pays off if one branch edge becomes a fall-through */
+        int invert;
+        BasicBlock *dest;
+        if (layout_next == block->jump_target && block->fall_through != block->jump_target) {
+            invert = 1;
+            dest = block->fall_through;
+        } else if (layout_next == block->fall_through) {
+            invert = 0;
+            dest = block->jump_target;
+        } else {
+            continue;
+        }
+        char *from[MAX_DUPLICATED_INSTRUCTIONS];
+        char *to[MAX_DUPLICATED_INSTRUCTIONS];
+        int renamed = 0;
+        int label = block_label(dest);
+        TACInstruction *goto_instr = pred->end;
+        TACInstruction *pos = goto_instr;
+        TACInstruction *before_goto = pred->before;
+        while (before_goto->next != goto_instr) {
+            before_goto = before_goto->next;
+        }
+
+        for (TACInstruction *instr = skip_labels(block->start); ; instr = instr->next) {
+            TACInstruction *copy = copy_tac(instr);
+
+            free(copy->arg1);
+            copy->arg1 = copy_string(rename_operand(instr->arg1, from, to, renamed));
+            free(copy->arg2);
+            copy->arg2 = copy_string(rename_operand(instr->arg2, from, to, renamed));
+
+            if (instr == block->end) {
+                char *cond = copy_string(rename_operand(instr->result, from, to, renamed));
+                free(copy->result);
+                copy->result = cond;
+                if (invert) {
+                    copy->opcode = (instr->opcode == TAC_IF_TRUE) ? TAC_IF_FALSE : TAC_IF_TRUE;
+                }
+                copy->label = label;
+            } else {
+                from[renamed] = instr->result;
+                to[renamed] = new_temp();
+                free(copy->result);
+                copy->result = copy_string(to[renamed]);
+                renamed++;
+            }
+
+            insert_tac_after(pos, copy);
+            pos = copy;
+            if (instr == block->end) break;
+        }
+
+        /* Drop the goto now that the copied branch replaces it */
+        remove_tac_after(before_goto);
+
+        for (int r = 0; r < renamed; r++) {
+            free(to[r]);
+        }
+
+        opt_stats.branches_threaded++;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Duplicate branch blocks at every profitable goto; each step removes a
+   goto and adds none, so this terminates */
+int duplicate_branch_blocks(TACInstruction *func_begin) {
+    int changed = 0;
+
+    while (1) {
+        ControlFlowGraph *cfg = build_cfg(func_begin);
+        int step = duplicate_one_branch_block(cfg);
+        free_cfg(cfg);
+        if (step == 0) break;
+        changed += step;
+    }
+
+    return changed;
+}
+
+/* "if c goto L; goto M; L:" becomes "if !c goto M; L:" */
+int invert_branches_over_gotos(TACInstruction *func_begin) {
+    int changed = 0;
+
+    for (TACInstruction *instr = func_begin->next;
+         instr && instr->opcode != TAC_FUNC_END; instr = instr->next) {
+        TACInstruction *jump = instr->next;
+
+        if (!is_conditional_jump(instr) || jump == NULL || jump->opcode != TAC_GOTO ||
+            jump->label == instr->label || !label_run_contains(jump->next, instr->label)) {
+            continue;
+        }
+
+        instr->opcode = (instr->opcode == TAC_IF_TRUE) ? TAC_IF_FALSE : TAC_IF_TRUE;
+        instr->label = jump->label;
+        remove_tac_after(instr);
+        opt_stats.branches_threaded++;
+        changed++;
+    }
+
+    return changed;
+}
+
+/* Delete blocks that cannot be reached from the function entry */
+int remove_unreachable_blocks(TACInstruction *func_begin) {
+    ControlFlowGraph *cfg = build_cfg(func_begin);
+    TACInstruction *kept = func_begin;
+    int removed = 0;
+
+    mark_reachable_blocks(cfg);
+
+    for (int i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+
+        if (block->reachable) {
+            kept->next = block->start;
+            kept = block->end;
+            continue;
+        }
+
+        TACInstruction *instr = block->start;
+        while (1) {
+            TACInstruction *next = instr->next;
+            int last = (instr == block->end);
+            free_tac_instruction(instr);
+            removed++;
+            if (last) break;
+            instr = next;
+        }
+    }
+    kept->next = cfg->func_end;
+
+    free_cfg(cfg);
+    opt_stats.dead_code_removed += removed;
+    return removed;
+}
+
+/* Delete labels that no jump refers to */
+int remove_unreferenced_labels(TACInstruction *func_begin) {
+    TACInstruction *func_end = find_function_end(func_begin);
+    int limit = tac_context->label_count;
+    int *refs = (int *)calloc(limit + 1, sizeof(int));
+    int removed = 0;
+
+    for (TACInstruction *instr = func_begin->next; instr != func_end; instr = instr->next) {
+        if (is_jump(instr) && instr->label >= 0 && instr->label < limit) {
+            refs[instr->label]++;
+        }
+    }
+
+    TACInstruction *prev = func_begin;
+    while (prev->next != func_end) {
+        TACInstruction *instr = prev->next;
+        if (instr->opcode == TAC_LABEL && instr->label >= 0 && instr->label < limit &&
+            refs[instr->label] == 0) {
+            remove_tac_after(prev);
+            opt_stats.labels_removed++;
+            removed++;
+        } else {
+            prev = instr;
+        }
+    }
+
+    free(refs);
+    return removed;
+}
+
+/* Delete jumps whose target is the instruction right after them */
+int remove_jumps_to_next(TACInstruction *func_begin) {
+    TACInstruction *func_end = find_function_end(func_begin);
+    int removed = 0;
+
+    TACInstruction *prev = func_begin;
+    while (prev->next != func_end) {
+        TACInstruction *instr = prev->next;
+        if (is_jump(instr) && label_run_contains(instr->next, instr->label)) {
+            remove_tac_after(prev);
+            opt_stats.dead_code_removed++;
+            removed++;
+        } else {
+            prev = instr;
+        }
+    }
+
+    return removed;
+}